@@ -0,0 +1,226 @@
+#include "AabbBatch.hpp"
+#include "CpuFeatures.hpp"
+#include "Random.hpp"
+#include <iostream>
+#include <chrono>
+#include <limits>
+#include <bit>
+
+#if defined(SIMD_AVX2_KERNELS)
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AABB_KERNEL_SSE2
+#endif
+
+namespace {
+
+// padding boxes are inside out, so no comparison can make them overlap
+constexpr float PAD_MIN = std::numeric_limits<float>::max();
+constexpr float PAD_MAX = -std::numeric_limits<float>::max();
+
+bool overlapsScalar(const AabbBatch& a, size_t i, const AabbBatch& b, size_t j) {
+    return a.minX[i] <= b.maxX[j] && a.maxX[i] >= b.minX[j] &&
+           a.minY[i] <= b.maxY[j] && a.maxY[i] >= b.minY[j] &&
+           a.minZ[i] <= b.maxZ[j] && a.maxZ[i] >= b.minZ[j];
+}
+
+void findOverlapsScalar(const AabbBatch& queries, const AabbBatch& targets, std::vector<AabbOverlap>& pairs) {
+    for (size_t q = 0; q < queries.count(); q++) {
+        for (size_t t = 0; t < targets.count(); t++) {
+            if (overlapsScalar(queries, q, targets, t)) {
+                pairs.push_back({ static_cast<uint32_t>(q), static_cast<uint32_t>(t) });
+            }
+        }
+    }
+}
+
+// appends the set bits of an overlap mask as pairs
+void appendMask(std::vector<AabbOverlap>& pairs, uint32_t query, uint32_t first, unsigned mask) {
+    while (mask != 0) {
+        pairs.push_back({ query, first + static_cast<uint32_t>(std::countr_zero(mask)) });
+        mask &= mask - 1;
+    }
+}
+
+#if defined(SIMD_AVX2_KERNELS)
+
+SIMD_TARGET_AVX2 void findOverlapsAvx2(const AabbBatch& queries, const AabbBatch& targets, std::vector<AabbOverlap>& pairs) {
+    const size_t padded = targets.minX.size(); // whole batches, the padding never overlaps
+    for (size_t q = 0; q < queries.count(); q++) {
+        const __m256 qMinX = _mm256_set1_ps(queries.minX[q]);
+        const __m256 qMinY = _mm256_set1_ps(queries.minY[q]);
+        const __m256 qMinZ = _mm256_set1_ps(queries.minZ[q]);
+        const __m256 qMaxX = _mm256_set1_ps(queries.maxX[q]);
+        const __m256 qMaxY = _mm256_set1_ps(queries.maxY[q]);
+        const __m256 qMaxZ = _mm256_set1_ps(queries.maxZ[q]);
+
+        for (size_t t = 0; t < padded; t += 8) {
+            __m256 hit = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(&targets.minX[t]), qMaxX, _CMP_LE_OQ),
+                                       _mm256_cmp_ps(_mm256_loadu_ps(&targets.maxX[t]), qMinX, _CMP_GE_OQ));
+            hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_loadu_ps(&targets.minY[t]), qMaxY, _CMP_LE_OQ));
+            hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_loadu_ps(&targets.maxY[t]), qMinY, _CMP_GE_OQ));
+            hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_loadu_ps(&targets.minZ[t]), qMaxZ, _CMP_LE_OQ));
+            hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_loadu_ps(&targets.maxZ[t]), qMinZ, _CMP_GE_OQ));
+            appendMask(pairs, static_cast<uint32_t>(q), static_cast<uint32_t>(t), static_cast<unsigned>(_mm256_movemask_ps(hit)));
+        }
+    }
+}
+
+#endif
+
+#if defined(AABB_KERNEL_SSE2)
+
+void findOverlapsSse2(const AabbBatch& queries, const AabbBatch& targets, std::vector<AabbOverlap>& pairs) {
+    const size_t padded = targets.minX.size();
+    for (size_t q = 0; q < queries.count(); q++) {
+        const __m128 qMinX = _mm_set1_ps(queries.minX[q]);
+        const __m128 qMinY = _mm_set1_ps(queries.minY[q]);
+        const __m128 qMinZ = _mm_set1_ps(queries.minZ[q]);
+        const __m128 qMaxX = _mm_set1_ps(queries.maxX[q]);
+        const __m128 qMaxY = _mm_set1_ps(queries.maxY[q]);
+        const __m128 qMaxZ = _mm_set1_ps(queries.maxZ[q]);
+
+        for (size_t t = 0; t < padded; t += 4) {
+            __m128 hit = _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(&targets.minX[t]), qMaxX),
+                                    _mm_cmpge_ps(_mm_loadu_ps(&targets.maxX[t]), qMinX));
+            hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_loadu_ps(&targets.minY[t]), qMaxY));
+            hit = _mm_and_ps(hit, _mm_cmpge_ps(_mm_loadu_ps(&targets.maxY[t]), qMinY));
+            hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_loadu_ps(&targets.minZ[t]), qMaxZ));
+            hit = _mm_and_ps(hit, _mm_cmpge_ps(_mm_loadu_ps(&targets.maxZ[t]), qMinZ));
+            appendMask(pairs, static_cast<uint32_t>(q), static_cast<uint32_t>(t), static_cast<unsigned>(_mm_movemask_ps(hit)));
+        }
+    }
+}
+
+#endif
+
+// the widest kernel the CPU has
+void findOverlapsSimd(const AabbBatch& queries, const AabbBatch& targets, std::vector<AabbOverlap>& pairs) {
+#if defined(SIMD_AVX2_KERNELS)
+    if (cpuHasAvx2()) {
+        findOverlapsAvx2(queries, targets, pairs);
+        return;
+    }
+#endif
+#if defined(AABB_KERNEL_SSE2)
+    findOverlapsSse2(queries, targets, pairs);
+#else
+    findOverlapsScalar(queries, targets, pairs);
+#endif
+}
+
+} // namespace
+
+void AabbBatch::clear() {
+    minX.clear();
+    minY.clear();
+    minZ.clear();
+    maxX.clear();
+    maxY.clear();
+    maxZ.clear();
+    userData.clear();
+}
+
+void AabbBatch::reserve(size_t capacity) {
+    const size_t padded = (capacity + BATCH - 1) / BATCH * BATCH;
+    for (auto* values : { &minX, &minY, &minZ, &maxX, &maxY, &maxZ }) {
+        values->reserve(padded);
+    }
+    userData.reserve(capacity);
+}
+
+void AabbBatch::pad() {
+    const size_t padded = (userData.size() + BATCH - 1) / BATCH * BATCH;
+    for (auto* values : { &minX, &minY, &minZ }) {
+        values->resize(padded, PAD_MIN);
+    }
+    for (auto* values : { &maxX, &maxY, &maxZ }) {
+        values->resize(padded, PAD_MAX);
+    }
+}
+
+void AabbBatch::add(const glm::vec3& min, const glm::vec3& max, uint32_t data) {
+    // the new box takes the first padding slot, a full batch opens a new one
+    const size_t i = userData.size();
+    userData.push_back(data);
+    if (i == minX.size()) {
+        pad();
+    }
+    minX[i] = min.x;
+    minY[i] = min.y;
+    minZ[i] = min.z;
+    maxX[i] = max.x;
+    maxY[i] = max.y;
+    maxZ[i] = max.z;
+}
+
+void findOverlaps(const AabbBatch& queries, const AabbBatch& targets, std::vector<AabbOverlap>& pairs, AabbKernelPath path) {
+    if (path == AabbKernelPath::SIMD) {
+        findOverlapsSimd(queries, targets, pairs);
+    } else {
+        findOverlapsScalar(queries, targets, pairs);
+    }
+}
+
+const char* aabbKernelName() {
+#if defined(SIMD_AVX2_KERNELS)
+    if (cpuHasAvx2()) {
+        return "AVX2";
+    }
+#endif
+#if defined(AABB_KERNEL_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+void benchmarkAabbKernels() {
+    // projectiles flying down a road lined with houses, like update_projectiles
+    const size_t counts[][2] = { { 16, 64 }, { 64, 256 }, { 256, 1024 }, { 1024, 4096 } };
+    RandomStream generator(777);
+
+    std::cout << "AABB overlap kernel benchmark (" << aabbKernelName() << ")" << std::endl;
+
+    for (const auto& count : counts) {
+        const size_t projectiles = count[0];
+        const size_t houses = count[1];
+        const float length = houses * 9.0f; // two rows, 18 m apart
+
+        AabbBatch houseBoxes, projectileBoxes;
+        for (size_t i = 0; i < houses; i++) {
+            const glm::vec3 center(i % 2 == 0 ? -20.0f : 10.0f, 0.0f, -static_cast<float>(i / 2) * 18.0f);
+            const glm::vec3 half(4.0f, 6.0f, 4.0f);
+            houseBoxes.add(center - half, center + half, static_cast<uint32_t>(i));
+        }
+        for (size_t i = 0; i < projectiles; i++) {
+            const glm::vec3 from(generator.range(-25.0f, 15.0f), generator.range(0.0f, 10.0f), -generator.range(0.0f, length));
+            const glm::vec3 to = from + generator.onSphere(50.0f / 60.0f); // one step at 50 m/s
+            projectileBoxes.add(glm::min(from, to) - 0.3f, glm::max(from, to) + 0.3f, static_cast<uint32_t>(i));
+        }
+
+        // enough repetitions for about the same amount of work per entry
+        const int runs = static_cast<int>(std::max<size_t>(1, (size_t(1) << 26) / (projectiles * houses)));
+        std::vector<AabbOverlap> pairs;
+        size_t pairCount[2] = {};
+        float nsPerQuery[2] = {};
+        const AabbKernelPath paths[2] = { AabbKernelPath::SCALAR, AabbKernelPath::SIMD };
+        for (int p = 0; p < 2; p++) {
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int run = 0; run < runs; run++) {
+                pairs.clear();
+                findOverlaps(projectileBoxes, houseBoxes, pairs, paths[p]);
+            }
+            nsPerQuery[p] = std::chrono::duration<float, std::nano>(std::chrono::high_resolution_clock::now() - start).count() /
+                            (static_cast<float>(runs) * projectiles);
+            pairCount[p] = pairs.size();
+        }
+
+        std::cout << "  " << projectiles << " projectiles x " << houses << " houses: scalar " << nsPerQuery[0]
+                  << " ns/projectile, " << aabbKernelName() << " " << nsPerQuery[1] << " ns/projectile ("
+                  << nsPerQuery[0] / nsPerQuery[1] << "x, " << (pairCount[0] == pairCount[1] ? "same pairs" : "PAIRS DIFFER")
+                  << ")" << std::endl;
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// Axis-aligned boxes as a structure of arrays, padded to whole SIMD batches.
+//
+// The game keeps the house boxes and the swept boxes of the projectiles of a step in
+// this form, so findOverlaps can test one projectile against eight houses per
+// instruction instead of chasing a pointer per projectile and house.
+struct AabbBatch {
+    static constexpr size_t BATCH = 8; // boxes per AVX2 register
+
+    std::vector<float> minX, minY, minZ;
+    std::vector<float> maxX, maxY, maxZ;
+    std::vector<uint32_t> userData; // what the box belongs to (e.g. an index into GameState::houses)
+
+    size_t count() const { return userData.size(); }
+    bool empty() const { return userData.empty(); }
+
+    void clear();
+    void reserve(size_t capacity);
+    void add(const glm::vec3& min, const glm::vec3& max, uint32_t data);
+    glm::vec3 getMin(size_t i) const { return glm::vec3(minX[i], minY[i], minZ[i]); }
+    glm::vec3 getMax(size_t i) const { return glm::vec3(maxX[i], maxY[i], maxZ[i]); }
+
+private:
+    void pad(); // empty boxes (min > max) up to a whole batch, they never overlap
+};
+
+// Overlapping pair of findOverlaps, indices into the two batches
+struct AabbOverlap {
+    uint32_t query;
+    uint32_t target;
+};
+
+// Which implementation the kernel uses, SIMD = the widest one the CPU supports
+enum class AabbKernelPath {
+    SCALAR,
+    SIMD
+};
+
+// Every query box against every target box in one pass, the overlapping pairs are
+// appended ordered by query and then by target
+void findOverlaps(const AabbBatch& queries, const AabbBatch& targets, std::vector<AabbOverlap>& pairs,
+                  AabbKernelPath path = AabbKernelPath::SIMD);
+
+const char* aabbKernelName(); // "AVX2", "SSE2" or "scalar"
+
+// Times findOverlaps with both paths for growing numbers of projectiles and houses
+// along a road and prints the time per query box (key F8)
+void benchmarkAabbKernels();
@@ -0,0 +1,368 @@
+#include "AabbTree.hpp"
+#include <limits>
+
+namespace {
+
+// Entry distance of a ray into the capsule around one box edge: the edge runs along axis
+// through the corner whose max faces are set in maxMask
+bool intersectRayEdge(const glm::vec3& origin, const glm::vec3& direction, const Aabb& box, int maxMask, int axis,
+                      float radius, float maxDistance, float& distance) {
+    glm::vec3 corner;
+    for (int i = 0; i < 3; i++) {
+        corner[i] = (maxMask >> i) & 1 ? box.max[i] : box.min[i];
+    }
+
+    // infinite cylinder around the edge (a circle in the two other axes)
+    float best = std::numeric_limits<float>::max();
+    const int i1 = (axis + 1) % 3;
+    const int i2 = (axis + 2) % 3;
+    const glm::vec2 offset(origin[i1] - corner[i1], origin[i2] - corner[i2]);
+    const glm::vec2 planar(direction[i1], direction[i2]);
+    const float a = glm::dot(planar, planar);
+    if (a > 1e-12f) {
+        const float b = glm::dot(offset, planar);
+        const float discriminant = b * b - a * (glm::dot(offset, offset) - radius * radius);
+        if (discriminant >= 0.0f) {
+            const float t = (-b - std::sqrt(discriminant)) / a;
+            const float along = origin[axis] + direction[axis] * t;
+            if (t >= 0.0f && along >= box.min[axis] && along <= box.max[axis]) {
+                best = t;
+            }
+        }
+    }
+
+    // spheres at both ends
+    for (float end : { box.min[axis], box.max[axis] }) {
+        glm::vec3 center = corner;
+        center[axis] = end;
+        float t;
+        if (intersectRaySphere(origin, direction, center, radius, maxDistance, t)) {
+            best = std::min(best, t);
+        }
+    }
+
+    if (best > maxDistance) {
+        return false;
+    }
+    distance = best;
+    return true;
+}
+
+} // namespace
+
+bool intersectRayAabb(const glm::vec3& origin, const glm::vec3& direction, const Aabb& box, float maxDistance,
+                      float& distance, glm::vec3& normal) {
+    // slabs, the latest entry and the earliest exit over the three axes
+    float tEnter = 0.0f;
+    float tExit = maxDistance;
+    int enterAxis = -1;
+    float enterSign = 0.0f;
+
+    for (int axis = 0; axis < 3; axis++) {
+        if (std::abs(direction[axis]) < 1e-8f) {
+            if (origin[axis] < box.min[axis] || origin[axis] > box.max[axis]) {
+                return false;
+            }
+            continue;
+        }
+        const float inv = 1.0f / direction[axis];
+        float t1 = (box.min[axis] - origin[axis]) * inv;
+        float t2 = (box.max[axis] - origin[axis]) * inv;
+        float sign = -1.0f; // entering through the min face
+        if (t1 > t2) {
+            std::swap(t1, t2);
+            sign = 1.0f;
+        }
+        if (t1 > tEnter) {
+            tEnter = t1;
+            enterAxis = axis;
+            enterSign = sign;
+        }
+        tExit = std::min(tExit, t2);
+        if (tEnter > tExit) {
+            return false;
+        }
+    }
+
+    distance = tEnter;
+    normal = glm::vec3(0.0f);
+    if (enterAxis >= 0) {
+        normal[enterAxis] = enterSign;
+    } else {
+        normal = -direction; // started inside
+    }
+    return true;
+}
+
+bool intersectRaySphere(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& center, float radius,
+                        float maxDistance, float& distance) {
+    const glm::vec3 offset = origin - center;
+    const float b = glm::dot(offset, direction);
+    const float c = glm::dot(offset, offset) - radius * radius;
+    const float discriminant = b * b - c;
+    if (b > 0.0f || discriminant < 0.0f) {
+        return false;
+    }
+    distance = std::max(-b - std::sqrt(discriminant), 0.0f);
+    return distance <= maxDistance;
+}
+
+bool intersectSweptSphereAabb(const glm::vec3& origin, const glm::vec3& direction, float radius, const Aabb& box,
+                              float maxDistance, float& distance, glm::vec3& normal) {
+    // Ray against the box grown by the radius with rounded edges and corners
+    // (Ericson, Real-Time Collision Detection 5.5.7): the grown box decides
+    // the region, edge and corner regions are resolved against edge capsules
+    const glm::vec3 closest = glm::clamp(origin, box.min, box.max);
+    if (glm::dot(origin - closest, origin - closest) <= radius * radius) {
+        distance = 0.0f;
+        normal = -direction; // started inside
+        return true;
+    }
+    if (!intersectRayAabb(origin, direction, box.expanded(radius), maxDistance, distance, normal)) {
+        return false;
+    }
+
+    const glm::vec3 entry = origin + direction * distance;
+    int minMask = 0;
+    int maxMask = 0;
+    for (int i = 0; i < 3; i++) {
+        minMask |= entry[i] < box.min[i] ? 1 << i : 0;
+        maxMask |= entry[i] > box.max[i] ? 1 << i : 0;
+    }
+    const int outside = minMask | maxMask;
+    if (outside == 0 || outside == 1 || outside == 2 || outside == 4) {
+        return true; // face region, the grown box is exact there
+    }
+
+    float best = std::numeric_limits<float>::max();
+    for (int axis = 0; axis < 3; axis++) {
+        // an edge region has one edge (along the inside axis), a corner region three
+        if (outside != 7 && ((outside >> axis) & 1)) {
+            continue;
+        }
+        float t;
+        if (intersectRayEdge(origin, direction, box, maxMask, axis, radius, maxDistance, t)) {
+            best = std::min(best, t);
+        }
+    }
+    if (best > maxDistance) {
+        return false;
+    }
+    distance = best;
+    const glm::vec3 center = origin + direction * distance;
+    normal = glm::normalize(center - glm::clamp(center, box.min, box.max));
+    return true;
+}
+
+uint32_t DynamicAabbTree::allocateNode() {
+    if (freeList == NULL_NODE) {
+        nodes.emplace_back();
+        return static_cast<uint32_t>(nodes.size() - 1);
+    }
+    const uint32_t node = freeList;
+    freeList = nodes[node].parent;
+    nodes[node] = Node();
+    return node;
+}
+
+void DynamicAabbTree::freeNode(uint32_t node) {
+    nodes[node].parent = freeList;
+    nodes[node].height = -1;
+    freeList = node;
+}
+
+void DynamicAabbTree::clear() {
+    nodes.clear();
+    root = NULL_NODE;
+    freeList = NULL_NODE;
+    proxyCount = 0;
+}
+
+uint32_t DynamicAabbTree::createProxy(const Aabb& aabb, uint32_t userData) {
+    const uint32_t proxy = allocateNode();
+    nodes[proxy].aabb = aabb.expanded(FAT_MARGIN);
+    nodes[proxy].userData = userData;
+    nodes[proxy].height = 0;
+    insertLeaf(proxy);
+    proxyCount++;
+    return proxy;
+}
+
+void DynamicAabbTree::destroyProxy(uint32_t proxy) {
+    removeLeaf(proxy);
+    freeNode(proxy);
+    proxyCount--;
+}
+
+bool DynamicAabbTree::moveProxy(uint32_t proxy, const Aabb& aabb) {
+    if (nodes[proxy].aabb.contains(aabb)) {
+        return false;
+    }
+    removeLeaf(proxy);
+    nodes[proxy].aabb = aabb.expanded(FAT_MARGIN);
+    insertLeaf(proxy);
+    return true;
+}
+
+void DynamicAabbTree::insertLeaf(uint32_t leaf) {
+    if (root == NULL_NODE) {
+        root = leaf;
+        nodes[root].parent = NULL_NODE;
+        return;
+    }
+
+    // Find the best sibling: descend while that is cheaper than pairing with the whole subtree
+    const Aabb leafAabb = nodes[leaf].aabb;
+    uint32_t index = root;
+    while (!nodes[index].isLeaf()) {
+        const Node& node = nodes[index];
+        const float area = node.aabb.surfaceArea();
+        const float combinedArea = node.aabb.merged(leafAabb).surfaceArea();
+
+        // cost of a new parent for this node and the leaf, and the cost pushed down to the children
+        const float cost = 2.0f * combinedArea;
+        const float inheritanceCost = 2.0f * (combinedArea - area);
+
+        const auto descendCost = [&](uint32_t child) {
+            const Aabb& childAabb = nodes[child].aabb;
+            const float mergedArea = childAabb.merged(leafAabb).surfaceArea();
+            return (nodes[child].isLeaf() ? mergedArea : mergedArea - childAabb.surfaceArea()) + inheritanceCost;
+        };
+        const float cost1 = descendCost(node.child1);
+        const float cost2 = descendCost(node.child2);
+
+        if (cost < cost1 && cost < cost2) {
+            break;
+        }
+        index = cost1 < cost2 ? node.child1 : node.child2;
+    }
+    const uint32_t sibling = index;
+
+    // New parent of the sibling and the leaf
+    const uint32_t oldParent = nodes[sibling].parent;
+    const uint32_t newParent = allocateNode();
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].aabb = leafAabb.merged(nodes[sibling].aabb);
+    nodes[newParent].height = nodes[sibling].height + 1;
+    nodes[newParent].child1 = sibling;
+    nodes[newParent].child2 = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+
+    if (oldParent == NULL_NODE) {
+        root = newParent;
+    } else if (nodes[oldParent].child1 == sibling) {
+        nodes[oldParent].child1 = newParent;
+    } else {
+        nodes[oldParent].child2 = newParent;
+    }
+
+    refitAncestors(nodes[leaf].parent);
+}
+
+void DynamicAabbTree::removeLeaf(uint32_t leaf) {
+    if (leaf == root) {
+        root = NULL_NODE;
+        return;
+    }
+
+    // the sibling takes the place of the parent
+    const uint32_t parent = nodes[leaf].parent;
+    const uint32_t grandParent = nodes[parent].parent;
+    const uint32_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+    if (grandParent == NULL_NODE) {
+        root = sibling;
+        nodes[sibling].parent = NULL_NODE;
+        freeNode(parent);
+        return;
+    }
+
+    if (nodes[grandParent].child1 == parent) {
+        nodes[grandParent].child1 = sibling;
+    } else {
+        nodes[grandParent].child2 = sibling;
+    }
+    nodes[sibling].parent = grandParent;
+    freeNode(parent);
+
+    refitAncestors(grandParent);
+}
+
+void DynamicAabbTree::refitAncestors(uint32_t index) {
+    while (index != NULL_NODE) {
+        index = balance(index);
+
+        Node& node = nodes[index];
+        node.height = 1 + std::max(nodes[node.child1].height, nodes[node.child2].height);
+        node.aabb = nodes[node.child1].aabb.merged(nodes[node.child2].aabb);
+
+        index = node.parent;
+    }
+}
+
+uint32_t DynamicAabbTree::balance(uint32_t iA) {
+    // Rotates the taller child up when the children differ in height by more than one,
+    // returns the node now at the position of iA
+    Node& A = nodes[iA];
+    if (A.isLeaf() || A.height < 2) {
+        return iA;
+    }
+
+    const uint32_t iB = A.child1;
+    const uint32_t iC = A.child2;
+    Node& B = nodes[iB];
+    Node& C = nodes[iC];
+    const int heightDifference = C.height - B.height;
+
+    // rotates iChild (with children iF, iG) up into the place of A, other = the shorter child of A
+    const auto rotateUp = [&](uint32_t iChild, bool childIsFirst) {
+        Node& X = nodes[iChild];
+        const uint32_t iF = X.child1;
+        const uint32_t iG = X.child2;
+        Node& F = nodes[iF];
+        Node& G = nodes[iG];
+        const uint32_t iOther = childIsFirst ? A.child2 : A.child1;
+        Node& Other = nodes[iOther];
+
+        // X takes the place of A
+        X.child1 = iA;
+        X.parent = A.parent;
+        A.parent = iChild;
+        if (X.parent == NULL_NODE) {
+            root = iChild;
+        } else if (nodes[X.parent].child1 == iA) {
+            nodes[X.parent].child1 = iChild;
+        } else {
+            nodes[X.parent].child2 = iChild;
+        }
+
+        // the taller grandchild stays under X, the shorter one moves under A
+        uint32_t iKeep = iF;
+        uint32_t iMove = iG;
+        if (F.height < G.height) {
+            std::swap(iKeep, iMove);
+        }
+        X.child2 = iKeep;
+        if (childIsFirst) {
+            A.child1 = iMove;
+        } else {
+            A.child2 = iMove;
+        }
+        nodes[iMove].parent = iA;
+
+        A.aabb = Other.aabb.merged(nodes[iMove].aabb);
+        X.aabb = A.aabb.merged(nodes[iKeep].aabb);
+        A.height = 1 + std::max(Other.height, nodes[iMove].height);
+        X.height = 1 + std::max(A.height, nodes[iKeep].height);
+        return iChild;
+    };
+
+    if (heightDifference > 1) {
+        return rotateUp(iC, false);
+    }
+    if (heightDifference < -1) {
+        return rotateUp(iB, true);
+    }
+    return iA;
+}
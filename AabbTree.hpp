@@ -0,0 +1,150 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+struct Aabb {
+    glm::vec3 min{0.0f};
+    glm::vec3 max{0.0f};
+
+    bool contains(const Aabb& other) const {
+        return glm::all(glm::lessThanEqual(min, other.min)) && glm::all(glm::greaterThanEqual(max, other.max));
+    }
+    bool overlaps(const Aabb& other) const {
+        return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::greaterThanEqual(max, other.min));
+    }
+    Aabb merged(const Aabb& other) const { return { glm::min(min, other.min), glm::max(max, other.max) }; }
+    Aabb expanded(float margin) const { return { min - margin, max + margin }; }
+    float surfaceArea() const {
+        const glm::vec3 d = max - min;
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+};
+
+// Entry distance of a ray into a box (0 when the origin is inside), false = no hit
+// before maxDistance. normal = face through which the ray enters.
+bool intersectRayAabb(const glm::vec3& origin, const glm::vec3& direction, const Aabb& box, float maxDistance,
+                      float& distance, glm::vec3& normal);
+// Entry distance of a ray into a sphere, the ray starts outside
+bool intersectRaySphere(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& center, float radius,
+                        float maxDistance, float& distance);
+// First contact of a sphere moving along a ray with a box (exact, with rounded edges
+// and corners), distance 0 and normal = -direction when it starts touching
+bool intersectSweptSphereAabb(const glm::vec3& origin, const glm::vec3& direction, float radius, const Aabb& box,
+                              float maxDistance, float& distance, glm::vec3& normal);
+
+// Dynamic bounding volume hierarchy (after the b2DynamicTree of Box2D).
+//
+// Every proxy is a leaf with a fat box (the tight box grown by a margin), so a proxy
+// that moves a little keeps its leaf and only leaves that leave their fat box are
+// reinserted. Insertion descends along the cheapest surface area increase and the
+// tree is kept balanced with AVL rotations, so insert and remove are O(log n).
+// A proxy id is the index of its leaf and stays the same for the life of the proxy.
+class DynamicAabbTree {
+public:
+    static constexpr uint32_t NULL_NODE = UINT32_MAX;
+    static constexpr float FAT_MARGIN = 0.25f;
+
+    uint32_t createProxy(const Aabb& aabb, uint32_t userData);
+    void destroyProxy(uint32_t proxy);
+    // false when the box is still inside the fat box of the proxy (nothing to do)
+    bool moveProxy(uint32_t proxy, const Aabb& aabb);
+    void clear();
+
+    uint32_t getUserData(uint32_t proxy) const { return nodes[proxy].userData; }
+    const Aabb& getFatAabb(uint32_t proxy) const { return nodes[proxy].aabb; }
+    size_t getProxyCount() const { return proxyCount; }
+    int getHeight() const { return root == NULL_NODE ? 0 : nodes[root].height; }
+
+    // callback(userData) for every proxy whose fat box overlaps the box; return false to stop
+    template <typename F>
+    void queryOverlap(const Aabb& aabb, F&& callback) const;
+
+    // callback(userData, maxDistance) for every proxy whose fat box (grown by radius) the
+    // ray enters before maxDistance; returns the new maxDistance (its hit distance to clip
+    // the ray, maxDistance to go on, a negative value to stop). direction is normalized.
+    template <typename F>
+    void raycast(const glm::vec3& origin, const glm::vec3& direction, float radius, float maxDistance, F&& callback) const;
+
+private:
+    struct Node {
+        Aabb aabb;
+        uint32_t parent = NULL_NODE; // next free node while the node is free
+        uint32_t child1 = NULL_NODE;
+        uint32_t child2 = NULL_NODE;
+        int height = -1;             // 0 = leaf, -1 = free
+        uint32_t userData = 0;
+
+        bool isLeaf() const { return child1 == NULL_NODE; }
+    };
+
+    uint32_t allocateNode();
+    void freeNode(uint32_t node);
+    void insertLeaf(uint32_t leaf);
+    void removeLeaf(uint32_t leaf);
+    uint32_t balance(uint32_t node);
+    void refitAncestors(uint32_t node);
+
+    std::vector<Node> nodes;
+    uint32_t root = NULL_NODE;
+    uint32_t freeList = NULL_NODE;
+    size_t proxyCount = 0;
+    mutable std::vector<uint32_t> stack; // traversal scratch of the queries
+};
+
+template <typename F>
+void DynamicAabbTree::queryOverlap(const Aabb& aabb, F&& callback) const {
+    if (root == NULL_NODE) {
+        return;
+    }
+    stack.clear();
+    stack.push_back(root);
+    while (!stack.empty()) {
+        const Node& node = nodes[stack.back()];
+        stack.pop_back();
+        if (!node.aabb.overlaps(aabb)) {
+            continue;
+        }
+        if (node.isLeaf()) {
+            if (!callback(node.userData)) {
+                return;
+            }
+        } else {
+            stack.push_back(node.child1);
+            stack.push_back(node.child2);
+        }
+    }
+}
+
+template <typename F>
+void DynamicAabbTree::raycast(const glm::vec3& origin, const glm::vec3& direction, float radius, float maxDistance,
+                              F&& callback) const {
+    if (root == NULL_NODE) {
+        return;
+    }
+    stack.clear();
+    stack.push_back(root);
+    while (!stack.empty()) {
+        const Node& node = nodes[stack.back()];
+        stack.pop_back();
+
+        float distance;
+        glm::vec3 normal;
+        if (!intersectRayAabb(origin, direction, node.aabb.expanded(radius), maxDistance, distance, normal)) {
+            continue;
+        }
+        if (node.isLeaf()) {
+            const float clip = callback(node.userData, maxDistance);
+            if (clip < 0.0f) {
+                return;
+            }
+            maxDistance = std::min(maxDistance, clip);
+        } else {
+            stack.push_back(node.child1);
+            stack.push_back(node.child2);
+        }
+    }
+}
@@ -0,0 +1,283 @@
+#include "BatchRunner.hpp"
+#include "JobPool.hpp"
+#include "Headless.hpp"
+#include "CupcakeGame.hpp"
+#include "PhysicsWorker.hpp"
+#include "camera.hpp"
+#include "JsonRead.hpp"
+#include "Stats.hpp"
+#include <GLFW/glfw3.h>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+GamePacing parsePacing(const nlohmann::json& object) {
+    GamePacing pacing;
+    readJson(object, "name", pacing.name);
+    readJson(object, "speed", pacing.speed);
+    readJson(object, "request_interval", pacing.requestInterval);
+    readJson(object, "request_timeout", pacing.requestTimeout);
+    readJson(object, "quake_cooldown", pacing.quakeCooldown);
+    readJson(object, "quake_interval", pacing.quakeInterval);
+    readJson(object, "quake_duration", pacing.quakeDuration);
+    readJson(object, "start_money", pacing.startMoney);
+    readJson(object, "start_happiness", pacing.startHappiness);
+    readJson(object, "shot_interval", pacing.shotInterval);
+    return pacing;
+}
+
+PacingSummary summarize(const GamePacing& pacing, const GameResult* results, size_t count) {
+    PacingSummary summary;
+    summary.name = pacing.name;
+    summary.games = count;
+    if (count == 0) {
+        return summary;
+    }
+
+    std::vector<double> seconds;
+    seconds.reserve(count);
+    double delivered = 0.0, missed = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        const GameResult& result = results[i];
+        seconds.push_back(result.seconds);
+        summary.gameOvers += result.gameOver;
+        summary.outOfMoney += result.outOfMoney;
+        summary.meanSeconds += result.seconds;
+        summary.meanDeliveries += result.deliveries;
+        summary.meanMissed += result.missedDeliveries;
+        summary.meanWrong += result.wrongDeliveries;
+        summary.meanMoney += result.money;
+        summary.meanHappiness += result.happiness;
+        delivered += result.deliveries;
+        missed += result.missedDeliveries;
+    }
+    const double n = static_cast<double>(count);
+    summary.meanSeconds /= n;
+    summary.meanDeliveries /= n;
+    summary.meanMissed /= n;
+    summary.meanWrong /= n;
+    summary.meanMoney /= n;
+    summary.meanHappiness /= n;
+    summary.deliveryRate = delivered + missed > 0.0 ? delivered / (delivered + missed) : 0.0;
+
+    std::sort(seconds.begin(), seconds.end());
+    summary.minSeconds = seconds.front();
+    summary.medianSeconds = percentile(seconds, 0.5);
+    summary.p90Seconds = percentile(seconds, 0.9);
+    return summary;
+}
+
+}
+
+BatchConfig BatchConfig::load(const std::filesystem::path& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Nastaveni davky '" + path.string() + "' nelze nacist");
+    }
+    const nlohmann::json json = nlohmann::json::parse(file);
+
+    BatchConfig config;
+    readJson(json, "games", config.games);
+    readJson(json, "threads", config.threads);
+    readJson(json, "max_seconds", config.maxSeconds);
+    readJson(json, "seed", config.seed);
+    if (json.contains("step_rate") && json["step_rate"].is_number()) {
+        config.step = 1.0f / std::clamp(json["step_rate"].get<float>(), 10.0f, 1000.0f);
+    }
+    if (json.contains("output") && json["output"].is_string()) {
+        config.output = json["output"].get<std::string>();
+    }
+    if (json.contains("pacings") && json["pacings"].is_array()) {
+        for (const nlohmann::json& pacing : json["pacings"]) {
+            config.pacings.push_back(parsePacing(pacing));
+        }
+    }
+    if (config.pacings.empty()) {
+        config.pacings.push_back(GamePacing()); // the game as it ships
+    }
+    return config;
+}
+
+GameResult runBatchGame(const GamePacing& pacing, uint64_t seed, double maxSeconds, float step) {
+    CupcakeGame game(seed);
+    game.set_logging(false);
+    game.initialize();
+
+    GameState& state = game.get_game_state();
+    state.speed = pacing.speed;
+    state.request_interval = pacing.requestInterval;
+    state.request_timeout = pacing.requestTimeout;
+    state.quake_cooldown = pacing.quakeCooldown;
+    state.quake_interval = pacing.quakeInterval;
+    state.quake_duration = pacing.quakeDuration;
+    state.money = pacing.startMoney;
+    state.happiness = pacing.startHappiness;
+
+    // the pool already runs a game per core, the world steps inline and nothing needs particles
+    PhysicsWorker physics(false, false);
+    physics.setWorldBounds(glm::vec3(-100.0f, -5.0f, -300.0f), glm::vec3(100.0f, 100.0f, 100.0f));
+
+    Camera camera(glm::vec3(0.0f, 2.0f, 5.0f));
+    camera.MovementSpeed = 2.5f;
+    camera.MouseSensitivity = 0.1f;
+
+    game.spawn_initial_houses(&physics);
+    physics.submit();
+
+    HeadlessBot bot(pacing.shotInterval, false);
+    std::vector<InputEvent> events;
+    GameResult result;
+
+    const uint64_t maxSteps = static_cast<uint64_t>(std::llround(maxSeconds / step));
+    uint64_t steps = 0;
+    for (; steps < maxSteps && !game.is_game_over(); steps++) {
+        events.clear();
+        bot.update(step, game, camera, events);
+        for (const InputEvent& event : events) {
+            if (event.type == InputEventType::CURSOR) {
+                game.handle_mouse_move(&camera, event.x, event.y);
+            } else if (event.type == InputEventType::MOUSE_BUTTON && event.action == GLFW_PRESS) {
+                game.handle_mouse_click(&camera);
+                result.shots++;
+            }
+        }
+
+        physics.sync();
+        game.update(step, &camera, nullptr, nullptr, &physics);
+        game.spawn_houses_ahead(&camera, &physics);
+        physics.submit();
+    }
+    physics.sync();
+
+    result.seconds = steps * static_cast<double>(step);
+    result.gameOver = game.is_game_over();
+    result.outOfMoney = result.gameOver && state.money <= 0;
+    result.deliveries = state.deliveries;
+    result.missedDeliveries = state.missed_deliveries;
+    result.wrongDeliveries = state.wrong_deliveries;
+    result.money = state.money;
+    result.happiness = state.happiness;
+    return result;
+}
+
+BatchReport runBatch(const BatchConfig& config) {
+    // common random numbers: game i of every pacing sees the same houses and requests
+    // as long as the pacing lets it, so the pacings differ by less noise
+    std::vector<uint64_t> seeds(config.games);
+    RandomStream seedStream = RandomService::streamFor(config.seed, "batch");
+    for (uint64_t& seed : seeds) {
+        seed = (static_cast<uint64_t>(seedStream.next()) << 32) | seedStream.next();
+    }
+
+    std::vector<GameResult> results(config.pacings.size() * config.games);
+
+    JobPool pool(config.threads);
+    const auto start = std::chrono::high_resolution_clock::now();
+    for (size_t p = 0; p < config.pacings.size(); p++) {
+        for (size_t g = 0; g < config.games; g++) {
+            // every job writes only its own result
+            pool.submit([&, p, g] {
+                results[p * config.games + g] = runBatchGame(config.pacings[p], seeds[g], config.maxSeconds, config.step);
+            });
+        }
+    }
+    pool.wait();
+
+    BatchReport report;
+    report.wallSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    report.threads = pool.getThreadCount();
+    report.steals = pool.getStealCount();
+    report.games = results.size();
+    for (const GameResult& result : results) {
+        report.simulatedSeconds += result.seconds;
+    }
+    for (size_t p = 0; p < config.pacings.size(); p++) {
+        report.summaries.push_back(summarize(config.pacings[p], results.data() + p * config.games, config.games));
+    }
+    return report;
+}
+
+void BatchReport::print() const {
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "=== Davka her ===" << std::endl;
+    std::cout << games << " her za " << wallSeconds << " s na " << threads << " vlaknech: " << gamesPerSecond()
+              << " her/s, " << gamesPerSecondPerCore() << " her/s na jadro, "
+              << (wallSeconds > 0.0 ? simulatedSeconds / wallSeconds : 0.0) << " sim s / s (" << steals << " kradezi)"
+              << std::endl;
+    for (const PacingSummary& summary : summaries) {
+        std::cout << "  " << summary.name << ": konec " << summary.gameOvers << "/" << summary.games << " (penize "
+                  << summary.outOfMoney << "), delka prumer " << summary.meanSeconds << " s, median "
+                  << summary.medianSeconds << " s, p90 " << summary.p90Seconds << " s, doruceno "
+                  << summary.meanDeliveries << ", zmeskano " << summary.meanMissed << ", spatne " << summary.meanWrong
+                  << ", uspesnost " << summary.deliveryRate * 100.0 << " %" << std::endl;
+    }
+    std::cout << std::defaultfloat;
+}
+
+void BatchReport::write(const std::filesystem::path& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Vysledky davky '" + path.string() + "' nelze zapsat");
+    }
+
+    if (path.extension() == ".json") {
+        nlohmann::json json;
+        json["games"] = games;
+        json["threads"] = threads;
+        json["wall_seconds"] = wallSeconds;
+        json["simulated_seconds"] = simulatedSeconds;
+        json["games_per_second"] = gamesPerSecond();
+        json["games_per_second_per_core"] = gamesPerSecondPerCore();
+        json["pacings"] = nlohmann::json::array();
+        for (const PacingSummary& summary : summaries) {
+            json["pacings"].push_back({
+                { "name", summary.name },
+                { "games", summary.games },
+                { "game_overs", summary.gameOvers },
+                { "out_of_money", summary.outOfMoney },
+                { "mean_seconds", summary.meanSeconds },
+                { "min_seconds", summary.minSeconds },
+                { "median_seconds", summary.medianSeconds },
+                { "p90_seconds", summary.p90Seconds },
+                { "mean_deliveries", summary.meanDeliveries },
+                { "mean_missed", summary.meanMissed },
+                { "mean_wrong", summary.meanWrong },
+                { "delivery_rate", summary.deliveryRate },
+                { "mean_money", summary.meanMoney },
+                { "mean_happiness", summary.meanHappiness },
+            });
+        }
+        file << json.dump(2) << std::endl;
+        return;
+    }
+
+    file << "name,games,game_overs,out_of_money,mean_seconds,min_seconds,median_seconds,p90_seconds,"
+            "mean_deliveries,mean_missed,mean_wrong,delivery_rate,mean_money,mean_happiness\n";
+    for (const PacingSummary& summary : summaries) {
+        file << summary.name << ',' << summary.games << ',' << summary.gameOvers << ',' << summary.outOfMoney << ','
+             << summary.meanSeconds << ',' << summary.minSeconds << ',' << summary.medianSeconds << ','
+             << summary.p90Seconds << ',' << summary.meanDeliveries << ',' << summary.meanMissed << ','
+             << summary.meanWrong << ',' << summary.deliveryRate << ',' << summary.meanMoney << ','
+             << summary.meanHappiness << '\n';
+    }
+}
+
+int runBatchFromFile(const std::filesystem::path& path) {
+    const BatchConfig config = BatchConfig::load(path);
+    std::cout << "Davka: " << config.pacings.size() << " nastaveni x " << config.games << " her, max "
+              << config.maxSeconds << " s simulace" << std::endl;
+
+    const BatchReport report = runBatch(config);
+    report.print();
+    report.write(config.output);
+    std::cout << "Vysledky: " << config.output.string() << std::endl;
+    return EXIT_SUCCESS;
+}
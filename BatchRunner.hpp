@@ -0,0 +1,88 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <cstdint>
+#include <cstddef>
+
+// Pacing of one game, the GameState values a batch compares
+struct GamePacing {
+    std::string name = "default";
+    float speed = 8.0f;             // GameState::speed
+    float requestInterval = 5.0f;   // GameState::request_interval
+    float requestTimeout = 10.0f;   // GameState::request_timeout
+    float quakeCooldown = 30.0f;    // until the first quake
+    float quakeInterval = 25.0f;    // between quakes
+    float quakeDuration = 12.0f;
+    int startMoney = 50;            // CupcakeGame::initialize
+    int startHappiness = 50;
+    float shotInterval = 0.5f;      // bot: seconds between two shots at one request
+};
+
+struct BatchConfig {
+    size_t games = 1000;       // per pacing
+    size_t threads = 0;        // 0 = one per hardware thread
+    double maxSeconds = 600.0; // simulated, a game still running then counts as survived
+    float step = 1.0f / 60.0f;
+    uint64_t seed = 1;         // game i gets the same seed under every pacing
+    std::filesystem::path output = "batch_results.csv"; // .json or .csv
+    std::vector<GamePacing> pacings;
+
+    // "games", "threads", "max_seconds", "step_rate", "seed", "output" and "pacings",
+    // a list of objects with the GamePacing fields in snake case; missing ones keep the
+    // defaults. Throws when the file cannot be read.
+    static BatchConfig load(const std::filesystem::path& path);
+};
+
+struct GameResult {
+    double seconds = 0.0; // simulated until game over or maxSeconds
+    bool gameOver = false;
+    bool outOfMoney = false;
+    int deliveries = 0;
+    int missedDeliveries = 0;
+    int wrongDeliveries = 0;
+    int shots = 0;
+    int money = 0;     // at the end
+    int happiness = 0;
+};
+
+struct PacingSummary {
+    std::string name;
+    size_t games = 0;
+    size_t gameOvers = 0;
+    size_t outOfMoney = 0; // of the game overs, the rest ran out of happiness
+    double meanSeconds = 0.0, minSeconds = 0.0, medianSeconds = 0.0, p90Seconds = 0.0;
+    double meanDeliveries = 0.0;
+    double meanMissed = 0.0;
+    double meanWrong = 0.0;
+    double deliveryRate = 0.0; // delivered of the requests that ended
+    double meanMoney = 0.0;
+    double meanHappiness = 0.0;
+};
+
+struct BatchReport {
+    std::vector<PacingSummary> summaries;
+    size_t games = 0;
+    size_t threads = 0;
+    size_t steals = 0; // jobs the pool moved between workers
+    double wallSeconds = 0.0;
+    double simulatedSeconds = 0.0;
+
+    double gamesPerSecond() const { return wallSeconds > 0.0 ? games / wallSeconds : 0.0; }
+    double gamesPerSecondPerCore() const { return threads > 0 ? gamesPerSecond() / threads : 0.0; }
+
+    void print() const;
+    void write(const std::filesystem::path& path) const; // JSON by extension, CSV otherwise
+};
+
+// One whole game without a window: its own CupcakeGame with streams of the given seed,
+// its own physics world (stepped inline, no particle grid) and the HeadlessBot
+// playing. Safe to call from many threads at once.
+GameResult runBatchGame(const GamePacing& pacing, uint64_t seed, double maxSeconds, float step);
+
+// Monte Carlo runs of every pacing of the config on a JobPool, one job per game
+BatchReport runBatch(const BatchConfig& config);
+
+// --batch mode of the application, returns the exit code
+int runBatchFromFile(const std::filesystem::path& path);
@@ -0,0 +1,37 @@
+#include "CpuFeatures.hpp"
+
+#if defined(SIMD_AVX2_KERNELS) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+
+bool detectAvx2() {
+#if defined(SIMD_AVX2_KERNELS) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    // AVX and XSAVE enabled by the OS, which then also saves the xmm and ymm registers
+    __cpuid(info, 1);
+    const int osxsaveAvx = (1 << 27) | (1 << 28);
+    if ((info[2] & osxsaveAvx) != osxsaveAvx || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif defined(SIMD_AVX2_KERNELS)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+}
+
+bool cpuHasAvx2() {
+    static const bool avx2 = detectAvx2();
+    return avx2;
+}
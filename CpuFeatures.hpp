@@ -0,0 +1,21 @@
+#pragma once
+
+// Instruction sets of the CPU the game runs on.
+//
+// The build targets plain x86-64 (SSE2). 64-bit builds compile the AVX2 kernels next
+// to the SSE2 ones and choose between them at run time, so the game still starts on a
+// CPU without AVX2. MSVC emits the AVX2 intrinsics without /arch:AVX2; GCC and Clang
+// need SIMD_TARGET_AVX2 on every function that uses them. Nothing else in such a
+// function may be compiled for AVX2, so it stays in the kernel files only.
+#if defined(_M_X64) || defined(__x86_64__)
+#define SIMD_AVX2_KERNELS
+#if defined(_MSC_VER) && !defined(__clang__)
+#define SIMD_TARGET_AVX2
+#else
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// CPU and operating system (which has to save the 256-bit registers) support AVX2,
+// detected on the first call
+bool cpuHasAvx2();
@@ -3,22 +3,34 @@
 #include "camera.hpp"
 #include "AudioEngine.hpp"
 #include "ParticleSystem.hpp"
-#include "PhysicsSystem.hpp"
+#include "PhysicsWorker.hpp"
 
 #include <iostream>
 #include <algorithm>
 #include <glm/gtx/norm.hpp>
 
 CupcakeGame::CupcakeGame()
-    : rng(std::random_device{}()), unirand(0.0f, 1.0f)
+    : CupcakeGame(RandomService::instance().getMasterSeed())
 {
-    this->house_generator = std::make_unique<HouseGenerator>();
-    this->house_models = {"bambo_house", "cyprys_house", "building"};
+}
+
+CupcakeGame::CupcakeGame(uint64_t master_seed)
+    : rng(RandomService::streamFor(master_seed, "game")), spawn_rng(RandomService::streamFor(master_seed, "houses.spawn"))
+{
+    this->house_generator = std::make_unique<HouseGenerator>(master_seed);
+    // {"bambo_house", "cyprys_house", "building"}
+    this->spawn_archetypes = {house_archetypes.intern("bambo_house")};
     this->cached_physics_system = nullptr;
 }
 
 CupcakeGame::~CupcakeGame() {}
 
+void CupcakeGame::set_logging(bool enabled)
+{
+    this->logging = enabled;
+    this->house_generator->setLogging(enabled);
+}
+
 void CupcakeGame::initialize()
 {
     this->game_state = GameState();
@@ -56,12 +68,14 @@ void CupcakeGame::restart_game()
     if (cached_physics_system)
     {
         cached_physics_system->clearCollisionObjects();
+        cached_physics_system->setWorldOffset(game_state.world_offset);
     }
 
-    std::cout << "Hra restartovana!" << std::endl;
+    if (logging)
+        std::cout << "Hra restartovana!" << std::endl;
 }
 
-glm::vec3 CupcakeGame::calculate_movement(float delta, Camera *camera, PhysicsSystem *physics_system)
+glm::vec3 CupcakeGame::calculate_movement(float delta, Camera *camera)
 {
     if (!camera || !game_state.active)
     {
@@ -74,8 +88,13 @@ glm::vec3 CupcakeGame::calculate_movement(float delta, Camera *camera, PhysicsSy
     return world_movement;
 }
 
+glm::vec3 CupcakeGame::get_render_offset(float alpha) const
+{
+    return (alpha - 1.0f) * game_state.step_movement;
+}
+
 void CupcakeGame::update(float delta, Camera *camera, AudioEngine *audio_engine,
-                         ParticleSystem *particle_system, PhysicsSystem *physics_system)
+                         ParticleSystem *particle_system, PhysicsWorker *physics_system)
 {
     if (!game_state.active)
         return;
@@ -84,58 +103,138 @@ void CupcakeGame::update(float delta, Camera *camera, AudioEngine *audio_engine,
     if (game_state.money <= 0 || game_state.happiness <= 0)
     {
         game_state.active = false;
-        std::cout << "Game Over! ";
-        if (game_state.money <= 0)
-            std::cout << "Dosly penize!";
-        if (game_state.happiness <= 0)
-            std::cout << "Doslo spokojenost!";
-        std::cout << std::endl;
+        if (logging)
+        {
+            std::cout << "Game Over! ";
+            if (game_state.money <= 0)
+                std::cout << "Dosly penize!";
+            if (game_state.happiness <= 0)
+                std::cout << "Doslo spokojenost!";
+            std::cout << std::endl;
+        }
         return;
     }
 
-    glm::vec3 world_movement = calculate_movement(delta, camera, physics_system);
+    glm::vec3 world_movement = calculate_movement(delta, camera);
+    game_state.world_offset += world_movement;
+    game_state.step_movement = world_movement;
+    if (physics_system)
+    {
+        physics_system->setWorldOffset(game_state.world_offset); // teren a kolize domu jedou se svetem
+    }
 
-    for (auto &house : game_state.houses)
+    auto &houses = game_state.houses;
+    for (glm::vec3 &position : houses.positions)
     {
-        house.position += world_movement;
+        position += world_movement;
     }
     for (auto &seg : game_state.road_segments)
     {
         seg += world_movement;
     }
-    for (auto &projectile : game_state.projectiles)
+    for (Projectile &projectile : game_state.projectiles)
     {
-        if (projectile)
-        {
-            projectile->position += world_movement;
-        }
+        projectile.position += world_movement;
     }
 
     house_generator->updateRequests(delta, this->game_state, camera);
-    update_earthquake(delta, camera, audio_engine, particle_system);
+    update_earthquake(delta, camera, audio_engine);
     update_projectiles(delta);
     update_houses(camera, physics_system);
 
-    if (particle_system)
+    for (size_t i = 0; i < houses.size(); ++i)
     {
-        for (auto &house : game_state.houses)
+        float &timer = houses.effectTimers[i];
+        if (timer > 0.0f)
         {
-            if (house.delivery_effect_timer > 0.0f)
+            timer -= delta;
+            if (timer <= 0.0f)
             {
-                house.delivery_effect_timer -= delta;
-                glm::vec3 emitterPos = house.position + glm::vec3(0.0f, house.indicator_height * 0.7f, 0.0f);
-                particle_system->set_emitter_position(emitterPos);
-                particle_system->emit(2);
-                if (house.delivery_effect_timer <= 0.0f)
-                {
-                    house.delivered = false;
-                }
+                houses.flags[i] &= ~HOUSE_DELIVERED;
             }
         }
     }
+
+    update_particle_emitters(particle_system);
+}
+
+void CupcakeGame::update_particle_emitters(ParticleSystem *particle_system)
+{
+    if (!particle_system)
+    {
+        delivered_houses.clear();
+        return;
+    }
+
+    // oslava dodavky: jeden emitor na dum, dokud bezi casovac efektu
+    const auto &houses = game_state.houses;
+    for (size_t e = 0; e < delivery_emitters.size();)
+    {
+        const size_t index = houses.indexOf(delivery_emitters[e].house);
+        if (index == SIZE_MAX || houses.effectTimers[index] <= 0.0f)
+        {
+            particle_system->destroyEmitter(delivery_emitters[e].emitter);
+            delivery_emitters[e] = delivery_emitters.back();
+            delivery_emitters.pop_back();
+            continue;
+        }
+        const float height = house_archetypes.get(houses.archetypes[index]).indicatorHeight * 0.7f;
+        particle_system->setEmitterPosition(delivery_emitters[e].emitter, houses.positions[index] + glm::vec3(0.0f, height, 0.0f));
+        ++e;
+    }
+
+    for (HouseHandle handle : delivered_houses)
+    {
+        const size_t index = houses.indexOf(handle);
+        if (index == SIZE_MAX)
+            continue;
+
+        const float height = house_archetypes.get(houses.archetypes[index]).indicatorHeight * 0.7f;
+        const glm::vec3 position = houses.positions[index] + glm::vec3(0.0f, height, 0.0f);
+
+        ParticleEmitterDesc desc = ParticleEmitterDesc::defaults(ParticleType::GLOW);
+        desc.position = position;
+        desc.rate = 120.0f; // 2 per frame at 60 FPS
+        desc.priority = 10; // prednost pred kourem pri zemetreseni
+        delivery_emitters.push_back({handle, particle_system->createEmitter(desc)});
+
+        // jednorazovy ohnostroj jisker pri doruceni
+        ParticleEmitterDesc sparks = ParticleEmitterDesc::defaults(ParticleType::SPARK);
+        sparks.position = position;
+        sparks.priority = 10;
+        particle_system->emit(sparks, 80);
+    }
+    delivered_houses.clear();
+
+    // kour ze silnice po celou dobu zemetreseni
+    if (!particle_system->getEmitter(quake_emitter))
+    {
+        ParticleEmitterDesc desc = ParticleEmitterDesc::defaults(ParticleType::SMOKE);
+        desc.active = false;
+        quake_emitter = particle_system->createEmitter(desc);
+    }
+
+    particle_system->setEmitterActive(quake_emitter, game_state.quake_active && !game_state.road_segments.empty());
+    ParticleEmitterDesc *quake = particle_system->getEmitter(quake_emitter);
+    if (quake->active)
+    {
+        float minZ = game_state.road_segments.front().z;
+        float maxZ = minZ;
+        for (const auto &segment : game_state.road_segments)
+        {
+            minZ = std::min(minZ, segment.z);
+            maxZ = std::max(maxZ, segment.z);
+        }
+
+        // cela silnice, 5 castic na segment za snimek pri 60 FPS
+        quake->shape = EmitterShape::BOX;
+        quake->position = glm::vec3(0.0f, 0.35f, (minZ + maxZ) * 0.5f);
+        quake->extents = glm::vec3(game_state.road_segment_width * 0.5f, 0.25f, (maxZ - minZ + game_state.road_segment_length) * 0.5f);
+        quake->rate = 300.0f * static_cast<float>(game_state.road_segments.size());
+    }
 }
 
-void CupcakeGame::update_houses(Camera *camera, PhysicsSystem *physics_system)
+void CupcakeGame::update_houses(Camera *camera, PhysicsWorker *physics_system)
 {
     if (!camera)
         return;
@@ -159,22 +258,80 @@ void CupcakeGame::update_houses(Camera *camera, PhysicsSystem *physics_system)
 
     const float house_removal_z = camera->Position.z + 30.0f;
 
-    auto removal_begin_it = std::remove_if(
-        game_state.houses.begin(), game_state.houses.end(),
-        [&](const House &h)
+    // domy jsou serazene podle z, projete jsou na zacatku
+    auto &houses = game_state.houses;
+    const size_t passed = houses.countBehind(house_removal_z);
+    if (physics_system)
+    {
+        for (size_t i = 0; i < passed; ++i)
         {
-            return h.position.z > house_removal_z;
-        });
+            physics_system->removeCollisionObject(houses.colliders[i]);
+        }
+    }
+    houses.popFront(passed);
+}
 
-    if (physics_system)
+void CupcakeGame::spawn_house_row(float z, PhysicsWorker *physics_system)
+{
+    const float house_side_offset = 10.0f;
+
+    for (int row = 0; row < game_state.house_rows; ++row)
     {
-        for (auto it = removal_begin_it; it != game_state.houses.end(); ++it)
+        const float row_offset = row * game_state.house_row_spacing; // dalsi rady dal od silnice
+
+        // leva strana
+        if (spawn_rng.nextFloat() > empty_plot_probability)
         {
-            physics_system->remove_collision_object(it->position);
+            const ArchetypeId archetype = spawn_archetypes[spawn_rng.index(spawn_archetypes.size())]; // nahodny dum
+            add_house(archetype, glm::vec3(-house_side_offset - 10.0f - row_offset, 0.0f, z), physics_system);
+        }
+
+        // prava strana
+        if (spawn_rng.nextFloat() > empty_plot_probability)
+        {
+            const ArchetypeId archetype = spawn_archetypes[spawn_rng.index(spawn_archetypes.size())]; // nahodny dum
+            add_house(archetype, glm::vec3(house_side_offset + row_offset, 0.0f, z), physics_system);
         }
     }
+}
 
-    game_state.houses.erase(removal_begin_it, game_state.houses.end());
+void CupcakeGame::spawn_initial_houses(PhysicsWorker *physics_system)
+{
+    float z = -15.0f;
+    for (int i = 0; i < 20; ++i)
+    {
+        spawn_house_row(z, physics_system);
+        z -= game_state.house_spacing;
+    }
+}
+
+void CupcakeGame::spawn_houses_ahead(const Camera *camera, PhysicsWorker *physics_system)
+{
+    if (!camera)
+        return;
+
+    // posledni dum je nejdal (domy jsou serazene podle z)
+    const HouseRegistry &houses = game_state.houses;
+    const float farthest_z = houses.empty() ? camera->Position.z : std::min(camera->Position.z, houses.positions[houses.size() - 1].z);
+
+    // generovani novych domu, pokud je kamera blizko k nejzazsimu domu
+    if (camera->Position.z - farthest_z < 100.0f)
+    {
+        spawn_house_row(farthest_z - game_state.house_spacing, physics_system);
+    }
+}
+
+HouseHandle CupcakeGame::add_house(ArchetypeId archetype, const glm::vec3 &position, PhysicsWorker *physics_system)
+{
+    const glm::vec3 half_extents = house_archetypes.get(archetype).halfExtents;
+    CollisionHandle collider;
+    if (physics_system)
+    {
+        // kolize zustava v prostoru silnice, svet se posouva pres setWorldOffset
+        const glm::vec3 road_position = position - game_state.world_offset;
+        collider = physics_system->addCollisionObject({CollisionType::BOX, road_position, half_extents * 2.0f}); // size = cele rozmery
+    }
+    return game_state.houses.create(game_state.next_house_id++, archetype, position, half_extents, collider);
 }
 
 void CupcakeGame::handle_mouse_click(Camera *camera)
@@ -184,98 +341,133 @@ void CupcakeGame::handle_mouse_click(Camera *camera)
 
     if (game_state.money < 10)
     {
-        std::cout << "Nedostatek penez pro vystrelebi cupcaku!" << std::endl;
+        if (logging)
+            std::cout << "Nedostatek penez pro vystrelebi cupcaku!" << std::endl;
         return;
     }
+    if (game_state.projectiles.full())
+    {
+        return; // vsechny cupcaky jsou ve vzduchu
+    }
 
     // Cena za vystrel
     game_state.money -= 10;
     glm::vec3 projectile_position = camera->Position + camera->Front * 2.0f;
     glm::vec3 projectile_velocity = camera->Front * 50.0f;
-    auto projectile = std::make_unique<Projectile>(projectile_position, projectile_velocity, 0.3f);
-    game_state.projectiles.push_back(std::move(projectile));
+    game_state.projectiles.spawn(projectile_position, projectile_velocity, 0.3f);
+}
+
+void CupcakeGame::handle_mouse_move(Camera *camera, float xoffset, float yoffset)
+{
+    if (!camera)
+        return;
+
+    camera->ProcessMouseMovement(xoffset, yoffset);
+
+    if (game_state.active)
+    {
+        const float steeringSensitivity = 0.01f;
+        const float maxSteeringSpeed = 15.0f;
+
+        float lateralMovement = xoffset * steeringSensitivity;
+        lateralMovement = glm::clamp(lateralMovement, -maxSteeringSpeed, maxSteeringSpeed);
+
+        glm::vec3 rightVector = camera->Right;
+        glm::vec3 movement = rightVector * lateralMovement;
+
+        camera->Position += movement;
+    }
 }
 
 void CupcakeGame::update_projectiles(float deltaTime)
 {
-    for (auto &projectile : game_state.projectiles)
+    // pohyb projektilu, obalka drahy za krok (swept sphere) jde do davky
+    auto &projectiles = game_state.projectiles;
+    projectile_bounds.clear();
+    for (size_t i = 0; i < projectiles.size(); ++i)
     {
-        if (!projectile || !projectile->alive)
+        Projectile &projectile = projectiles[i];
+        if (!projectile.alive)
             continue;
 
-        projectile->update(deltaTime);
+        projectile.update(deltaTime);
 
-        for (auto &house : game_state.houses)
-        {
-            if (house.delivered)
-                continue;
+        const glm::vec3 path_min = glm::min(projectile.previousPosition, projectile.position) - projectile.radius;
+        const glm::vec3 path_max = glm::max(projectile.previousPosition, projectile.position) + projectile.radius;
+        projectile_bounds.add(path_min, path_max, static_cast<uint32_t>(i));
+    }
 
-            // AABB detekce kolize
-            glm::vec3 boxMin = house.position - house.half_extents;
-            glm::vec3 boxMax = house.position + house.half_extents;
+    // dodane domy cupcaky propousti
+    auto &houses = game_state.houses;
+    house_bounds.clear();
+    for (size_t i = 0; i < houses.size(); ++i)
+    {
+        if (!(houses.flags[i] & HOUSE_DELIVERED))
+            house_bounds.add(houses.positions[i] - houses.halfExtents[i], houses.positions[i] + houses.halfExtents[i], static_cast<uint32_t>(i));
+    }
 
-            glm::vec3 closestPoint = glm::clamp(projectile->position, boxMin, boxMax);
+    // vsechny projektily proti vsem domum v jednom pruchodu (AVX2, ma-li ho procesor), pary jsou serazene podle projektilu
+    projectile_hits.clear();
+    findOverlaps(projectile_bounds, house_bounds, projectile_hits);
 
-            float distanceSq = glm::distance2(projectile->position, closestPoint);
-            if (distanceSq < (projectile->radius * projectile->radius))
+    for (size_t first = 0; first < projectile_hits.size();)
+    {
+        const uint32_t query = projectile_hits[first].query;
+        Projectile &projectile = projectiles[projectile_bounds.userData[query]];
+
+        // presny cas dopadu (swept sphere), vyhrava nejblizsi dum
+        const glm::vec3 step = projectile.position - projectile.previousPosition;
+        const float length = glm::length(step);
+        const glm::vec3 direction = length > 0.0f ? step / length : glm::vec3(0.0f, -1.0f, 0.0f);
+        size_t hit_house = SIZE_MAX;
+        float hit_distance = length;
+        for (; first < projectile_hits.size() && projectile_hits[first].query == query; ++first)
+        {
+            const size_t house = house_bounds.userData[projectile_hits[first].target];
+            if (houses.flags[house] & HOUSE_DELIVERED)
+                continue; // dodany jinym cupcakem v tomto kroku
+
+            float distance;
+            glm::vec3 normal;
+            const Aabb box{houses.positions[house] - houses.halfExtents[house], houses.positions[house] + houses.halfExtents[house]};
+            if (intersectSweptSphereAabb(projectile.previousPosition, direction, projectile.radius, box, hit_distance, distance, normal) &&
+                (hit_house == SIZE_MAX || distance < hit_distance))
             {
-
-                projectile->alive = false; // neaktivni cupcake
-
-                if (house.requesting)
-                {                           // uspesna dodavka
-                    game_state.money += 20; // +20 penez (-10 naklad = +10 zisk)
-                    game_state.happiness = std::min(100, game_state.happiness + 10);
-
-                    house.requesting = false;
-                    house.delivered = true;
-                    house.delivery_effect_timer = 2.5f; // particle effect casovac
-
-                    game_state.requesting_house_id = -1;
-                    game_state.request_time_left = 0.0f;
-                }
-                else
-                { // spatna dodavka
-                    game_state.happiness = std::max(0, game_state.happiness - 10);
-                }
-                break;
+                hit_house = house;
+                hit_distance = distance;
             }
         }
-    }
+        if (hit_house == SIZE_MAX)
+            continue;
 
-    // odstraneni neaktivnich projektilu
-    game_state.projectiles.erase(
-        std::remove_if(game_state.projectiles.begin(), game_state.projectiles.end(),
-                       [](const std::unique_ptr<Projectile> &p)
-                       {
-                           return !p || !p->alive;
-                       }),
-        game_state.projectiles.end());
-}
+        projectile.position = projectile.previousPosition + direction * hit_distance; // misto dopadu
+        projectile.alive = false;                                                     // neaktivni cupcake
 
-glm::vec3 CupcakeGame::get_house_extents(const std::string &model_name)
-{
-    if (model_name == "bambo_house")
-        return glm::vec3(4.0f, 6.0f, 4.0f);
-    if (model_name == "cyprys_house")
-        return glm::vec3(4.5f, 7.0f, 4.5f);
-    if (model_name == "building")
-        return glm::vec3(6.0f, 9.0f, 6.0f);
-    return glm::vec3(3.5f, 5.0f, 3.5f);
-}
+        if (houses.flags[hit_house] & HOUSE_REQUESTING)
+        {                           // uspesna dodavka
+            game_state.money += 20; // +20 penez (-10 naklad = +10 zisk)
+            game_state.happiness = std::min(100, game_state.happiness + 10);
 
-float CupcakeGame::get_indicator_height(const std::string &modelName)
-{
-    if (modelName == "bambo_house")
-        return 8.0f;
-    if (modelName == "cyprys_house")
-        return 9.0f;
-    if (modelName == "building")
-        return 12.0f;
-    return 7.0f;
+            houses.flags[hit_house] = (houses.flags[hit_house] & ~HOUSE_REQUESTING) | HOUSE_DELIVERED;
+            houses.effectTimers[hit_house] = 2.5f; // particle effect casovac
+            delivered_houses.push_back(houses.handleAt(hit_house));
+
+            game_state.requesting_house = HouseHandle();
+            game_state.request_time_left = 0.0f;
+            game_state.deliveries++;
+        }
+        else
+        { // spatna dodavka
+            game_state.happiness = std::max(0, game_state.happiness - 10);
+            game_state.wrong_deliveries++;
+        }
+    }
+
+    // odstraneni neaktivnich projektilu
+    projectiles.removeDead();
 }
 
-void CupcakeGame::update_movement(float delta, Camera *camera, PhysicsSystem *physics_system)
+void CupcakeGame::update_movement(float delta, Camera *camera, PhysicsWorker *physics_system)
 {
     if (!camera || !game_state.active)
         return;
@@ -283,7 +475,7 @@ void CupcakeGame::update_movement(float delta, Camera *camera, PhysicsSystem *ph
     glm::vec3 movement = glm::vec3(0.0f, 0.0f, -moveSpeed);
     if (physics_system)
     {
-        glm::vec3 actualMovement = physics_system->moveCamera(*camera, movement);
+        glm::vec3 actualMovement = physics_system->getWorld().moveCamera(*camera, movement); // stav po poslednim kroku
         camera->Position += actualMovement;
     }
     else
@@ -292,7 +484,7 @@ void CupcakeGame::update_movement(float delta, Camera *camera, PhysicsSystem *ph
     }
 }
 
-void CupcakeGame::update_earthquake(float delta, Camera *camera, AudioEngine *audio_engine, ParticleSystem *particle_system)
+void CupcakeGame::update_earthquake(float delta, Camera *camera, AudioEngine *audio_engine)
 {
     if (!camera)
         return;
@@ -307,17 +499,19 @@ void CupcakeGame::update_earthquake(float delta, Camera *camera, AudioEngine *au
         
         // Store relative offset from camera instead of absolute position
         game_state.quake_relative_offset = glm::vec3(
-            (unirand(rng) - 0.5f) * 50.0f, 0.0f, (unirand(rng) - 0.5f) * 50.0f);
+            (rng.nextFloat() - 0.5f) * 50.0f, 0.0f, (rng.nextFloat() - 0.5f) * 50.0f);
         game_state.quake_epicenter = camera->Position + game_state.quake_relative_offset;
         
-        std::cout << "Earthquake started! Relative offset: (" << game_state.quake_relative_offset.x << ", " << game_state.quake_relative_offset.y << ", " << game_state.quake_relative_offset.z << ")" << std::endl;
+        if (logging)
+            std::cout << "Earthquake started! Relative offset: (" << game_state.quake_relative_offset.x << ", " << game_state.quake_relative_offset.y << ", " << game_state.quake_relative_offset.z << ")" << std::endl;
         if (audio_engine && !this->quake_sound_playing)
         {
             if (audio_engine->playLoop3D("resources/audio/052256_cracking-earthquake-cracking-soil-cracking-stone-86770.wav", game_state.quake_epicenter, &this->quake_sound_handle))
             {
                 audio_engine->setSoundVolume(this->quake_sound_handle, 1.5f);
                 this->quake_sound_playing = true;
-                std::cout << "Earthquake sound started with increased volume" << std::endl;
+                if (logging)
+                    std::cout << "Earthquake sound started with increased volume" << std::endl;
             }
         }
     }
@@ -327,12 +521,13 @@ void CupcakeGame::update_earthquake(float delta, Camera *camera, AudioEngine *au
         if (game_state.quake_time_left <= 0.0f)
         {
             game_state.quake_active = false;
-            game_state.quake_cooldown = 25.0f;
+            game_state.quake_cooldown = game_state.quake_interval;
             if (audio_engine && this->quake_sound_playing)
             {
                 audio_engine->stop_sound(this->quake_sound_handle);
                 this->quake_sound_playing = false;
-                std::cout << "Earthquake sound stopped" << std::endl;
+                if (logging)
+                    std::cout << "Earthquake sound stopped" << std::endl;
             }
         }
         else
@@ -344,23 +539,6 @@ void CupcakeGame::update_earthquake(float delta, Camera *camera, AudioEngine *au
                 game_state.quake_epicenter = camera->Position + game_state.quake_relative_offset;
                 audio_engine->setSoundPosition(this->quake_sound_handle, game_state.quake_epicenter);
             }
-
-            if (particle_system)
-            {
-                for (const auto &segment : game_state.road_segments)
-                {
-                    float halfWidth = game_state.road_segment_width * 0.5f;
-                    float halfLength = game_state.road_segment_length * 0.5f;
-
-                    glm::vec3 pos = glm::vec3(
-                        (unirand(rng) - 0.5f) * game_state.road_segment_width,
-                        0.1f,
-                        segment.z + (unirand(rng) - 0.5f) * game_state.road_segment_length);
-
-                    particle_system->set_emitter_position(pos);
-                    particle_system->emit_smoke(5);
-                }
-            }
         }
     }
 }
\ No newline at end of file
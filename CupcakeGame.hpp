@@ -3,27 +3,18 @@
 #include <vector>
 #include <string>
 #include <memory>
-#include <random>
 #include <glm/glm.hpp>
 #include "HouseGenerator.hpp"
 #include "Projectile.hpp"
+#include "ParticleEmitter.hpp"
+#include "Random.hpp"
+#include "PhysicsWorker.hpp"
+#include "AabbBatch.hpp"
+#include "HouseRegistry.hpp"
 
 class Camera;
 class AudioEngine;
 class ParticleSystem;
-class PhysicsSystem;
-
-struct House
-{
-   int id = -1;
-   glm::vec3 position{0.0f};
-   std::string modelName;
-   glm::vec3 half_extents{1.0f};
-   float indicator_height = 7.0f;
-   bool requesting = false;
-   bool delivered = false;
-   float delivery_effect_timer = 0.0f;
-};
 
 struct GameState
 {
@@ -33,7 +24,7 @@ struct GameState
    float speed = 8.0f;
    float max_speed = 30.0f;
    int next_house_id = 0;
-   int requesting_house_id = -1;
+   HouseHandle requesting_house; // invalid when no house waits
    float request_timeout = 10.0f;
    float request_time_left = 0.0f;
    float request_interval = 5.0f;
@@ -41,61 +32,100 @@ struct GameState
    float pacing_timer = 0.0f;
    float pacing_step = 10.0f;
 
+   glm::vec3 world_offset{0.0f}; // accumulated world movement, world - world_offset is static "road space"
+   glm::vec3 step_movement{0.0f}; // world movement of the last update step (render interpolation)
+
    std::vector<glm::vec3> road_segments;
    int road_segment_count = 30;
    float road_segment_length = 10.0f;
    float road_segment_width = 10.0f;
    float house_offset_x = 12.0f;
    float house_spacing = 18.0f;
+   int house_rows = 1;              // houses behind each other on each side of the road
+   float house_row_spacing = 12.0f; // between the rows, outwards from the road
 
-   std::vector<House> houses;
-   std::vector<std::unique_ptr<Projectile>> projectiles;
+   HouseRegistry houses; // components of all houses, see HouseRegistry.hpp
+   ProjectilePool projectiles; // contiguous, no allocation per shot
 
    bool quake_active = false;
    float quake_timer = 0.0f;
-   float quake_cooldown = 30.0f;
+   float quake_cooldown = 30.0f; // until the next quake, the first one included
+   float quake_interval = 25.0f; // cooldown after a quake
    float quake_time_left = 0.0f;
    float quake_duration = 12.0f;
    float quake_amplitude = 0.05f;
    glm::vec3 quake_epicenter{0.0f};
    glm::vec3 quake_relative_offset{0.0f}; // Offset relative to camera for consistent audio
-   std::mt19937 rng{std::random_device{}()};
-   std::uniform_real_distribution<float> unirand{0.0f, 1.0f};
+
+   // statistics of the game (headless report)
+   int deliveries = 0;
+   int missed_deliveries = 0; // request timed out
+   int wrong_deliveries = 0;  // cupcake hit a house that did not ask
 };
 
 class CupcakeGame
 {
 public:
    CupcakeGame();
+   explicit CupcakeGame(uint64_t master_seed); // own streams, independent of the RandomService (batch runs)
    ~CupcakeGame();
 
    void initialize();
-   glm::vec3 calculate_movement(float delta, Camera *camera, PhysicsSystem *physics_system);
-   void update(float delta, Camera *camera, AudioEngine *audio_engine, ParticleSystem *particle_system, PhysicsSystem *physics_system);
+   glm::vec3 calculate_movement(float delta, Camera *camera);
+   void update(float delta, Camera *camera, AudioEngine *audio_engine, ParticleSystem *particle_system, PhysicsWorker *physics_system);
    void handle_mouse_click(Camera *camera);
+   void handle_mouse_move(Camera *camera, float xoffset, float yoffset); // otoceni kamery a rizeni do stran
+   // shift of the scrolling world between the last step and the rendered moment (alpha of the TimeService)
+   glm::vec3 get_render_offset(float alpha) const;
    GameState &get_game_state() { return game_state; }
-   glm::vec3 get_house_extents(const std::string &model_name);
-   float get_indicator_height(const std::string &model_name);
+   const GameState &get_game_state() const { return game_state; }
+   HouseArchetypeTable &get_house_archetypes() { return house_archetypes; }
+   const HouseArchetypeTable &get_house_archetypes() const { return house_archetypes; }
+   // new house with the sizes of its archetype and a box collider
+   HouseHandle add_house(ArchetypeId archetype, const glm::vec3 &position, PhysicsWorker *physics_system);
+   // house_rows houses on each side of the road at z, any of them may be left empty
+   void spawn_house_row(float z, PhysicsWorker *physics_system);
+   void spawn_initial_houses(PhysicsWorker *physics_system); // the road ahead at the start
+   void spawn_houses_ahead(const Camera *camera, PhysicsWorker *physics_system); // a row when the last house gets close
 
    bool is_game_over() const { return !game_state.active && (game_state.money <= 0 || game_state.happiness <= 0); }
    void restart_game();
+   void set_logging(bool enabled); // game events to the console, off for many games at once
 
 private:
-   void update_movement(float delta, Camera *camera, PhysicsSystem *physics_system);
+   void update_movement(float delta, Camera *camera, PhysicsWorker *physics_system);
    void update_projectiles(float delta);
-   void update_earthquake(float delta, Camera *camera, AudioEngine *audio_engine, ParticleSystem *particle_system = nullptr);
-   void update_houses(Camera *camera, PhysicsSystem *physics_system);
+   void update_earthquake(float delta, Camera *camera, AudioEngine *audio_engine);
+   void update_houses(Camera *camera, PhysicsWorker *physics_system);
+   void update_particle_emitters(ParticleSystem *particle_system);
 
    GameState game_state;
    std::unique_ptr<HouseGenerator> house_generator;
 
-   std::mt19937 rng;
-   std::uniform_real_distribution<float> unirand;
-   std::vector<std::string> house_models;
+   RandomStream rng;       // "game" stream of the RandomService
+   RandomStream spawn_rng; // "houses.spawn" stream
+   HouseArchetypeTable house_archetypes;
+   std::vector<ArchetypeId> spawn_archetypes; // picked at random for new houses
    float empty_plot_probability = 0.2f;
 
    unsigned int quake_sound_handle = 0;
    bool quake_sound_playing = false;
 
-   PhysicsSystem *cached_physics_system;
+   // emitters of the game effects, synchronized with the game state every frame
+   struct DeliveryEmitter
+   {
+      HouseHandle house;
+      ParticleEmitterHandle emitter;
+   };
+   std::vector<DeliveryEmitter> delivery_emitters; // one per house with a running effect
+   std::vector<HouseHandle> delivered_houses;      // delivered since the last update_particle_emitters
+   ParticleEmitterHandle quake_emitter;
+
+   PhysicsWorker *cached_physics_system;
+   bool logging = true;
+
+   // projectile vs house tests of update_projectiles (SoA, reused every step)
+   AabbBatch house_bounds;
+   AabbBatch projectile_bounds;
+   std::vector<AabbOverlap> projectile_hits;
 };
\ No newline at end of file
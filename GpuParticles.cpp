@@ -0,0 +1,252 @@
+#include "GpuParticles.hpp"
+#include "ParticleSystem.hpp"
+#include <numeric>
+
+GpuParticleBackend::GpuParticleBackend(size_t maxParticles)
+    : emitShader("resources/shaders/particle_emit.comp"),
+      simulateShader("resources/shaders/particle_simulate.comp"),
+      drawShader("resources/shaders/particle_gpu.vert", "resources/shaders/particle.frag"),
+      maxParticles(maxParticles) {
+
+    glCreateBuffers(1, &particleBuffer);
+    glNamedBufferStorage(particleBuffer, maxParticles * sizeof(GpuParticle), nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+    // int deadCount followed by the free slot indices (std430 layout)
+    glCreateBuffers(1, &deadListBuffer);
+    glNamedBufferStorage(deadListBuffer, sizeof(GLint) + maxParticles * sizeof(GLuint), nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+    // one list of particle indices per type, type t starts at t * maxParticles (= baseInstance)
+    glCreateBuffers(1, &drawIndexBuffer);
+    glNamedBufferStorage(drawIndexBuffer, TYPE_COUNT * maxParticles * sizeof(GLuint), nullptr, 0);
+
+    glCreateBuffers(1, &drawCommandBuffer);
+    glNamedBufferStorage(drawCommandBuffer, TYPE_COUNT * sizeof(DrawArraysIndirectCommand), nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+    // emission batch, reallocated every frame with glNamedBufferData (orphaning)
+    glCreateBuffers(1, &emitRequestBuffer);
+
+    // collision world, updated whenever a part of the grid is rebuilt (setSolidCells, setTerrain)
+    glCreateBuffers(1, &solidCellBuffer);
+    glCreateBuffers(1, &terrainBuffer);
+    const ParticleCollisionGrid empty;
+    setSolidCells(empty);
+    setTerrain(empty);
+
+    glCreateBuffers(READBACK_RING, readbackBuffers);
+    for (GLuint buffer : readbackBuffers) {
+        glNamedBufferStorage(buffer, TYPE_COUNT * sizeof(DrawArraysIndirectCommand), nullptr, GL_CLIENT_STORAGE_BIT);
+    }
+
+    glCreateQueries(GL_TIME_ELAPSED, QUERY_RING, timerQueries);
+
+    // quads are generated from gl_VertexID and the SSBO, core profile still needs a VAO
+    glCreateVertexArrays(1, &emptyVAO);
+
+    reset();
+}
+
+GpuParticleBackend::~GpuParticleBackend() {
+    for (GLsync& fence : readbackFences) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+    glDeleteQueries(QUERY_RING, timerQueries);
+    glDeleteBuffers(READBACK_RING, readbackBuffers);
+    glDeleteBuffers(1, &particleBuffer);
+    glDeleteBuffers(1, &deadListBuffer);
+    glDeleteBuffers(1, &drawIndexBuffer);
+    glDeleteBuffers(1, &drawCommandBuffer);
+    glDeleteBuffers(1, &emitRequestBuffer);
+    glDeleteBuffers(1, &solidCellBuffer);
+    glDeleteBuffers(1, &terrainBuffer);
+    glDeleteVertexArrays(1, &emptyVAO);
+
+    emitShader.clear();
+    simulateShader.clear();
+    drawShader.clear();
+}
+
+void GpuParticleBackend::reset() {
+    pendingEmits.clear();
+    pendingEmitCount = 0;
+    aliveCount = 0;
+
+    // life = 0 marks a free slot
+    glClearNamedBufferData(particleBuffer, GL_R32F, GL_RED, GL_FLOAT, nullptr);
+
+    std::vector<GLuint> deadList(maxParticles + 1);
+    std::iota(deadList.begin() + 1, deadList.end(), 0u);
+    deadList[0] = static_cast<GLuint>(maxParticles); // deadCount
+    glNamedBufferSubData(deadListBuffer, 0, deadList.size() * sizeof(GLuint), deadList.data());
+
+    resetDrawCommands();
+}
+
+void GpuParticleBackend::resetDrawCommands() {
+    DrawArraysIndirectCommand commands[TYPE_COUNT];
+    for (int type = 0; type < TYPE_COUNT; type++) {
+        // 4 vertices of a quad, instances are counted by the simulation kernel
+        commands[type] = {4, 0, 0, static_cast<GLuint>(type * maxParticles)};
+    }
+    glNamedBufferSubData(drawCommandBuffer, 0, sizeof(commands), commands);
+}
+
+template <typename Header, typename Cells>
+void GpuParticleBackend::uploadGrid(GLuint buffer, size_t& capacity, const Header& header, const Cells& cells) {
+    const size_t cellBytes = cells.size() * sizeof(cells[0]);
+    const size_t bytes = sizeof(header) + cellBytes;
+    if (bytes > capacity) {
+        // some room to spare, the solid cells grow and shrink a little as houses come and go
+        capacity = bytes + bytes / 4;
+        glNamedBufferData(buffer, capacity, nullptr, GL_DYNAMIC_DRAW);
+    }
+    glNamedBufferSubData(buffer, 0, sizeof(header), &header);
+    glNamedBufferSubData(buffer, sizeof(header), cellBytes, cells.data());
+}
+
+void GpuParticleBackend::setSolidCells(const ParticleCollisionGrid& grid) {
+    uploadGrid(solidCellBuffer, solidCellCapacity, grid.getSolidHeader(), grid.getSolidBits());
+}
+
+void GpuParticleBackend::setTerrain(const ParticleCollisionGrid& grid) {
+    uploadGrid(terrainBuffer, terrainCapacity, grid.getTerrainHeader(), grid.getTerrainHeights());
+}
+
+void GpuParticleBackend::emit(const ParticleEmitterDesc& emitter, int count, unsigned int seed) {
+    if (count <= 0) {
+        return;
+    }
+    
+    EmitRequest request;
+    request.positionShape = glm::vec4(emitter.position, static_cast<float>(emitter.shape));
+    request.extentsType = glm::vec4(emitter.extents, static_cast<float>(emitter.type));
+    request.lifetime = glm::vec4(emitter.lifetimeMin, emitter.lifetimeMax, 0.0f, 0.0f);
+    request.range = glm::uvec4(pendingEmitCount, static_cast<GLuint>(count), seed, 0u);
+    pendingEmits.push_back(request);
+    pendingEmitCount += static_cast<GLuint>(count);
+}
+
+void GpuParticleBackend::update(float deltaTime) {
+    collectReadbacks();
+
+    const bool timing = !queryPending[queryIndex];
+    if (timing) {
+        glBeginQuery(GL_TIME_ELAPSED, timerQueries[queryIndex]);
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particleBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, deadListBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, drawIndexBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, drawCommandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, solidCellBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, terrainBuffer);
+
+    // Emission - one dispatch for all emitters, every invocation pops a slot from the dead list
+    if (!pendingEmits.empty()) {
+        glNamedBufferData(emitRequestBuffer, pendingEmits.size() * sizeof(EmitRequest), pendingEmits.data(), GL_STREAM_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, emitRequestBuffer);
+        
+        emitShader.activate();
+        emitShader.setUniform("uRequestCount", static_cast<int>(pendingEmits.size()));
+        emitShader.setUniform("uEmitCount", static_cast<int>(pendingEmitCount));
+        glDispatchCompute((pendingEmitCount + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        
+        pendingEmits.clear();
+        pendingEmitCount = 0;
+    }
+
+    // Simulation - rebuilds the draw lists and their indirect counts from scratch
+    resetDrawCommands();
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    simulateShader.activate();
+    simulateShader.setUniform("uMaxParticles", static_cast<int>(maxParticles));
+    simulateShader.setUniform("uDeltaTime", deltaTime);
+    simulateShader.setUniform("uFrame", frame++);
+    simulateShader.setUniform("uSolidOffset", solidOffset);
+    glDispatchCompute((static_cast<GLuint>(maxParticles) + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE, 1, 1);
+    simulateShader.deactivate();
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    if (timing) {
+        glEndQuery(GL_TIME_ELAPSED);
+        queryPending[queryIndex] = true;
+        queryIndex = (queryIndex + 1) % QUERY_RING;
+    }
+
+    // alive count for statistics, read back once the GPU is done with this frame
+    if (!readbackFences[readbackIndex]) {
+        glCopyNamedBufferSubData(drawCommandBuffer, readbackBuffers[readbackIndex], 0, 0,
+                                 TYPE_COUNT * sizeof(DrawArraysIndirectCommand));
+        readbackFences[readbackIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        readbackIndex = (readbackIndex + 1) % READBACK_RING;
+    }
+}
+
+void GpuParticleBackend::collectReadbacks() {
+    for (int i = 0; i < READBACK_RING; i++) {
+        if (!readbackFences[i]) {
+            continue;
+        }
+
+        GLenum status = glClientWaitSync(readbackFences[i], 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            continue;
+        }
+        glDeleteSync(readbackFences[i]);
+        readbackFences[i] = nullptr;
+
+        DrawArraysIndirectCommand commands[TYPE_COUNT];
+        glGetNamedBufferSubData(readbackBuffers[i], 0, sizeof(commands), commands);
+        aliveCount = 0;
+        for (const auto& command : commands) {
+            aliveCount += command.instanceCount;
+        }
+    }
+
+    for (int i = 0; i < QUERY_RING; i++) {
+        if (!queryPending[i]) {
+            continue;
+        }
+
+        GLint available = 0;
+        glGetQueryObjectiv(timerQueries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            continue;
+        }
+
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(timerQueries[i], GL_QUERY_RESULT, &nanoseconds);
+        queryPending[i] = false;
+        gpuTimeMs = static_cast<float>(nanoseconds) / 1.0e6f;
+    }
+}
+
+void GpuParticleBackend::draw(ParticleType type) {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particleBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, drawIndexBuffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, drawCommandBuffer);
+    glBindVertexArray(emptyVAO);
+
+    const size_t offset = static_cast<size_t>(type) * sizeof(DrawArraysIndirectCommand);
+    glDrawArraysIndirect(GL_TRIANGLE_STRIP, reinterpret_cast<const void*>(offset));
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void GpuParticleBackend::readAlivePositions(std::vector<glm::vec3>& positions) const {
+    std::vector<GpuParticle> particles(maxParticles);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glGetNamedBufferSubData(particleBuffer, 0, particles.size() * sizeof(GpuParticle), particles.data());
+
+    positions.clear();
+    for (const auto& particle : particles) {
+        if (particle.positionLife.w > 0.0f) {
+            positions.push_back(glm::vec3(particle.positionLife));
+        }
+    }
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "ShaderProgram.hpp"
+#include "ParticleEmitter.hpp"
+#include "ParticleCollision.hpp"
+
+// Compute shader backend of ParticleSystem.
+//
+// Particle state lives only in SSBOs. All emission requests of a frame are uploaded
+// together and spawned by a single dispatch. Free slots are kept in a dead list that
+// is popped atomically by the emission kernel and pushed by the simulation kernel when
+// a particle dies. The simulation kernel also appends every living particle to the
+// draw list of its type and counts it as an instance of a DrawArraysIndirectCommand
+// (one billboard quad per instance), so drawing needs no CPU readback. Only the
+// alive count is read back (a few frames late, through fences) for statistics.
+class GpuParticleBackend {
+public:
+    explicit GpuParticleBackend(size_t maxParticles);
+    ~GpuParticleBackend();
+
+    GpuParticleBackend(const GpuParticleBackend&) = delete;
+    GpuParticleBackend& operator=(const GpuParticleBackend&) = delete;
+
+    // emission is queued and dispatched at the beginning of the next update()
+    void emit(const ParticleEmitterDesc& emitter, int count, unsigned int seed);
+    void update(float deltaTime);
+    // draws living particles of one type with the active draw shader
+    void draw(ParticleType type);
+    void reset();
+    // upload the static collision world sampled by the simulation kernel, each part on its
+    // own when it changed; the buffers are only reallocated when a part outgrows them
+    void setSolidCells(const ParticleCollisionGrid& grid);
+    void setTerrain(const ParticleCollisionGrid& grid);
+    // ParticleCollisionGrid::getSolidOffset, set every frame without an upload
+    void setSolidOffset(const glm::vec3& offset) { solidOffset = offset; }
+
+    ShaderProgram& getDrawShader() { return drawShader; }
+    size_t getAliveCount() const { return aliveCount; }
+    float getGpuTimeMs() const { return gpuTimeMs; }
+
+    // synchronous readback, meant for rare queries only
+    void readAlivePositions(std::vector<glm::vec3>& positions) const;
+
+private:
+    struct GpuParticle {
+        glm::vec4 positionLife;     // xyz = position, w = remaining life
+        glm::vec4 velocityLifetime; // xyz = velocity, w = total lifetime
+        glm::vec4 color;
+        glm::vec4 params;           // x = size, y = type, z = rotation, w = spin
+    };
+
+    struct DrawArraysIndirectCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint first;
+        GLuint baseInstance;
+    };
+
+    // one emitter in the emission batch (std430, see particle_emit.comp)
+    struct EmitRequest {
+        glm::vec4 positionShape;  // xyz = position, w = EmitterShape
+        glm::vec4 extentsType;    // xyz = extents, w = ParticleType
+        glm::vec4 lifetime;       // x = min, y = max
+        glm::uvec4 range;         // x = first invocation, y = count, z = seed
+    };
+
+    static constexpr int TYPE_COUNT = PARTICLE_TYPE_COUNT;
+    static constexpr int READBACK_RING = 3;
+    static constexpr int QUERY_RING = 4;
+    static constexpr GLuint WORK_GROUP_SIZE = 256;
+
+    void resetDrawCommands();
+    void collectReadbacks();
+    // header followed by the cells, capacity = bytes allocated for the buffer
+    template <typename Header, typename Cells>
+    static void uploadGrid(GLuint buffer, size_t& capacity, const Header& header, const Cells& cells);
+
+    ShaderProgram emitShader;
+    ShaderProgram simulateShader;
+    ShaderProgram drawShader;
+
+    GLuint particleBuffer = 0;
+    GLuint deadListBuffer = 0;
+    GLuint drawIndexBuffer = 0;
+    GLuint drawCommandBuffer = 0;
+    GLuint emitRequestBuffer = 0;
+    GLuint solidCellBuffer = 0;   // ParticleCollisionGrid::SolidHeader + occupancy bits
+    GLuint terrainBuffer = 0;     // ParticleCollisionGrid::TerrainHeader + column heights
+    size_t solidCellCapacity = 0;
+    size_t terrainCapacity = 0;
+    GLuint emptyVAO = 0;
+
+    GLuint readbackBuffers[READBACK_RING] = {};
+    GLsync readbackFences[READBACK_RING] = {};
+    int readbackIndex = 0;
+
+    GLuint timerQueries[QUERY_RING] = {};
+    bool queryPending[QUERY_RING] = {};
+    int queryIndex = 0;
+
+    std::vector<EmitRequest> pendingEmits;
+    GLuint pendingEmitCount = 0;
+    size_t maxParticles;
+    size_t aliveCount = 0;
+    glm::vec3 solidOffset{0.0f};
+    float gpuTimeMs = 0.0f;
+    int frame = 0;
+};
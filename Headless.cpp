@@ -0,0 +1,301 @@
+#include "Headless.hpp"
+#include "TimeService.hpp"
+#include <GLFW/glfw3.h>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+#include <glm/gtc/constants.hpp>
+
+namespace {
+
+constexpr float PROJECTILE_SPEED = 50.0f; // CupcakeGame::handle_mouse_click
+constexpr float GRAVITY = 9.81f;
+constexpr int SHOT_COST = 10;
+
+double elapsedMs(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+InputEvent keyPress(int key) {
+    InputEvent event;
+    event.type = InputEventType::KEY;
+    event.code = key;
+    event.action = GLFW_PRESS;
+    return event;
+}
+
+}
+
+void HeadlessBot::update(float delta, const CupcakeGame& game, const Camera& camera, std::vector<InputEvent>& events) {
+    cooldown = std::max(0.0f, cooldown - delta);
+
+    if (game.is_game_over()) {
+        if (restartOnGameOver) {
+            events.push_back(keyPress(GLFW_KEY_F5));
+        }
+        return;
+    }
+
+    const GameState& state = game.get_game_state();
+    const size_t index = state.houses.indexOf(state.requesting_house);
+    if (!state.active || index == SIZE_MAX || (state.houses.flags[index] & HOUSE_REQUESTING) == 0) {
+        return;
+    }
+
+    // the wall facing the road, lifted by the drop (the middle of the house is behind the
+    // nearer houses of the same side); cupcakes move with the world, no lead for the scroll
+    const glm::vec3 origin = camera.Position + camera.Front * 2.0f;
+    const glm::vec3 position = state.houses.positions[index];
+    const glm::vec3 extents = state.houses.halfExtents[index];
+    const float side = position.x > camera.Position.x ? -1.0f : 1.0f;
+    const glm::vec3 house = position + glm::vec3(side * extents.x * 0.9f, extents.y * 0.5f, 0.0f);
+    glm::vec3 target = house;
+    for (int i = 0; i < 2; i++) {
+        const float t = glm::length(target - origin) / PROJECTILE_SPEED;
+        target = house + glm::vec3(0.0f, 0.5f * GRAVITY * t * t, 0.0f);
+    }
+
+    const glm::vec3 direction = glm::normalize(target - camera.Position);
+    const float yaw = glm::degrees(std::atan2(direction.z, direction.x));
+    const float pitch = glm::degrees(std::asin(glm::clamp(direction.y, -1.0f, 1.0f)));
+
+    float yawOffset = yaw - camera.Yaw;
+    yawOffset -= 360.0f * std::round(yawOffset / 360.0f);
+
+    InputEvent move;
+    move.type = InputEventType::CURSOR;
+    move.x = yawOffset / camera.MouseSensitivity;
+    move.y = (pitch - camera.Pitch) / camera.MouseSensitivity;
+    events.push_back(move);
+
+    // one cupcake at a time, the next one waits to see whether the request is still open
+    if (cooldown <= 0.0f && state.money >= SHOT_COST && state.projectiles.empty()) {
+        InputEvent click;
+        click.type = InputEventType::MOUSE_BUTTON;
+        click.code = GLFW_MOUSE_BUTTON_LEFT;
+        click.action = GLFW_PRESS;
+        events.push_back(click);
+        click.action = GLFW_RELEASE;
+        events.push_back(click);
+
+        cooldown = shotInterval;
+    }
+}
+
+void HeadlessReport::print() const {
+    const double framesOrOne = frames > 0 ? static_cast<double>(frames) : 1.0;
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "=== Headless simulace ===" << std::endl;
+    std::cout << "Simulovano: " << simulatedSeconds << " s za " << wallSeconds << " s (" << frames << " snimku, " << steps
+              << " kroku), " << (wallSeconds > 0.0 ? simulatedSeconds / wallSeconds : 0.0) << " sim s / s" << std::endl;
+
+    std::cout << "Casy systemu na snimek (prumer / celkem ms):" << std::endl;
+    auto line = [&](const char* name, double total) {
+        std::cout << "  " << std::left << std::setw(14) << name << std::right << std::setprecision(4) << total / framesOrOne
+                  << " / " << std::setprecision(1) << total << std::endl;
+    };
+    line("hra", total.game);
+    line("castice", total.particles);
+    line("fyzika", total.physics);
+    line("cekani fyziky", total.physicsWait);
+    line("vstup", total.input);
+    std::cout << std::setprecision(3) << "  nejpomalejsi snimek: " << maxFrameMs << " ms" << std::endl;
+
+    std::cout << "Entity (konec / max): domy " << houses << " / " << maxHouses << ", projektily " << projectiles << " / "
+              << maxProjectiles << ", castice " << particles << " / " << maxParticles << ", kolidery " << colliders
+              << " / " << maxColliders << std::endl;
+    std::cout << "Hry: " << games << " dohranych, doruceno " << deliveries << ", zmeskano " << missedDeliveries
+              << ", spatne " << wrongDeliveries << ", vystrelu " << shots << std::endl;
+    std::cout << std::defaultfloat;
+}
+
+HeadlessSimulation::HeadlessSimulation(const HeadlessOptions& options)
+    : options(options),
+      physics(options.threadedPhysics),
+      particles(std::make_unique<ParticleSystem>(options.maxParticles)),
+      camera(glm::vec3(0.0f, 2.0f, 5.0f)),
+      bot(options.shotInterval, options.restartOnGameOver) {
+    // as in the application, so recorded cursor offsets turn it the same way
+    camera.MovementSpeed = 2.5f;
+    camera.MouseSensitivity = 0.1f;
+
+    physics.setWorldBounds(glm::vec3(-100.0f, -5.0f, -300.0f), glm::vec3(100.0f, 100.0f, 100.0f));
+
+    game.initialize();
+    game.spawn_initial_houses(&physics);
+    physics.submit();
+    physics.sync();
+
+    // the clock of a replay is set up from the recording
+    TimeService& time = TimeService::instance();
+    if (!options.replay) {
+        time.setStepRate(1.0f / options.step);
+    }
+    time.reset();
+}
+
+void HeadlessSimulation::addGameStats() {
+    const GameState& state = game.get_game_state();
+    report.deliveries += state.deliveries;
+    report.missedDeliveries += state.missed_deliveries;
+    report.wrongDeliveries += state.wrong_deliveries;
+}
+
+void HeadlessSimulation::applyInput(const InputEvent& event) {
+    switch (event.type) {
+    case InputEventType::CURSOR:
+        game.handle_mouse_move(&camera, event.x, event.y);
+        break;
+    case InputEventType::MOUSE_BUTTON:
+        if (event.code == GLFW_MOUSE_BUTTON_LEFT && event.action == GLFW_PRESS) {
+            game.handle_mouse_click(&camera);
+            report.shots++;
+        }
+        break;
+    case InputEventType::SCROLL:
+        camera.MovementSpeed = glm::clamp(camera.MovementSpeed * (1.0f + event.y * 0.1f), 0.5f, 15.0f);
+        break;
+    case InputEventType::KEY:
+        // the keys of key_callback that change the simulation, the rest only changes the picture
+        if (event.code == GLFW_KEY_F5 && event.action == GLFW_PRESS) {
+            GameState& state = game.get_game_state();
+            if (game.is_game_over()) {
+                report.games++;
+                addGameStats();
+                game.restart_game();
+                TimeService::instance().setPaused(false);
+                game.spawn_initial_houses(&physics);
+            } else {
+                state.active = !state.active;
+                TimeService::instance().setPaused(!state.active);
+            }
+        } else if ((event.code == GLFW_KEY_PAGE_UP || event.code == GLFW_KEY_PAGE_DOWN) && event.action == GLFW_PRESS) {
+            TimeService& time = TimeService::instance();
+            time.setTimeScale(event.code == GLFW_KEY_PAGE_UP ? time.getTimeScale() * 2.0f : time.getTimeScale() * 0.5f);
+        } else if (event.action == GLFW_PRESS || event.action == GLFW_REPEAT) {
+            if (event.code == GLFW_KEY_N) {
+                particles->emit(50);
+            } else if (event.code == GLFW_KEY_M) {
+                particles->reset();
+            }
+        }
+        break;
+    }
+}
+
+bool HeadlessSimulation::frame() {
+    const auto frameStart = std::chrono::high_resolution_clock::now();
+    TimeService& time = TimeService::instance();
+
+    // input first, the window callbacks run before the frame as well
+    auto start = std::chrono::high_resolution_clock::now();
+    if (options.replay) {
+        if (!options.replay->nextFrame(input)) {
+            return false;
+        }
+    } else {
+        input.delta = options.step;
+        input.events.clear();
+        bot.update(options.step, game, camera, input.events);
+    }
+    for (const InputEvent& event : input.events) {
+        if (options.recorder) {
+            options.recorder->record(event);
+        }
+        applyInput(event);
+    }
+    report.total.input += elapsedMs(start);
+
+    const int steps = time.advance(input.delta);
+    if (options.recorder) {
+        options.recorder->recordFrame(input.delta);
+    }
+
+    physics.sync();
+    report.total.physicsWait += physics.getStats().waitMs;
+    report.total.physics += physics.getStats().stepMs;
+    particles->setCollisionGrid(&physics.getParticleGrid());
+
+    for (int i = 0; i < steps && game.get_game_state().active; i++) {
+        start = std::chrono::high_resolution_clock::now();
+        game.update(time.getFixedStep(), &camera, nullptr, particles.get(), &physics);
+        report.total.game += elapsedMs(start);
+
+        start = std::chrono::high_resolution_clock::now();
+        particles->update(time.getFixedStep());
+        report.total.particles += elapsedMs(start);
+
+        start = std::chrono::high_resolution_clock::now();
+        game.spawn_houses_ahead(&camera, &physics);
+        report.total.game += elapsedMs(start);
+    }
+
+    physics.submit();
+
+    report.frames++;
+    report.steps = time.getStepCount();
+    report.simulatedSeconds = time.getSimulationTime();
+    report.maxFrameMs = std::max(report.maxFrameMs, elapsedMs(frameStart));
+    countEntities();
+    return true;
+}
+
+void HeadlessSimulation::countEntities() {
+    const GameState& state = game.get_game_state();
+    report.houses = state.houses.size();
+    report.projectiles = state.projectiles.size();
+    report.particles = particles->getStats().aliveCount;
+    report.colliders = physics.getWorld().getCollisionObjects().size();
+
+    report.maxHouses = std::max(report.maxHouses, report.houses);
+    report.maxProjectiles = std::max(report.maxProjectiles, report.projectiles);
+    report.maxParticles = std::max(report.maxParticles, report.particles);
+    report.maxColliders = std::max(report.maxColliders, report.colliders);
+}
+
+const HeadlessReport& HeadlessSimulation::run() {
+    const auto start = std::chrono::high_resolution_clock::now();
+    double nextReport = options.reportInterval;
+
+    // a replay runs to its end
+    while (options.replay || report.simulatedSeconds < options.seconds) {
+        if (!options.replay && !options.restartOnGameOver && game.is_game_over()) {
+            report.games++;
+            break;
+        }
+        if (!frame()) {
+            break; // end of the recording
+        }
+
+        if (options.reportInterval > 0.0 && report.simulatedSeconds >= nextReport) {
+            nextReport += options.reportInterval;
+            const double wall = elapsedMs(start) / 1000.0;
+            const GameState& state = game.get_game_state();
+            std::cout << "[headless] " << std::fixed << std::setprecision(0) << report.simulatedSeconds << " s, "
+                      << std::setprecision(1) << report.simulatedSeconds / std::max(wall, 1e-9) << " sim s / s, penize "
+                      << state.money << ", spokojenost " << state.happiness << std::defaultfloat << std::endl;
+        }
+    }
+    physics.sync();
+
+    report.wallSeconds = elapsedMs(start) / 1000.0;
+    addGameStats(); // the game still running counts too
+    return report;
+}
+
+int runHeadless(const HeadlessOptions& options) {
+    if (options.replay) {
+        std::cout << "Headless: prehravani zaznamu, krok " << TimeService::instance().getFixedStep() << " s, fyzika ";
+    } else {
+        std::cout << "Headless: " << options.seconds << " s simulace, krok " << options.step << " s, fyzika ";
+    }
+    std::cout << (options.threadedPhysics ? "ve vlakne" : "synchronne") << std::endl;
+
+    HeadlessSimulation simulation(options);
+    simulation.run().print();
+    return EXIT_SUCCESS;
+}
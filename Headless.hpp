@@ -0,0 +1,107 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "CupcakeGame.hpp"
+#include "PhysicsWorker.hpp"
+#include "ParticleSystem.hpp"
+#include "InputRecording.hpp"
+#include "camera.hpp"
+
+// Plays the game in place of the mouse: aims at the house that waits for a cupcake,
+// above it by the drop of the cupcake, and shoots at a fixed rate. It produces the
+// input events the window would (cursor offsets, clicks, F5 after a game over), so its
+// sessions can be recorded and replayed with a window.
+class HeadlessBot {
+public:
+    explicit HeadlessBot(float shotInterval = 0.5f, bool restartOnGameOver = true)
+        : shotInterval(shotInterval), restartOnGameOver(restartOnGameOver) {}
+
+    void update(float delta, const CupcakeGame& game, const Camera& camera, std::vector<InputEvent>& events);
+
+private:
+    float shotInterval; // seconds between two shots at the same request
+    bool restartOnGameOver;
+    float cooldown = 0.0f;
+};
+
+struct HeadlessOptions {
+    double seconds = 600.0;        // simulated time, without a replay
+    float step = 1.0f / 60.0f;     // fixed step of the simulation, also the frame time of the bot
+    bool threadedPhysics = true;   // PhysicsWorker on its own thread or inline
+    size_t maxParticles = 1000;
+    float shotInterval = 0.5f;
+    bool restartOnGameOver = true; // keep playing until the time is up
+    double reportInterval = 60.0;  // simulated seconds between progress lines, 0 = none
+
+    InputReplay* replay = nullptr;     // input and frame times from a recording instead of the bot
+    InputRecorder* recorder = nullptr; // records the input of the run
+};
+
+// Wall time of the systems over a run, milliseconds
+struct HeadlessTimings {
+    double game = 0.0;      // CupcakeGame::update with the requests, projectiles and spawning
+    double particles = 0.0; // ParticleSystem::update
+    double physics = 0.0;   // PhysicsWorker step (on the worker when threaded)
+    double physicsWait = 0.0; // main thread blocked on the worker
+    double input = 0.0;     // bot or replay and the input handlers
+};
+
+struct HeadlessReport {
+    double simulatedSeconds = 0.0;
+    double wallSeconds = 0.0;
+    uint64_t frames = 0;
+    uint64_t steps = 0;
+    HeadlessTimings total;
+    double maxFrameMs = 0.0; // slowest frame on the main thread
+
+    int games = 0;     // finished by game over
+    int deliveries = 0;
+    int missedDeliveries = 0;
+    int wrongDeliveries = 0;
+    size_t shots = 0; // clicks
+
+    // entity counts at the end and the highest ones seen
+    size_t houses = 0, maxHouses = 0;
+    size_t projectiles = 0, maxProjectiles = 0;
+    size_t particles = 0, maxParticles = 0;
+    size_t colliders = 0, maxColliders = 0;
+
+    void print() const;
+};
+
+// The game, its physics world and a render-less particle system without a window or a
+// GL context, run frame by frame as fast as the machine allows. A frame goes as in the
+// application: the input (the bot's or a recording's), then the fixed steps the
+// TimeService has for the frame time, between a sync and a submit of the physics.
+class HeadlessSimulation {
+public:
+    explicit HeadlessSimulation(const HeadlessOptions& options = HeadlessOptions());
+
+    bool frame(); // false when the replay has ended
+    const HeadlessReport& run(); // for options.seconds of simulated time or to the end of the replay
+    const HeadlessReport& getReport() const { return report; }
+
+    CupcakeGame& getGame() { return game; }
+    Camera& getCamera() { return camera; }
+
+private:
+    void applyInput(const InputEvent& event); // the game part of the window callbacks
+    void countEntities();
+    void addGameStats();
+
+    HeadlessOptions options;
+    CupcakeGame game;
+    PhysicsWorker physics;
+    std::unique_ptr<ParticleSystem> particles;
+    Camera camera;
+    HeadlessBot bot;
+    HeadlessReport report;
+
+    InputFrame input;
+};
+
+// --headless mode of the application, returns the exit code
+int runHeadless(const HeadlessOptions& options);
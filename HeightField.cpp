@@ -0,0 +1,226 @@
+#include "HeightField.hpp"
+#include "Random.hpp"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+namespace {
+
+float smoothstep(float edge0, float edge1, float x) {
+    const float t = std::clamp((x - edge0) / (edge1 - edge0), 0.0f, 1.0f);
+    return t * t * (3.0f - 2.0f * t);
+}
+
+} // namespace
+
+thread_local HeightField::CellCache HeightField::cellCache;
+
+HeightField::HeightField() {
+    Level flat;
+    flat.width = MIN_LEVEL_SIZE;
+    flat.height = MIN_LEVEL_SIZE;
+    flat.heights.assign(MIN_LEVEL_SIZE * MIN_LEVEL_SIZE, 0.0f);
+    levels.push_back(std::move(flat));
+    buildLevels();
+}
+
+float HeightField::corridorWeight(float x) {
+    return smoothstep(ROAD_HALF_WIDTH, ROAD_HALF_WIDTH + ROAD_BLEND, std::abs(x - ROAD_CENTER));
+}
+
+void HeightField::load(const std::filesystem::path& path, float texelSize, float heightScale) {
+    // ANYDEPTH keeps 16-bit samples (and makes the image single channel)
+    cv::Mat image = cv::imread(path.string(), cv::IMREAD_ANYDEPTH);
+    if (image.empty()) {
+        throw std::runtime_error("Heightmap '" + path.string() + "' nelze nacist");
+    }
+    if (image.channels() != 1 || (image.depth() != CV_16U && image.depth() != CV_8U)) {
+        throw std::runtime_error("Heightmap '" + path.string() + "' neni 8/16-bit sedotonovy obrazek");
+    }
+
+    const float scale = heightScale / (image.depth() == CV_16U ? 65535.0f : 255.0f);
+    Level base;
+    base.width = image.cols;
+    base.height = image.rows;
+    base.heights.resize(static_cast<size_t>(base.width) * base.height);
+    for (int z = 0; z < base.height; z++) {
+        float* row = &base.heights[static_cast<size_t>(z) * base.width];
+        if (image.depth() == CV_16U) {
+            const uint16_t* source = image.ptr<uint16_t>(z);
+            for (int x = 0; x < base.width; x++) {
+                row[x] = source[x] * scale;
+            }
+        } else {
+            const uint8_t* source = image.ptr<uint8_t>(z);
+            for (int x = 0; x < base.width; x++) {
+                row[x] = source[x] * scale;
+            }
+        }
+    }
+
+    this->texelSize = texelSize;
+    levels.assign(1, std::move(base));
+    buildLevels();
+}
+
+void HeightField::generate(int size, uint64_t seed, float texelSize, float heightScale) {
+    size = std::max(size, MIN_LEVEL_SIZE);
+    RandomStream generator(seed);
+
+    // value noise octaves with whole lattice periods across the map, so it tiles
+    Level base;
+    base.width = size;
+    base.height = size;
+    base.heights.assign(static_cast<size_t>(size) * size, 0.0f);
+
+    float amplitude = 1.0f;
+    float total = 0.0f;
+    for (int lattice = 4; lattice <= size / 4; lattice *= 2) {
+        std::vector<float> values(static_cast<size_t>(lattice) * lattice);
+        for (float& value : values) {
+            value = generator.nextFloat();
+        }
+        const float cellsPerTexel = static_cast<float>(lattice) / size;
+        for (int z = 0; z < size; z++) {
+            const float fz = z * cellsPerTexel;
+            const int z0 = static_cast<int>(fz);
+            const int z1 = (z0 + 1) % lattice;
+            const float tz = smoothstep(0.0f, 1.0f, fz - z0);
+            for (int x = 0; x < size; x++) {
+                const float fx = x * cellsPerTexel;
+                const int x0 = static_cast<int>(fx);
+                const int x1 = (x0 + 1) % lattice;
+                const float tx = smoothstep(0.0f, 1.0f, fx - x0);
+                const float top = glm::mix(values[z0 * lattice + x0], values[z0 * lattice + x1], tx);
+                const float bottom = glm::mix(values[z1 * lattice + x0], values[z1 * lattice + x1], tx);
+                base.heights[static_cast<size_t>(z) * size + x] += amplitude * glm::mix(top, bottom, tz);
+            }
+        }
+        total += amplitude;
+        amplitude *= 0.5f;
+    }
+
+    // quantized like a 16-bit map, wide valleys and steeper tops
+    for (float& height : base.heights) {
+        const float normalized = std::pow(height / total, 1.8f);
+        height = std::round(normalized * 65535.0f) / 65535.0f * heightScale;
+    }
+
+    this->texelSize = texelSize;
+    levels.assign(1, std::move(base));
+    buildLevels();
+}
+
+void HeightField::buildLevels() {
+    invTexelSize = 1.0f / texelSize;
+    revision++; // the cached cells are stale now
+
+    const auto [lowest, highest] = std::minmax_element(levels[0].heights.begin(), levels[0].heights.end());
+    minHeight = BASE_HEIGHT + std::min(*lowest, 0.0f);
+    maxHeight = BASE_HEIGHT + *highest;
+
+    while (levels.back().width >= 2 * MIN_LEVEL_SIZE && levels.back().height >= 2 * MIN_LEVEL_SIZE) {
+        const Level& fine = levels.back();
+        Level coarse;
+        coarse.width = fine.width / 2;
+        coarse.height = fine.height / 2;
+        coarse.heights.resize(static_cast<size_t>(coarse.width) * coarse.height);
+        for (int z = 0; z < coarse.height; z++) {
+            for (int x = 0; x < coarse.width; x++) {
+                coarse.heights[static_cast<size_t>(z) * coarse.width + x] =
+                    0.25f * (texel(fine, 2 * x, 2 * z) + texel(fine, 2 * x + 1, 2 * z) +
+                             texel(fine, 2 * x, 2 * z + 1) + texel(fine, 2 * x + 1, 2 * z + 1));
+            }
+        }
+        levels.push_back(std::move(coarse));
+    }
+}
+
+const HeightField::CellCache& HeightField::cell(int x, int z) const {
+    CellCache& cache = cellCache;
+    if (x != cache.x || z != cache.z || cache.field != this || cache.revision != revision) {
+        const Level& level = levels[0];
+        cache.field = this;
+        cache.revision = revision;
+        cache.x = x;
+        cache.z = z;
+        cache.h00 = texel(level, x, z);
+        cache.h10 = texel(level, x + 1, z);
+        cache.h01 = texel(level, x, z + 1);
+        cache.h11 = texel(level, x + 1, z + 1);
+    }
+    return cache;
+}
+
+float HeightField::getHeight(float x, float z) const {
+    const float weight = corridorWeight(x);
+    if (weight <= 0.0f) {
+        return BASE_HEIGHT;
+    }
+
+    const float fx = x * invTexelSize;
+    const float fz = z * invTexelSize;
+    const float cellX = std::floor(fx);
+    const float cellZ = std::floor(fz);
+    const CellCache& c = cell(static_cast<int>(cellX), static_cast<int>(cellZ));
+    const float tx = fx - cellX;
+    const float tz = fz - cellZ;
+    const float height = glm::mix(glm::mix(c.h00, c.h10, tx), glm::mix(c.h01, c.h11, tx), tz);
+    return BASE_HEIGHT + weight * height;
+}
+
+glm::vec3 HeightField::getNormal(float x, float z) const {
+    const float weight = corridorWeight(x);
+    if (weight <= 0.0f) {
+        return glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+
+    const float fx = x * invTexelSize;
+    const float fz = z * invTexelSize;
+    const float cellX = std::floor(fx);
+    const float cellZ = std::floor(fz);
+    const CellCache& c = cell(static_cast<int>(cellX), static_cast<int>(cellZ));
+    const float tx = fx - cellX;
+    const float tz = fz - cellZ;
+
+    // gradient of weight(x) * bilinear(x, z)
+    const float height = glm::mix(glm::mix(c.h00, c.h10, tx), glm::mix(c.h01, c.h11, tx), tz);
+    const float dHeightX = glm::mix(c.h10 - c.h00, c.h11 - c.h01, tz) * invTexelSize;
+    const float dHeightZ = glm::mix(c.h01 - c.h00, c.h11 - c.h10, tx) * invTexelSize;
+
+    float dWeightX = 0.0f;
+    const float distance = std::abs(x - ROAD_CENTER);
+    if (weight < 1.0f) {
+        const float t = (distance - ROAD_HALF_WIDTH) / ROAD_BLEND;
+        dWeightX = 6.0f * t * (1.0f - t) / ROAD_BLEND * (x < ROAD_CENTER ? -1.0f : 1.0f);
+    }
+
+    const float slopeX = dWeightX * height + weight * dHeightX;
+    const float slopeZ = weight * dHeightZ;
+    return glm::normalize(glm::vec3(-slopeX, 1.0f, -slopeZ));
+}
+
+float HeightField::sampleLevel(float x, float z, int level) const {
+    const float weight = corridorWeight(x);
+    if (weight <= 0.0f) {
+        return BASE_HEIGHT;
+    }
+
+    level = std::clamp(level, 0, getLevelCount() - 1);
+    const Level& source = levels[level];
+    // texel centers of a coarser level sit between the fine texels they average
+    const float scale = invTexelSize / static_cast<float>(1 << level);
+    const float offset = level > 0 ? 0.5f - 0.5f / static_cast<float>(1 << level) : 0.0f;
+    const float fx = x * scale - offset;
+    const float fz = z * scale - offset;
+    const float cellX = std::floor(fx);
+    const float cellZ = std::floor(fz);
+    const int ix = static_cast<int>(cellX);
+    const int iz = static_cast<int>(cellZ);
+    const float tx = fx - cellX;
+    const float tz = fz - cellZ;
+    const float height = glm::mix(glm::mix(texel(source, ix, iz), texel(source, ix + 1, iz), tx),
+                                  glm::mix(texel(source, ix, iz + 1), texel(source, ix + 1, iz + 1), tx), tz);
+    return BASE_HEIGHT + weight * height;
+}
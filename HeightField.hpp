@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+#include <glm/glm.hpp>
+
+// Terrain heights from a 16-bit grayscale heightmap.
+//
+// The map repeats in both directions, so the road can run on forever, and it is kept
+// flat (at BASE_HEIGHT, just under the road) along the road corridor where the houses
+// and the camera are. Coarser levels, each a 2x2 box filter of the previous one, are
+// sampled by the distant terrain chunks so they do not alias.
+//
+// getHeight and getNormal are bilinear in the finest level and keep the corners of the
+// last cell they read: the camera and the particle grid query the same few cells over
+// and over, and a hit skips the wrapping and the four loads. The cache is per thread,
+// the physics worker and the main thread sample the same field.
+class HeightField {
+public:
+    static constexpr float DEFAULT_TEXEL_SIZE = 2.0f;    // meters between two samples
+    static constexpr float DEFAULT_HEIGHT_SCALE = 40.0f; // meters for the full 16-bit range
+    static constexpr float BASE_HEIGHT = -0.1f;          // flat ground, the road lies at -0.02
+    static constexpr float ROAD_CENTER = -5.0f;          // x of the corridor (houses at -20 and 10)
+    static constexpr float ROAD_HALF_WIDTH = 35.0f;      // flat part of the corridor
+    static constexpr float ROAD_BLEND = 40.0f;           // from flat to full height
+    static constexpr int GENERATED_SIZE = 512;           // texels of the generated map
+    static constexpr int MIN_LEVEL_SIZE = 8;
+
+    HeightField(); // flat until load or generate
+
+    // 8 or 16-bit single channel image, throws std::runtime_error
+    void load(const std::filesystem::path& path, float texelSize = DEFAULT_TEXEL_SIZE,
+              float heightScale = DEFAULT_HEIGHT_SCALE);
+    // tileable fractal noise, for when there is no heightmap
+    void generate(int size, uint64_t seed, float texelSize = DEFAULT_TEXEL_SIZE,
+                  float heightScale = DEFAULT_HEIGHT_SCALE);
+
+    // x, z in road space
+    float getHeight(float x, float z) const;
+    glm::vec3 getNormal(float x, float z) const;
+    // bilinear in a coarser level (texel size * 2^level), not cached
+    float sampleLevel(float x, float z, int level) const;
+
+    int getLevelCount() const { return static_cast<int>(levels.size()); }
+    float getTexelSize() const { return texelSize; }
+    float getMinHeight() const { return minHeight; }
+    float getMaxHeight() const { return maxHeight; }
+    uint32_t getRevision() const { return revision; } // changes with every load or generate
+
+    // weight of the map height, 0 in the flat corridor
+    static float corridorWeight(float x);
+
+private:
+    struct Level {
+        int width = 0;
+        int height = 0;
+        std::vector<float> heights; // meters above BASE_HEIGHT, row major
+    };
+
+    void buildLevels(); // levels[0] must be filled
+    float texel(const Level& level, int x, int z) const {
+        x %= level.width;
+        z %= level.height;
+        if (x < 0) x += level.width;
+        if (z < 0) z += level.height;
+        return level.heights[static_cast<size_t>(z) * level.width + x];
+    }
+
+    std::vector<Level> levels;
+    float texelSize = DEFAULT_TEXEL_SIZE;
+    float invTexelSize = 1.0f / DEFAULT_TEXEL_SIZE;
+    float minHeight = BASE_HEIGHT;
+    float maxHeight = BASE_HEIGHT;
+    uint32_t revision = 0;
+
+    // corners of the last cell read by getHeight / getNormal (one per thread)
+    struct CellCache {
+        const HeightField* field = nullptr;
+        uint32_t revision = 0;
+        int x = INT32_MIN;
+        int z = INT32_MIN;
+        float h00 = 0.0f, h10 = 0.0f, h01 = 0.0f, h11 = 0.0f;
+    };
+    static thread_local CellCache cellCache;
+    const CellCache& cell(int x, int z) const;
+};
@@ -5,7 +5,12 @@
 #include <vector>
 
 HouseGenerator::HouseGenerator()
-    : rng(std::random_device{}()), uniformDist(0.0f, 1.0f), requestTimer(0.0f)
+    : HouseGenerator(RandomService::instance().getMasterSeed())
+{
+}
+
+HouseGenerator::HouseGenerator(uint64_t masterSeed)
+    : rng(RandomService::streamFor(masterSeed, "houses.requests")), requestTimer(0.0f)
 {
 }
 
@@ -14,31 +19,24 @@ void HouseGenerator::updateRequests(float deltaTime, GameState &gameState, const
     if (!camera)
         return;
 
-    if (gameState.requesting_house_id < 0)
+    HouseRegistry &houses = gameState.houses;
+    if (!gameState.requesting_house.isValid())
     {
         this->requestTimer += deltaTime;
-        if (this->requestTimer >= gameState.request_interval && !gameState.houses.empty())
+        if (this->requestTimer >= gameState.request_interval && !houses.empty())
         {
-            std::vector<int> potentialIndices;
-            for (size_t i = 0; i < gameState.houses.size(); ++i)
-            {
-                const auto &h = gameState.houses[i];
-                if (h.position.z < camera->Position.z - 20.0f && h.position.z > camera->Position.z - 100.0f)
-                {
-                    potentialIndices.push_back(static_cast<int>(i));
-                }
-            }
-
-            if (!potentialIndices.empty())
+            // domy 20 az 100 jednotek pred kamerou, serazene podle z
+            const auto [first, last] = houses.rangeZ(camera->Position.z - 100.0f, camera->Position.z - 20.0f);
+            if (first < last)
             {
-                std::uniform_int_distribution<size_t> dist(0, potentialIndices.size() - 1);
-                int pickedHouseIndex = potentialIndices[dist(this->rng)];
+                const size_t pickedHouseIndex = first + this->rng.index(last - first);
 
-                gameState.houses[pickedHouseIndex].requesting = true;
-                gameState.requesting_house_id = gameState.houses[pickedHouseIndex].id;
+                houses.flags[pickedHouseIndex] |= HOUSE_REQUESTING;
+                gameState.requesting_house = houses.handleAt(pickedHouseIndex);
                 gameState.request_time_left = gameState.request_timeout;
                 this->requestTimer = 0.0f;
-                std::cout << "REQUEST HANDLER: New delivery request at house " << gameState.requesting_house_id << std::endl;
+                if (this->logging)
+                    std::cout << "REQUEST HANDLER: New delivery request at house " << houses.ids[pickedHouseIndex] << std::endl;
             }
         }
     }
@@ -48,17 +46,16 @@ void HouseGenerator::updateRequests(float deltaTime, GameState &gameState, const
         if (gameState.request_time_left <= 0.0f)
         {
             gameState.happiness = glm::max(0, gameState.happiness - 8);
-            std::cout << "REQUEST HANDLER: Missed delivery! Happiness: " << gameState.happiness << "%" << std::endl;
+            gameState.missed_deliveries++;
+            if (this->logging)
+                std::cout << "REQUEST HANDLER: Missed delivery! Happiness: " << gameState.happiness << "%" << std::endl;
 
-            for (auto &h : gameState.houses)
+            const size_t index = houses.indexOf(gameState.requesting_house); // dum uz mohl zmizet za kamerou
+            if (index != SIZE_MAX)
             {
-                if (h.id == gameState.requesting_house_id)
-                {
-                    h.requesting = false;
-                    break;
-                }
+                houses.flags[index] &= ~HOUSE_REQUESTING;
             }
-            gameState.requesting_house_id = -1;
+            gameState.requesting_house = HouseHandle();
             this->requestTimer = 0.0f;
         }
     }
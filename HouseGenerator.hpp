@@ -1,6 +1,6 @@
 #pragma once
 
-#include <random>
+#include "Random.hpp"
 
 // Forward declarations to avoid including full headers here
 struct GameState;
@@ -9,10 +9,12 @@ class Camera;
 class HouseGenerator {
 public:
     HouseGenerator();
+    explicit HouseGenerator(uint64_t masterSeed); // streams of another master seed than the RandomService's
     void updateRequests(float deltaTime, GameState& gameState, const Camera* camera);
+    void setLogging(bool enabled) { logging = enabled; }
 
 private:
-    std::mt19937 rng;
-    std::uniform_real_distribution<float> uniformDist;
+    RandomStream rng; // "houses.requests" stream of the RandomService
     float requestTimer; // Timer for controlling request frequency
+    bool logging = true; // requests and misses to the console
 };
\ No newline at end of file
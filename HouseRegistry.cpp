@@ -0,0 +1,137 @@
+#include "HouseRegistry.hpp"
+#include <algorithm>
+
+HouseArchetypeTable::HouseArchetypeTable() {
+    add({ "bambo_house", glm::vec3(4.0f, 6.0f, 4.0f), 8.0f, glm::vec3(2.0f) });
+    add({ "cyprys_house", glm::vec3(4.5f, 7.0f, 4.5f), 9.0f, glm::vec3(2.5f) });
+    add({ "building", glm::vec3(6.0f, 9.0f, 6.0f), 12.0f, glm::vec3(1.5f) });
+}
+
+ArchetypeId HouseArchetypeTable::add(const HouseArchetype& archetype) {
+    auto it = byName.find(archetype.modelName);
+    if (it != byName.end()) {
+        archetypes[it->second] = archetype;
+        return it->second;
+    }
+    const ArchetypeId id = static_cast<ArchetypeId>(archetypes.size());
+    archetypes.push_back(archetype);
+    byName.emplace(archetype.modelName, id);
+    return id;
+}
+
+ArchetypeId HouseArchetypeTable::intern(const std::string& modelName) {
+    auto it = byName.find(modelName);
+    if (it != byName.end()) {
+        return it->second;
+    }
+    HouseArchetype archetype;
+    archetype.modelName = modelName;
+    return add(archetype);
+}
+
+HouseHandle HouseRegistry::create(int id, ArchetypeId archetype, const glm::vec3& position, const glm::vec3& halfExtents,
+                                  CollisionHandle collider) {
+    uint32_t slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        slot = static_cast<uint32_t>(slots.size());
+        slots.emplace_back();
+    }
+    slots[slot].alive = true;
+
+    if (empty() || position.z <= positions[size() - 1].z) {
+        slots[slot].sequence = frontSequence + size();
+        indexSlots.push(slot);
+        ids.push(id);
+        archetypes.push(archetype);
+        positions.push(position);
+        this->halfExtents.push(halfExtents);
+        flags.push(0);
+        effectTimers.push(0.0f);
+        colliders.push(collider);
+        return { slot, slots[slot].generation };
+    }
+
+    // out of order: after the houses with the same or a larger z, the rest moves one back
+    const size_t index = std::partition_point(positions.begin(), positions.end(),
+                                              [&](const glm::vec3& p) { return p.z >= position.z; }) - positions.begin();
+    for (size_t i = index; i < size(); i++) {
+        slots[indexSlots[i]].sequence++;
+    }
+    slots[slot].sequence = frontSequence + index;
+    indexSlots.insert(index, slot);
+    ids.insert(index, id);
+    archetypes.insert(index, archetype);
+    positions.insert(index, position);
+    this->halfExtents.insert(index, halfExtents);
+    flags.insert(index, 0);
+    effectTimers.insert(index, 0.0f);
+    colliders.insert(index, collider);
+    return { slot, slots[slot].generation };
+}
+
+void HouseRegistry::popFront(size_t count) {
+    count = std::min(count, size());
+    for (size_t i = 0; i < count; i++) {
+        Slot& removed = slots[indexSlots[i]];
+        removed.alive = false;
+        removed.generation++;
+        freeSlots.push_back(indexSlots[i]);
+    }
+    frontSequence += count;
+
+    indexSlots.popFront(count);
+    ids.popFront(count);
+    archetypes.popFront(count);
+    positions.popFront(count);
+    halfExtents.popFront(count);
+    flags.popFront(count);
+    effectTimers.popFront(count);
+    colliders.popFront(count);
+}
+
+void HouseRegistry::clear() {
+    for (uint32_t slot : indexSlots) {
+        slots[slot].alive = false;
+        slots[slot].generation++;
+        freeSlots.push_back(slot);
+    }
+    frontSequence += size();
+
+    indexSlots.clear();
+    ids.clear();
+    archetypes.clear();
+    positions.clear();
+    halfExtents.clear();
+    flags.clear();
+    effectTimers.clear();
+    colliders.clear();
+}
+
+void HouseRegistry::reserve(size_t capacity) {
+    indexSlots.data.reserve(capacity);
+    ids.data.reserve(capacity);
+    archetypes.data.reserve(capacity);
+    positions.data.reserve(capacity);
+    halfExtents.data.reserve(capacity);
+    flags.data.reserve(capacity);
+    effectTimers.data.reserve(capacity);
+    colliders.data.reserve(capacity);
+    slots.reserve(capacity);
+    freeSlots.reserve(capacity);
+}
+
+size_t HouseRegistry::countBehind(float behindZ) const {
+    return std::partition_point(positions.begin(), positions.end(),
+                                [&](const glm::vec3& p) { return p.z > behindZ; }) - positions.begin();
+}
+
+std::pair<size_t, size_t> HouseRegistry::rangeZ(float minZ, float maxZ) const {
+    const glm::vec3* first = std::partition_point(positions.begin(), positions.end(),
+                                                  [&](const glm::vec3& p) { return p.z >= maxZ; });
+    const glm::vec3* last = std::partition_point(first, positions.end(),
+                                                 [&](const glm::vec3& p) { return p.z > minZ; });
+    return { static_cast<size_t>(first - positions.begin()), static_cast<size_t>(last - positions.begin()) };
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <glm/glm.hpp>
+#include "PhysicsSystem.hpp"
+
+using ArchetypeId = uint16_t;
+
+// What one kind of house is to the game and to the renderer, shared by all its houses
+struct HouseArchetype {
+    std::string modelName;                    // key of the model in the scene
+    glm::vec3 halfExtents{3.5f, 5.0f, 3.5f};  // collider and projectile hit box
+    float indicatorHeight = 7.0f;             // request cupcake above the ground
+    glm::vec3 modelScale{1.0f};
+};
+
+// House kinds interned by model name.
+//
+// Names are looked up when a house spawns, everything per frame works with the small
+// ids (the renderer keeps its models in an array indexed by them). Ids never change
+// once handed out.
+class HouseArchetypeTable {
+public:
+    HouseArchetypeTable(); // bambo_house, cyprys_house and building
+
+    ArchetypeId add(const HouseArchetype& archetype); // replaces one with the same name
+    ArchetypeId intern(const std::string& modelName); // unknown names get the default sizes
+    const HouseArchetype& get(ArchetypeId id) const { return archetypes[id]; }
+    size_t size() const { return archetypes.size(); }
+
+private:
+    std::vector<HouseArchetype> archetypes;
+    std::unordered_map<std::string, ArchetypeId> byName;
+};
+
+// Stable reference to a house, valid until the house is removed
+// (a removed house's slot is reused with a new generation)
+struct HouseHandle {
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool isValid() const { return index != UINT32_MAX; }
+    bool operator==(const HouseHandle& other) const { return index == other.index && generation == other.generation; }
+};
+
+// request state of a house (HouseRegistry::flags)
+enum HouseFlags : uint8_t {
+    HOUSE_REQUESTING = 1 << 0, // waits for a cupcake
+    HOUSE_DELIVERED = 1 << 1   // got one, cupcakes fly through until the effect ends
+};
+
+// One component of all houses, a contiguous array that loses entries at the front.
+//
+// Popping only moves the start. Appending to a full array moves the live entries back
+// to the start when at least half of it is popped and grows it otherwise, so both stay
+// O(1) amortized and the array stops allocating once it is twice the houses the road
+// holds.
+template <typename T>
+class HouseComponent {
+public:
+    T& operator[](size_t index) { return data[head + index]; }
+    const T& operator[](size_t index) const { return data[head + index]; }
+    T* begin() { return data.data() + head; }
+    T* end() { return data.data() + data.size(); }
+    const T* begin() const { return data.data() + head; }
+    const T* end() const { return data.data() + data.size(); }
+    size_t size() const { return data.size() - head; }
+
+private:
+    friend class HouseRegistry;
+
+    void push(const T& value) {
+        if (data.size() == data.capacity() && head > 0 && head >= data.size() / 2) {
+            data.erase(data.begin(), data.begin() + head);
+            head = 0;
+        }
+        data.push_back(value);
+    }
+    void insert(size_t index, const T& value) { data.insert(data.begin() + head + index, value); }
+    void popFront(size_t count) {
+        head += count;
+        if (head == data.size()) {
+            data.clear();
+            head = 0;
+        }
+    }
+    void clear() {
+        data.clear();
+        head = 0;
+    }
+
+    std::vector<T> data;
+    size_t head = 0; // entries before it are popped
+};
+
+// Houses of the game as parallel component arrays, ordered along the road.
+//
+// Entry i of every array is the same house and the arrays stay dense, so the game
+// and the renderer walk plain arrays of what they need (the movement only touches the
+// positions, the projectile test the positions and the bounds).
+//
+// Houses spawn farther and farther down the road and the world moves all of them
+// together, so the arrays stay sorted by decreasing z: entry 0 is the house nearest to
+// the camera. Houses the camera has passed leave from the front (popFront, O(1) per
+// house), and a z window is two binary searches (rangeZ). Other systems keep a
+// HouseHandle instead of an index; a slot remembers the sequence number of its house,
+// which stays valid while houses leave from the front.
+//
+// The arrays are public for the systems to read and write, but only create, popFront
+// and clear may change their length. Positions may change only all at once (the
+// scroll), anything else would break the order.
+class HouseRegistry {
+public:
+    // appended in O(1) when z is not ahead of the last house, otherwise inserted at
+    // its place in O(n)
+    HouseHandle create(int id, ArchetypeId archetype, const glm::vec3& position, const glm::vec3& halfExtents,
+                       CollisionHandle collider);
+    void popFront(size_t count = 1); // the nearest houses
+    void clear();
+    void reserve(size_t capacity);
+
+    bool isAlive(HouseHandle handle) const {
+        return handle.index < slots.size() && slots[handle.index].alive && slots[handle.index].generation == handle.generation;
+    }
+    // index of a live house, SIZE_MAX for stale handles
+    size_t indexOf(HouseHandle handle) const {
+        return isAlive(handle) ? static_cast<size_t>(slots[handle.index].sequence - frontSequence) : SIZE_MAX;
+    }
+    HouseHandle handleAt(size_t index) const { return { indexSlots[index], slots[indexSlots[index]].generation }; }
+
+    // number of houses at the front with z > behindZ, the ones the camera has passed
+    size_t countBehind(float behindZ) const;
+    // [first, last) of the houses with minZ < z < maxZ
+    std::pair<size_t, size_t> rangeZ(float minZ, float maxZ) const;
+
+    size_t size() const { return ids.size(); }
+    bool empty() const { return ids.size() == 0; }
+
+    // components
+    HouseComponent<int> ids;                   // game id (log, shadow caster id)
+    HouseComponent<ArchetypeId> archetypes;
+    HouseComponent<glm::vec3> positions;       // transform, moves with the world
+    HouseComponent<glm::vec3> halfExtents;     // bounds around the position
+    HouseComponent<uint8_t> flags;             // HouseFlags
+    HouseComponent<float> effectTimers;        // delivery effect, seconds left
+    HouseComponent<CollisionHandle> colliders; // box in the physics world, removed with the house
+
+private:
+    struct Slot {
+        uint64_t sequence = 0; // frontSequence + index of the house
+        uint32_t generation = 0;
+        bool alive = false;
+    };
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+    HouseComponent<uint32_t> indexSlots; // slot of every house
+    uint64_t frontSequence = 0;          // sequence of entry 0
+};
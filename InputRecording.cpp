@@ -0,0 +1,222 @@
+#include "InputRecording.hpp"
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+const char MAGIC[4] = { 'C', 'C', 'I', 'R' };
+constexpr size_t HEADER_SIZE = 4 + 2 + 2 + 8 + 4 + 4;
+
+// the application only runs on x86, little endian values are copied as they are
+template <typename T>
+void put(std::vector<uint8_t>& out, T value) {
+    uint8_t bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+void putVarint(std::vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// GLFW_KEY_UNKNOWN is -1
+void putSigned(std::vector<uint8_t>& out, int32_t value) {
+    putVarint(out, (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31));
+}
+
+// reads of a frame fail softly, a frame cut off at the end is dropped
+struct Reader {
+    const std::vector<uint8_t>& data;
+    size_t position;
+    bool ok = true;
+
+    template <typename T>
+    T get() {
+        T value{};
+        if (position + sizeof(T) > data.size()) {
+            ok = false;
+            return value;
+        }
+        std::memcpy(&value, data.data() + position, sizeof(T));
+        position += sizeof(T);
+        return value;
+    }
+
+    uint32_t getVarint() {
+        uint32_t value = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            if (position >= data.size()) {
+                ok = false;
+                return 0;
+            }
+            const uint8_t byte = data[position++];
+            value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+        ok = false;
+        return 0;
+    }
+
+    int32_t getSigned() {
+        const uint32_t value = getVarint();
+        return static_cast<int32_t>((value >> 1) ^ (~(value & 1) + 1));
+    }
+};
+
+}
+
+InputRecorder::~InputRecorder() {
+    finish();
+}
+
+void InputRecorder::begin(const std::filesystem::path& path, const InputRecordingInfo& info) {
+    finish();
+
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("Zaznam vstupu '" + path.string() + "' nelze zapsat");
+    }
+
+    std::vector<uint8_t> header;
+    header.insert(header.end(), MAGIC, MAGIC + 4);
+    put<uint16_t>(header, VERSION);
+    put<uint16_t>(header, 0);
+    put<uint64_t>(header, info.masterSeed);
+    put<float>(header, info.stepRate);
+    put<float>(header, info.timeScale);
+    file.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+
+    pending.clear();
+    frames = 0;
+}
+
+void InputRecorder::finish() {
+    if (file.is_open()) {
+        file.close();
+    }
+    pending.clear();
+}
+
+void InputRecorder::record(const InputEvent& event) {
+    if (isRecording()) {
+        pending.push_back(event);
+    }
+}
+
+void InputRecorder::recordFrame(float delta) {
+    if (!isRecording()) {
+        return;
+    }
+
+    buffer.clear();
+    put<float>(buffer, delta);
+    putVarint(buffer, static_cast<uint32_t>(pending.size()));
+    for (const InputEvent& event : pending) {
+        buffer.push_back(static_cast<uint8_t>(event.type));
+        switch (event.type) {
+        case InputEventType::KEY:
+            putSigned(buffer, event.code);
+            putSigned(buffer, event.scancode);
+            buffer.push_back(static_cast<uint8_t>(event.action));
+            buffer.push_back(static_cast<uint8_t>(event.mods));
+            break;
+        case InputEventType::MOUSE_BUTTON:
+            buffer.push_back(static_cast<uint8_t>(event.code));
+            buffer.push_back(static_cast<uint8_t>(event.action));
+            buffer.push_back(static_cast<uint8_t>(event.mods));
+            break;
+        case InputEventType::CURSOR:
+        case InputEventType::SCROLL:
+            put<float>(buffer, event.x);
+            put<float>(buffer, event.y);
+            break;
+        }
+    }
+    pending.clear();
+
+    // the stream buffers the writes, a frame costs no system call
+    file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+    frames++;
+}
+
+void InputReplay::load(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Zaznam vstupu '" + path.string() + "' nelze otevrit");
+    }
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+    if (data.size() < HEADER_SIZE || std::memcmp(data.data(), MAGIC, 4) != 0) {
+        throw std::runtime_error("'" + path.string() + "' neni zaznam vstupu");
+    }
+    Reader reader{ data, 4 };
+    const uint16_t version = reader.get<uint16_t>();
+    if (version != InputRecorder::VERSION) {
+        throw std::runtime_error("Zaznam vstupu '" + path.string() + "' ma nepodporovanou verzi " + std::to_string(version));
+    }
+    reader.get<uint16_t>();
+    info.masterSeed = reader.get<uint64_t>();
+    info.stepRate = reader.get<float>();
+    info.timeScale = reader.get<float>();
+
+    firstFrame = reader.position;
+    rewind();
+}
+
+void InputReplay::rewind() {
+    position = firstFrame;
+    frameIndex = 0;
+}
+
+bool InputReplay::nextFrame(InputFrame& frame) {
+    if (atEnd()) {
+        return false;
+    }
+
+    Reader reader{ data, position };
+    frame.delta = reader.get<float>();
+    const uint32_t count = reader.getVarint();
+    frame.events.clear();
+    for (uint32_t i = 0; i < count && reader.ok; i++) {
+        InputEvent event;
+        event.type = static_cast<InputEventType>(reader.get<uint8_t>());
+        switch (event.type) {
+        case InputEventType::KEY:
+            event.code = reader.getSigned();
+            event.scancode = reader.getSigned();
+            event.action = reader.get<uint8_t>();
+            event.mods = reader.get<uint8_t>();
+            break;
+        case InputEventType::MOUSE_BUTTON:
+            event.code = reader.get<uint8_t>();
+            event.action = reader.get<uint8_t>();
+            event.mods = reader.get<uint8_t>();
+            break;
+        case InputEventType::CURSOR:
+        case InputEventType::SCROLL:
+            event.x = reader.get<float>();
+            event.y = reader.get<float>();
+            break;
+        default:
+            reader.ok = false; // damaged, the rest cannot be trusted
+            break;
+        }
+        frame.events.push_back(event);
+    }
+
+    if (!reader.ok) {
+        position = data.size();
+        return false;
+    }
+    position = reader.position;
+    frameIndex++;
+    return true;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+
+enum class InputEventType : uint8_t {
+    KEY,
+    MOUSE_BUTTON,
+    CURSOR, // x, y = offset of the cursor since the previous event, as the camera gets it
+    SCROLL
+};
+
+// One input callback, with what the handlers of the application use
+struct InputEvent {
+    InputEventType type = InputEventType::KEY;
+    int32_t code = 0;     // key or mouse button
+    int32_t scancode = 0; // KEY
+    int32_t action = 0;   // GLFW_PRESS, GLFW_RELEASE, GLFW_REPEAT
+    int32_t mods = 0;
+    float x = 0.0f;       // CURSOR, SCROLL
+    float y = 0.0f;
+};
+
+// The input of one frame: events that arrived before it and its real frame time
+struct InputFrame {
+    float delta = 0.0f; // seconds, what TimeService measured
+    std::vector<InputEvent> events;
+};
+
+// Header of a recording. The seed and the clock settings are all that is random or
+// machine dependent in a session besides the input.
+struct InputRecordingInfo {
+    uint64_t masterSeed = 0;
+    float stepRate = 60.0f;
+    float timeScale = 1.0f;
+};
+
+// Writes the input of a session to a binary file (.ccir).
+//
+// Layout, little endian: "CCIR", u16 version, u16 reserved, u64 master seed, f32 step
+// rate, f32 time scale, then one record per frame: f32 frame time, varint event count
+// and the events (u8 type, then zigzag varints for a key, bytes for a mouse button and
+// two f32 for cursor and scroll). A frame without input takes 5 bytes.
+class InputRecorder {
+public:
+    static constexpr uint16_t VERSION = 1;
+
+    InputRecorder() = default;
+    ~InputRecorder();
+
+    InputRecorder(const InputRecorder&) = delete;
+    InputRecorder& operator=(const InputRecorder&) = delete;
+
+    void begin(const std::filesystem::path& path, const InputRecordingInfo& info); // throws when it cannot write
+    void finish();
+    bool isRecording() const { return file.is_open(); }
+
+    void record(const InputEvent& event);  // kept for the next frame
+    void recordFrame(float delta);          // once per frame, with the events since the last one
+    uint64_t getFrameCount() const { return frames; }
+
+private:
+    std::ofstream file;
+    std::vector<InputEvent> pending;
+    std::vector<uint8_t> buffer; // encoded frame
+    uint64_t frames = 0;
+};
+
+// Reads a recording back frame by frame.
+//
+// The whole file is loaded at once, a recording is small (an hour at 144 FPS without
+// input is 2.5 MB). A frame cut off at the end (the recording application crashed)
+// ends the replay.
+class InputReplay {
+public:
+    void load(const std::filesystem::path& path); // throws on a missing or foreign file
+
+    const InputRecordingInfo& getInfo() const { return info; }
+    bool nextFrame(InputFrame& frame); // false after the last frame
+    bool atEnd() const { return position >= data.size(); }
+    uint64_t getFrameIndex() const { return frameIndex; } // frames read so far
+    void rewind();
+
+private:
+    std::vector<uint8_t> data;
+    size_t firstFrame = 0; // offset after the header
+    size_t position = 0;
+    uint64_t frameIndex = 0;
+    InputRecordingInfo info;
+};
@@ -0,0 +1,130 @@
+#include "JobPool.hpp"
+#include <algorithm>
+
+namespace {
+
+thread_local const JobPool* currentPool = nullptr;
+thread_local size_t currentIndex = SIZE_MAX;
+
+}
+
+JobPool::JobPool(size_t threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < threads; i++) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (size_t i = 0; i < threads; i++) {
+        workers.emplace_back(&JobPool::workerLoop, this, i);
+    }
+}
+
+JobPool::~JobPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+size_t JobPool::currentWorker() const {
+    return currentPool == this ? currentIndex : SIZE_MAX;
+}
+
+void JobPool::submit(std::function<void()> job) {
+    size_t index = currentWorker();
+    if (index == SIZE_MAX) {
+        index = nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    }
+    // counted before a worker can see the job, so finishing it never takes the counters
+    // below zero and a parent job keeps pending above zero until it returns
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queued++;
+        pending++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->jobs.push_back(std::move(job));
+    }
+    wake.notify_one();
+}
+
+void JobPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return pending == 0; });
+    if (error) {
+        std::exception_ptr thrown = error;
+        error = nullptr;
+        std::rethrow_exception(thrown);
+    }
+}
+
+bool JobPool::take(size_t worker, std::function<void()>& job) {
+    {
+        Queue& own = *queues[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+            return true;
+        }
+    }
+    // the victims in order after this worker, so the thieves spread over the pool
+    for (size_t i = 1; i < queues.size(); i++) {
+        Queue& victim = *queues[(worker + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            steals.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobPool::workerLoop(size_t index) {
+    currentPool = this;
+    currentIndex = index;
+
+    std::function<void()> job;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return queued > 0 || quit; });
+            if (quit) {
+                return;
+            }
+        }
+        // another worker may have been faster, then the counter says there is more to wait for
+        if (!take(index, job)) {
+            std::this_thread::yield();
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queued--;
+        }
+
+        std::exception_ptr thrown;
+        try {
+            job();
+        } catch (...) {
+            thrown = std::current_exception();
+        }
+        job = nullptr;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (thrown && !error) {
+            error = thrown;
+        }
+        if (--pending == 0) {
+            idle.notify_all();
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <cstddef>
+
+// Work-stealing pool of worker threads for independent jobs.
+//
+// Every worker has its own deque. It takes its newest job from the back and, when the
+// deque is empty, steals the oldest job from the front of another worker's deque, so
+// long and short jobs even out without a shared queue every worker contends on. Jobs
+// submitted from outside are spread round-robin, a job that submits more puts them in
+// its own worker's deque. An exception of a job is rethrown by wait(); jobs not started
+// when the pool is destroyed are dropped.
+class JobPool {
+public:
+    explicit JobPool(size_t threads = 0); // 0 = one per hardware thread
+    ~JobPool();
+
+    JobPool(const JobPool&) = delete;
+    JobPool& operator=(const JobPool&) = delete;
+
+    void submit(std::function<void()> job);
+    void wait(); // until every submitted job has finished
+
+    size_t getThreadCount() const { return workers.size(); }
+    // index of the calling worker of this pool, SIZE_MAX on other threads
+    size_t currentWorker() const;
+    // jobs taken from another worker's deque so far
+    size_t getStealCount() const { return steals.load(std::memory_order_relaxed); }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> jobs;
+    };
+
+    bool take(size_t worker, std::function<void()>& job);
+    void workerLoop(size_t index);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> nextQueue{0};
+    std::atomic<size_t> steals{0};
+
+    std::mutex mutex;
+    std::condition_variable wake; // jobs queued or quit
+    std::condition_variable idle; // pending dropped to 0
+    size_t queued = 0;  // in the deques, guarded by mutex
+    size_t pending = 0; // submitted and not finished, guarded by mutex
+    bool quit = false;  // guarded by mutex
+    std::exception_ptr error; // first exception of a job, guarded by mutex
+};
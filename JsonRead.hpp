@@ -0,0 +1,11 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+// Reads an optional field of a settings object, a missing or null one keeps the value
+template <typename T>
+void readJson(const nlohmann::json& object, const char* key, T& value) {
+    if (object.contains(key) && !object[key].is_null()) {
+        value = object[key].get<T>();
+    }
+}
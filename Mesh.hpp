@@ -28,6 +28,10 @@ public:
     glm::vec4 diffuse_material{1.0f};  // white, non-transparent
     glm::vec4 specular_material{1.0f}; // white, non-transparent
     float reflectivity{1.0f};
+
+    // model space bounding box
+    glm::vec3 bounds_min{0.0f};
+    glm::vec3 bounds_max{0.0f};
     // indirect (indexed) draw
     Mesh(GLenum primitive_type, ShaderProgram &shader, std::vector<Vertex> const &vertices, std::vector<GLuint> const &indices, glm::vec3 const &origin, glm::vec3 const &orientation, GLuint const texture_id = 0) : primitive_type(primitive_type),
                                                                                                                                                                                                                       shader(shader),
@@ -67,11 +71,21 @@ public:
         glEnableVertexArrayAttrib(VAO, 2);
         glVertexArrayAttribFormat(VAO, 2, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, TexCoords));
         glVertexArrayAttribBinding(VAO, 2, 0);
+
+        if (!vertices.empty())
+        {
+            bounds_min = bounds_max = vertices[0].Position;
+            for (const auto &v : vertices)
+            {
+                bounds_min = glm::min(bounds_min, v.Position);
+                bounds_max = glm::max(bounds_max, v.Position);
+            }
+        }
     }
 
     // Move constructor
     Mesh(Mesh &&other) noexcept
-        : origin(other.origin), orientation(other.orientation), texture_id(other.texture_id), primitive_type(other.primitive_type), shader(other.shader), ambient_material(other.ambient_material), diffuse_material(other.diffuse_material), specular_material(other.specular_material), reflectivity(other.reflectivity), VAO(other.VAO), VBO(other.VBO), EBO(other.EBO), vertices(std::move(other.vertices)), indices(std::move(other.indices))
+        : origin(other.origin), orientation(other.orientation), texture_id(other.texture_id), primitive_type(other.primitive_type), shader(other.shader), ambient_material(other.ambient_material), diffuse_material(other.diffuse_material), specular_material(other.specular_material), reflectivity(other.reflectivity), bounds_min(other.bounds_min), bounds_max(other.bounds_max), VAO(other.VAO), VBO(other.VBO), EBO(other.EBO), vertices(std::move(other.vertices)), indices(std::move(other.indices))
     {
         // Reset other's OpenGL handles to prevent double deletion
         other.VAO = 0;
@@ -96,6 +110,8 @@ public:
             diffuse_material = other.diffuse_material;
             specular_material = other.specular_material;
             reflectivity = other.reflectivity;
+            bounds_min = other.bounds_min;
+            bounds_max = other.bounds_max;
             VAO = other.VAO;
             VBO = other.VBO;
             EBO = other.EBO;
@@ -220,6 +236,16 @@ public:
         shader.deactivate();
     }
 
+    // draw only the geometry, the caller is responsible for the active program and uniforms
+    void draw_geometry()
+    {
+        if (VAO == 0)
+            return;
+        glBindVertexArray(VAO);
+        glDrawElements(primitive_type, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0);
+        glBindVertexArray(0);
+    }
+
     void clear(void)
     {
         texture_id = 0;
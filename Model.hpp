@@ -25,6 +25,10 @@ public:
     glm::vec3 scale{1.0f, 1.0f, 1.0f};  // default scale to 1.0
     glm::mat4 local_model_matrix{1.0f}; // for complex transformations (identity matrix)
 
+    // model space bounding box of all meshes
+    glm::vec3 bounds_min{0.0f};
+    glm::vec3 bounds_max{0.0f};
+
     ShaderProgram &shader;
 
     // Constructor
@@ -52,6 +56,7 @@ public:
             mesh.diffuse_material = glm::vec4(mesh_data.diffuse_color, 1.0f);
             meshes.push_back(std::move(mesh));
         }
+        compute_bounds();
     }
 
     // Constructor with texture
@@ -92,11 +97,12 @@ public:
             mesh.diffuse_material = glm::vec4(mesh_data.diffuse_color, 1.0f);
             meshes.push_back(std::move(mesh));
         }
+        compute_bounds();
     }
 
     // Move constructor
     Model(Model &&other) noexcept
-        : meshes(std::move(other.meshes)), name(std::move(other.name)), origin(other.origin), orientation(other.orientation), shader(other.shader) {}
+        : meshes(std::move(other.meshes)), name(std::move(other.name)), origin(other.origin), orientation(other.orientation), bounds_min(other.bounds_min), bounds_max(other.bounds_max), shader(other.shader) {}
 
     // Move assignment operator
     Model &operator=(Model &&other) noexcept
@@ -107,6 +113,8 @@ public:
             name = std::move(other.name);
             origin = other.origin;
             orientation = other.orientation;
+            bounds_min = other.bounds_min;
+            bounds_max = other.bounds_max;
             // shader reference stays the same
         }
         return *this;
@@ -121,9 +129,9 @@ public:
     {
         // origin += glm::vec3(3,0,0) * delta_t; // s = s0 + v*dt
     }
-    void draw(glm::vec3 const &offset = glm::vec3(0.0),
-              glm::vec3 const &rotation = glm::vec3(0.0f),
-              glm::vec3 const &scale_change = glm::vec3(1.0f))
+    glm::mat4 get_model_matrix(glm::vec3 const &offset = glm::vec3(0.0),
+                               glm::vec3 const &rotation = glm::vec3(0.0f),
+                               glm::vec3 const &scale_change = glm::vec3(1.0f)) const
     {
         // compute complete transformation
         glm::mat4 t = glm::translate(glm::mat4(1.0f), origin);
@@ -138,20 +146,45 @@ public:
         glm::mat4 m_rz = glm::rotate(glm::mat4(1.0f), rotation.z, glm::vec3(0.0f, 0.0f, 1.0f));
         glm::mat4 m_s = glm::scale(glm::mat4(1.0f), scale_change);
 
-        glm::mat4 model_matrix = local_model_matrix * s * rz * ry * rx * t * m_s * m_rz * m_ry * m_rx * m_off;
+        return s * rz * ry * rx * t * m_s * m_rz * m_ry * m_rx * m_off;
+    }
+
+    void draw(glm::vec3 const &offset = glm::vec3(0.0),
+              glm::vec3 const &rotation = glm::vec3(0.0f),
+              glm::vec3 const &scale_change = glm::vec3(1.0f))
+    {
+        draw(get_model_matrix(offset, rotation, scale_change));
+    }
 
-        // call draw() on mesh (all meshes)
+    void draw(glm::mat4 const &model_matrix)
+    {
         for (auto &mesh : meshes)
         {
-            mesh.draw(model_matrix);
+            mesh.draw(local_model_matrix * model_matrix);
         }
     }
 
-    void draw(glm::mat4 const &model_matrix)
+    // draw geometry only with an already active program (depth passes etc.)
+    void draw_geometry(ShaderProgram &program, glm::mat4 const &model_matrix)
     {
+        program.setUniform("uM_m", local_model_matrix * model_matrix);
         for (auto &mesh : meshes)
         {
-            mesh.draw(local_model_matrix * model_matrix);
+            mesh.draw_geometry();
+        }
+    }
+
+private:
+    void compute_bounds()
+    {
+        if (meshes.empty())
+            return;
+        bounds_min = meshes[0].bounds_min;
+        bounds_max = meshes[0].bounds_max;
+        for (const auto &mesh : meshes)
+        {
+            bounds_min = glm::min(bounds_min, mesh.bounds_min);
+            bounds_max = glm::max(bounds_max, mesh.bounds_max);
         }
     }
 };
@@ -0,0 +1,260 @@
+#include "ParticleCollision.hpp"
+#include "PhysicsSystem.hpp"
+#include <limits>
+
+ParticleCollisionGrid::ParticleCollisionGrid() {
+    build(nullptr);
+}
+
+bool ParticleCollisionGrid::needsRebuild(const PhysicsSystem* physics) const {
+    return physics != source ||
+           (physics && (physics->getRevision() != sourceRevision || physics->getTerrainRevision() != sourceTerrainRevision));
+}
+
+void ParticleCollisionGrid::build(const PhysicsSystem* physics) {
+    source = physics;
+    sourceRevision = physics ? physics->getRevision() : 0;
+    sourceTerrainRevision = physics ? physics->getTerrainRevision() : 0;
+    solidOffset = physics ? physics->getWorldOffset() : glm::vec3(0.0f);
+    solidColliders = 0;
+
+    if (!physics) {
+        solidOrigin = glm::vec3(0.0f);
+        solidDims = glm::ivec3(1);
+        solidBits.assign(1, 0u);
+        terrainOrigin = glm::vec2(0.0f);
+        terrainDims = glm::ivec2(1);
+        terrain.assign(1, 0.0f);
+        terrainKey = TerrainKey(); // resampled for the next world
+        return;
+    }
+
+    const WorldBounds& bounds = physics->getWorldBounds();
+    const std::vector<CollisionObject>& objects = physics->getCollisionObjects();
+
+    // Terrain columns over the whole world, floor planes raise the ground
+    float floorLevel = -std::numeric_limits<float>::infinity();
+    for (const auto& obj : objects) {
+        if (obj.isStatic && obj.type == CollisionType::PLANE) {
+            floorLevel = std::max(floorLevel, obj.position.y);
+        }
+    }
+
+    // houses come and go all the time, the terrain only changes with the bounds and
+    // the terrain revision (the world scrolling over it)
+    const TerrainKey key{ glm::vec4(bounds.min.x, bounds.min.z, bounds.max.x, bounds.max.z), floorLevel,
+                          physics->getTerrainRevision() };
+    if (terrain.empty() || key != terrainKey) {
+        buildTerrain(*physics, floorLevel);
+        terrainKey = key;
+    }
+
+    // Occupancy grid over the static boxes and spheres (same extents as PhysicsSystem uses).
+    // Not clipped to the world bounds: the colliders scroll through them between rebuilds.
+    glm::vec3 solidMin(std::numeric_limits<float>::max());
+    glm::vec3 solidMax(-std::numeric_limits<float>::max());
+    for (const auto& obj : objects) {
+        if (!obj.isStatic || obj.type == CollisionType::PLANE) {
+            continue;
+        }
+        const glm::vec3 half = obj.type == CollisionType::BOX ? obj.size * 0.5f : glm::vec3(obj.size.x);
+        solidMin = glm::min(solidMin, obj.position - half);
+        solidMax = glm::max(solidMax, obj.position + half);
+        solidColliders++;
+    }
+
+    if (solidColliders == 0 || glm::any(glm::greaterThanEqual(solidMin, solidMax))) {
+        solidOrigin = glm::vec3(0.0f);
+        solidDims = glm::ivec3(1);
+        solidBits.assign(1, 0u);
+        return;
+    }
+
+    resizeSolid(solidMin, solidMax);
+    for (const auto& obj : objects) {
+        if (!obj.isStatic) {
+            continue;
+        }
+        if (obj.type == CollisionType::BOX) {
+            fillBox(obj.position - obj.size * 0.5f, obj.position + obj.size * 0.5f);
+        } else if (obj.type == CollisionType::SPHERE) {
+            fillSphere(obj.position, obj.size.x);
+        }
+    }
+}
+
+void ParticleCollisionGrid::buildTerrain(const PhysicsSystem& physics, float floorLevel) {
+    const WorldBounds& bounds = physics.getWorldBounds();
+    const glm::vec2 worldSize(bounds.max.x - bounds.min.x, bounds.max.z - bounds.min.z);
+    terrainCellSize = std::max(TERRAIN_CELL_SIZE, std::sqrt(worldSize.x * worldSize.y / MAX_TERRAIN_CELLS));
+    terrainInvCellSize = 1.0f / terrainCellSize;
+    terrainOrigin = glm::vec2(bounds.min.x, bounds.min.z);
+    terrainDims = glm::max(glm::ivec2(glm::ceil(worldSize * terrainInvCellSize)), glm::ivec2(1));
+    terrain.resize(static_cast<size_t>(terrainDims.x) * terrainDims.y);
+    for (int iz = 0; iz < terrainDims.y; iz++) {
+        for (int ix = 0; ix < terrainDims.x; ix++) {
+            const glm::vec3 center(terrainOrigin.x + (ix + 0.5f) * terrainCellSize, 0.0f,
+                                   terrainOrigin.y + (iz + 0.5f) * terrainCellSize);
+            terrain[static_cast<size_t>(iz) * terrainDims.x + ix] = std::max(physics.getHeightAtPosition(center), floorLevel);
+        }
+    }
+}
+
+void ParticleCollisionGrid::resizeSolid(const glm::vec3& min, const glm::vec3& max) {
+    const glm::vec3 size = max - min;
+    solidCellSize = std::max(SOLID_CELL_SIZE, std::cbrt(size.x * size.y * size.z / MAX_SOLID_CELLS));
+    solidInvCellSize = 1.0f / solidCellSize;
+    solidOrigin = min;
+    solidDims = glm::max(glm::ivec3(glm::ceil(size * solidInvCellSize)), glm::ivec3(1));
+    solidBits.assign((getSolidCellCount() + 31) / 32, 0u);
+}
+
+void ParticleCollisionGrid::setSolid(int ix, int iy, int iz) {
+    const size_t cell = (static_cast<size_t>(iz) * solidDims.y + iy) * solidDims.x + ix;
+    solidBits[cell >> 5] |= 1u << (cell & 31);
+}
+
+void ParticleCollisionGrid::fillBox(const glm::vec3& min, const glm::vec3& max) {
+    // cells whose center lies inside the box, at least one cell per axis for thin boxes
+    const glm::vec3 lo = (min - solidOrigin) * solidInvCellSize - 0.5f;
+    const glm::vec3 hi = (max - solidOrigin) * solidInvCellSize - 0.5f;
+    glm::ivec3 first(glm::ceil(lo));
+    glm::ivec3 last(glm::floor(hi));
+    const glm::ivec3 middle(glm::floor((lo + hi) * 0.5f + 0.5f));
+    for (int axis = 0; axis < 3; axis++) {
+        if (last[axis] < first[axis]) {
+            first[axis] = last[axis] = middle[axis];
+        }
+    }
+    first = glm::max(first, glm::ivec3(0));
+    last = glm::min(last, solidDims - 1);
+
+    for (int iz = first.z; iz <= last.z; iz++) {
+        for (int iy = first.y; iy <= last.y; iy++) {
+            for (int ix = first.x; ix <= last.x; ix++) {
+                setSolid(ix, iy, iz);
+            }
+        }
+    }
+}
+
+void ParticleCollisionGrid::fillSphere(const glm::vec3& center, float radius) {
+    const glm::ivec3 first = glm::max(glm::ivec3(glm::floor((center - radius - solidOrigin) * solidInvCellSize)), glm::ivec3(0));
+    const glm::ivec3 last = glm::min(glm::ivec3(glm::floor((center + radius - solidOrigin) * solidInvCellSize)), solidDims - 1);
+
+    for (int iz = first.z; iz <= last.z; iz++) {
+        for (int iy = first.y; iy <= last.y; iy++) {
+            for (int ix = first.x; ix <= last.x; ix++) {
+                const glm::vec3 cellCenter = solidOrigin + (glm::vec3(ix, iy, iz) + 0.5f) * solidCellSize;
+                const glm::vec3 offset = cellCenter - center;
+                if (glm::dot(offset, offset) <= radius * radius) {
+                    setSolid(ix, iy, iz);
+                }
+            }
+        }
+    }
+}
+
+ParticleCollisionGrid::SolidHeader ParticleCollisionGrid::getSolidHeader() const {
+    return { glm::vec4(solidOrigin, solidCellSize), glm::ivec4(solidDims, 0) };
+}
+
+ParticleCollisionGrid::TerrainHeader ParticleCollisionGrid::getTerrainHeader() const {
+    return { glm::vec4(terrainOrigin.x, 0.0f, terrainOrigin.y, terrainCellSize), glm::ivec4(terrainDims.x, 0, terrainDims.y, 0) };
+}
+
+ParticleSpatialHash::ParticleSpatialHash(float cellSize)
+    : cellSize(cellSize), invCellSize(1.0f / cellSize) {
+    clear();
+}
+
+void ParticleSpatialHash::clear() {
+    staged.clear();
+    sorted.clear();
+    bucketMask = 0;
+    bucketStart.assign(2, 0u);
+}
+
+glm::ivec3 ParticleSpatialHash::cellOf(const glm::vec3& position) const {
+    return glm::ivec3(static_cast<int>(std::floor(position.x * invCellSize)),
+                      static_cast<int>(std::floor(position.y * invCellSize)),
+                      static_cast<int>(std::floor(position.z * invCellSize)));
+}
+
+uint32_t ParticleSpatialHash::bucketOf(const glm::ivec3& cell) const {
+    const uint32_t h = (static_cast<uint32_t>(cell.x) * 73856093u) ^ (static_cast<uint32_t>(cell.y) * 19349663u) ^
+                       (static_cast<uint32_t>(cell.z) * 83492791u);
+    return h & bucketMask;
+}
+
+void ParticleSpatialHash::build() {
+    // about two buckets per particle keeps the chains short
+    uint32_t buckets = 64;
+    while (buckets < 2 * staged.size() && buckets < (1u << 24)) {
+        buckets <<= 1;
+    }
+    bucketMask = buckets - 1;
+
+    // counting sort: bucket sizes, prefix sums, scatter
+    stagedBuckets.resize(staged.size());
+    bucketStart.assign(buckets + 1, 0u);
+    for (size_t i = 0; i < staged.size(); i++) {
+        stagedBuckets[i] = bucketOf(cellOf(staged[i]));
+        bucketStart[stagedBuckets[i]]++;
+    }
+    for (uint32_t b = 1; b < buckets; b++) {
+        bucketStart[b] += bucketStart[b - 1];
+    }
+    bucketStart[buckets] = static_cast<uint32_t>(staged.size());
+
+    // bucketStart[b] is now the end of bucket b, the scatter moves it to its start
+    sorted.resize(staged.size());
+    for (size_t i = staged.size(); i-- > 0;) {
+        sorted[--bucketStart[stagedBuckets[i]]] = staged[i];
+    }
+    staged.clear();
+}
+
+template <typename Inside>
+bool ParticleSpatialHash::anyIn(const glm::vec3& boxMin, const glm::vec3& boxMax, Inside inside) const {
+    if (sorted.empty()) {
+        return false;
+    }
+
+    const glm::ivec3 first = cellOf(boxMin);
+    const glm::ivec3 last = cellOf(boxMax);
+    const glm::dvec3 span = glm::dvec3(last - first) + 1.0;
+
+    // a volume over more cells than there are buckets is cheaper to scan
+    if (span.x * span.y * span.z > static_cast<double>(bucketMask + 1)) {
+        return std::any_of(sorted.begin(), sorted.end(), inside);
+    }
+
+    for (int z = first.z; z <= last.z; z++) {
+        for (int y = first.y; y <= last.y; y++) {
+            for (int x = first.x; x <= last.x; x++) {
+                const uint32_t bucket = bucketOf(glm::ivec3(x, y, z));
+                // the bucket may also hold other cells, every position is tested
+                for (uint32_t i = bucketStart[bucket]; i < bucketStart[bucket + 1]; i++) {
+                    if (inside(sorted[i])) {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
+
+bool ParticleSpatialHash::anyInBox(const glm::vec3& boxMin, const glm::vec3& boxMax) const {
+    return anyIn(boxMin, boxMax, [&](const glm::vec3& p) {
+        return glm::all(glm::greaterThanEqual(p, boxMin)) && glm::all(glm::lessThanEqual(p, boxMax));
+    });
+}
+
+bool ParticleSpatialHash::anyInSphere(const glm::vec3& center, float radius) const {
+    return anyIn(center - radius, center + radius, [&](const glm::vec3& p) {
+        const glm::vec3 offset = p - center;
+        return glm::dot(offset, offset) <= radius * radius;
+    });
+}
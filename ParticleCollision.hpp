@@ -0,0 +1,148 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+class PhysicsSystem;
+
+// Static collision world of the particles, rasterized from a PhysicsSystem.
+//
+// Static colliders are voxelized into a coarse occupancy grid (one bit per cell) and
+// the terrain height function is sampled into a grid of columns, so a particle needs
+// two array lookups instead of a test against every collider. The grid is rebuilt
+// when the colliders of the physics world change (see PhysicsSystem::getRevision), the
+// terrain columns when the terrain or its offset does (getTerrainRevision). The
+// occupancy grid is in road space like the colliders, the lookups shift it by the
+// world offset (setSolidOffset), so a scrolling world needs no rebuild.
+// Dynamic colliders are not part of the grid.
+class ParticleCollisionGrid {
+public:
+    static constexpr float SOLID_CELL_SIZE = 0.5f;   // meters, grows when the colliders cover a large area
+    static constexpr float TERRAIN_CELL_SIZE = 1.0f;
+    static constexpr size_t MAX_SOLID_CELLS = size_t(1) << 24;
+    static constexpr size_t MAX_TERRAIN_CELLS = size_t(1) << 20;
+
+    // std430 headers of the GPU copy (see particle_simulate.comp)
+    struct SolidHeader {
+        glm::vec4 originCellSize; // xyz = origin in road space, w = cell size
+        glm::ivec4 dims;
+    };
+    struct TerrainHeader {
+        glm::vec4 originCellSize; // x, z = origin, w = cell size
+        glm::ivec4 dims;          // x, z
+    };
+    // what the terrain columns were sampled from, equal keys mean equal columns (also
+    // for the grids of the two copies of a PhysicsWorker world)
+    struct TerrainKey {
+        glm::vec4 bounds{0.0f}; // world bounds x, z
+        float floor = 0.0f;     // highest floor plane
+        uint32_t revision = UINT32_MAX; // PhysicsSystem::getTerrainRevision
+        bool operator==(const TerrainKey& other) const = default;
+    };
+
+    ParticleCollisionGrid();
+
+    // null = no colliders and a flat ground at height 0
+    void build(const PhysicsSystem* physics);
+    bool needsRebuild(const PhysicsSystem* physics) const;
+    // PhysicsSystem::getWorldOffset of the world now, build takes the one of its time
+    void setSolidOffset(const glm::vec3& offset) { solidOffset = offset; }
+    const glm::vec3& getSolidOffset() const { return solidOffset; }
+
+    // world position
+    bool isSolid(float x, float y, float z) const {
+        const int ix = static_cast<int>(std::floor((x - solidOffset.x - solidOrigin.x) * solidInvCellSize));
+        const int iy = static_cast<int>(std::floor((y - solidOffset.y - solidOrigin.y) * solidInvCellSize));
+        const int iz = static_cast<int>(std::floor((z - solidOffset.z - solidOrigin.z) * solidInvCellSize));
+        if (static_cast<unsigned>(ix) >= static_cast<unsigned>(solidDims.x) ||
+            static_cast<unsigned>(iy) >= static_cast<unsigned>(solidDims.y) ||
+            static_cast<unsigned>(iz) >= static_cast<unsigned>(solidDims.z)) {
+            return false;
+        }
+        const size_t cell = (static_cast<size_t>(iz) * solidDims.y + iy) * solidDims.x + ix;
+        return (solidBits[cell >> 5] >> (cell & 31)) & 1u;
+    }
+
+    // nearest column, positions outside the grid use the closest edge column
+    float groundHeight(float x, float z) const {
+        const int ix = std::clamp(static_cast<int>(std::floor((x - terrainOrigin.x) * terrainInvCellSize)), 0, terrainDims.x - 1);
+        const int iz = std::clamp(static_cast<int>(std::floor((z - terrainOrigin.y) * terrainInvCellSize)), 0, terrainDims.y - 1);
+        return terrain[static_cast<size_t>(iz) * terrainDims.x + ix];
+    }
+
+    size_t getSolidCellCount() const { return static_cast<size_t>(solidDims.x) * solidDims.y * solidDims.z; }
+    size_t getSolidColliderCount() const { return solidColliders; }
+
+    SolidHeader getSolidHeader() const;
+    TerrainHeader getTerrainHeader() const;
+    const std::vector<uint32_t>& getSolidBits() const { return solidBits; }
+    const std::vector<float>& getTerrainHeights() const { return terrain; }
+    // revisions of the world the grid was built from, grids built from copies of a world
+    // in the same state have the same ones (PhysicsWorker); the solid cells only change
+    // with the source revision, the terrain columns with the terrain key
+    uint32_t getSourceRevision() const { return sourceRevision; }
+    uint32_t getSourceTerrainRevision() const { return sourceTerrainRevision; }
+    const TerrainKey& getTerrainKey() const { return terrainKey; }
+
+private:
+    void buildTerrain(const PhysicsSystem& physics, float floorLevel);
+    void resizeSolid(const glm::vec3& min, const glm::vec3& max);
+    void fillBox(const glm::vec3& min, const glm::vec3& max);
+    void fillSphere(const glm::vec3& center, float radius);
+    void setSolid(int ix, int iy, int iz);
+
+    glm::vec3 solidOrigin{0.0f}; // road space
+    glm::vec3 solidOffset{0.0f};
+    float solidCellSize = SOLID_CELL_SIZE;
+    float solidInvCellSize = 1.0f / SOLID_CELL_SIZE;
+    glm::ivec3 solidDims{1};
+    std::vector<uint32_t> solidBits;
+    size_t solidColliders = 0;
+
+    glm::vec2 terrainOrigin{0.0f}; // x, z
+    float terrainCellSize = TERRAIN_CELL_SIZE;
+    float terrainInvCellSize = 1.0f / TERRAIN_CELL_SIZE;
+    glm::ivec2 terrainDims{1};
+    std::vector<float> terrain;
+    TerrainKey terrainKey;
+
+    const PhysicsSystem* source = nullptr;
+    uint32_t sourceRevision = 0;
+    uint32_t sourceTerrainRevision = 0;
+};
+
+// Particle positions of one frame hashed into a uniform grid of cells.
+//
+// Built once per frame (counting sort by bucket, positions are stored sorted) and
+// answers "is there a particle inside this volume" from the few buckets the volume
+// overlaps instead of scanning all particles.
+class ParticleSpatialHash {
+public:
+    explicit ParticleSpatialHash(float cellSize = 2.0f);
+
+    void clear();
+    void add(float x, float y, float z) { staged.emplace_back(x, y, z); }
+    void build(); // sorts the added positions into the buckets
+
+    size_t count() const { return sorted.size(); }
+    bool anyInBox(const glm::vec3& boxMin, const glm::vec3& boxMax) const;
+    bool anyInSphere(const glm::vec3& center, float radius) const;
+
+private:
+    glm::ivec3 cellOf(const glm::vec3& position) const;
+    uint32_t bucketOf(const glm::ivec3& cell) const;
+    template <typename Inside>
+    bool anyIn(const glm::vec3& boxMin, const glm::vec3& boxMax, Inside inside) const;
+
+    float cellSize;
+    float invCellSize;
+    uint32_t bucketMask = 0;
+    std::vector<glm::vec3> staged;
+    std::vector<uint32_t> stagedBuckets;
+    std::vector<uint32_t> bucketStart; // bucketMask + 2 entries, bucket b = [start[b], start[b + 1])
+    std::vector<glm::vec3> sorted;
+};
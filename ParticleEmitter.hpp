@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// Particle types for different effects, each has a policy in ParticleTypes.hpp
+enum class ParticleType {
+    GLOW,    // Original green glow particles
+    SMOKE,   // Smoke particles with texture
+    SPARK    // Short lived sparks of a delivery
+};
+constexpr int PARTICLE_TYPE_COUNT = 3;
+
+// Volume in which an emitter spawns its particles
+enum class EmitterShape {
+    POINT,
+    SPHERE,  // radius = extents.x
+    BOX      // half extents
+};
+
+// Persistent emitter of a ParticleSystem.
+//
+// An emitter spawns rate particles per second (independent of the frame rate, the
+// fractional part is carried over to the next frame). When the emitters together ask
+// for more particles than the global budget allows, emitters with a higher priority
+// are served first and the rest of the requests is dropped.
+struct ParticleEmitterDesc {
+    ParticleType type = ParticleType::GLOW;
+    EmitterShape shape = EmitterShape::POINT;
+    glm::vec3 position{0.0f};
+    glm::vec3 extents{0.0f};
+    float rate = 0.0f;           // particles per second
+    float lifetimeMin = 2.0f;    // seconds
+    float lifetimeMax = 5.0f;
+    int priority = 0;            // higher = served first when the budget is short
+    bool active = true;
+
+    // spawn volume and lifetime of the original effects of the type
+    static ParticleEmitterDesc defaults(ParticleType type);
+};
+
+inline ParticleEmitterDesc ParticleEmitterDesc::defaults(ParticleType type) {
+    ParticleEmitterDesc desc;
+    desc.type = type;
+    desc.shape = EmitterShape::BOX;
+    if (type == ParticleType::SMOKE) {
+        desc.extents = glm::vec3(2.0f, 0.25f, 2.0f); // wider spread for smoke
+        desc.lifetimeMin = 4.0f;
+        desc.lifetimeMax = 7.0f;
+    } else if (type == ParticleType::SPARK) {
+        desc.shape = EmitterShape::SPHERE;
+        desc.extents = glm::vec3(0.5f);
+        desc.lifetimeMin = 0.6f;
+        desc.lifetimeMax = 1.2f;
+    } else {
+        desc.extents = glm::vec3(1.0f, 0.5f, 1.0f);
+        desc.lifetimeMin = 2.0f;
+        desc.lifetimeMax = 5.0f;
+    }
+    return desc;
+}
+
+// Handle of an emitter; stays safe to use after the emitter is destroyed
+// (the generation no longer matches and the handle is ignored)
+struct ParticleEmitterHandle {
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool isValid() const { return index != UINT32_MAX; }
+};
@@ -0,0 +1,456 @@
+#include "ParticleKernels.hpp"
+#include "CpuFeatures.hpp"
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+
+#if defined(SIMD_AVX2_KERNELS)
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PARTICLE_KERNEL_SSE2
+#endif
+
+namespace {
+
+// Physics constants (the GPU backend has its own copy in particle_simulate.comp)
+constexpr float GRAVITY = -9.8f;
+constexpr float SMOKE_BUOYANCY = -GRAVITY * 0.1f; // smoke is much lighter than normal gravity
+constexpr float SMOKE_DRIFT = 0.5f;
+constexpr float SMOKE_DRAG = 0.98f;
+constexpr float SPARK_DRAG = 0.95f;
+
+using PoolArray = std::vector<float> ParticlePool::*;
+constexpr PoolArray POOL_ARRAYS[] = {
+    &ParticlePool::px, &ParticlePool::py, &ParticlePool::pz,
+    &ParticlePool::vx, &ParticlePool::vy, &ParticlePool::vz,
+    &ParticlePool::life, &ParticlePool::lifetime, &ParticlePool::size,
+    &ParticlePool::rotation, &ParticlePool::spin,
+    &ParticlePool::r, &ParticlePool::g, &ParticlePool::b, &ParticlePool::a
+};
+
+void glowScalar(ParticlePool& pool, size_t begin, size_t end, float dt) {
+    for (size_t i = begin; i < end; i++) {
+        pool.life[i] -= dt;
+        pool.px[i] += pool.vx[i] * dt;
+        pool.py[i] += pool.vy[i] * dt;
+        pool.pz[i] += pool.vz[i] * dt;
+        pool.vy[i] += GRAVITY * dt;
+
+        pool.rotation[i] += pool.spin[i] * dt;
+
+        float lifeRatio = pool.life[i] / pool.lifetime[i];
+        pool.a[i] = lifeRatio;
+        pool.size[i] = 1.0f + (1.0f - lifeRatio) * 2.0f;
+    }
+}
+
+void smokeScalar(ParticlePool& pool, size_t begin, size_t end, float dt, const float* driftX, const float* driftZ) {
+    for (size_t i = begin; i < end; i++) {
+        pool.life[i] -= dt;
+        pool.px[i] += pool.vx[i] * dt;
+        pool.py[i] += pool.vy[i] * dt;
+        pool.pz[i] += pool.vz[i] * dt;
+
+        pool.vy[i] += SMOKE_BUOYANCY * dt;
+        pool.vx[i] += (driftX[i] - 0.5f) * SMOKE_DRIFT * dt;
+        pool.vz[i] += (driftZ[i] - 0.5f) * SMOKE_DRIFT * dt;
+
+        pool.vx[i] *= SMOKE_DRAG;
+        pool.vy[i] *= SMOKE_DRAG;
+        pool.vz[i] *= SMOKE_DRAG;
+
+        pool.rotation[i] += pool.spin[i] * dt;
+
+        float lifeRatio = pool.life[i] / pool.lifetime[i];
+        pool.a[i] = lifeRatio;
+        pool.size[i] = 2.0f + (1.0f - lifeRatio) * 4.0f; // smoke grows as it dissipates
+    }
+}
+
+#if defined(SIMD_AVX2_KERNELS)
+
+SIMD_TARGET_AVX2 size_t glowAvx2(ParticlePool& pool, float dt) {
+    const size_t n = pool.count();
+    const __m256 vdt = _mm256_set1_ps(dt);
+    const __m256 gravity = _mm256_set1_ps(GRAVITY * dt);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 life = _mm256_sub_ps(_mm256_loadu_ps(&pool.life[i]), vdt);
+        __m256 vx = _mm256_loadu_ps(&pool.vx[i]);
+        __m256 vy = _mm256_loadu_ps(&pool.vy[i]);
+        __m256 vz = _mm256_loadu_ps(&pool.vz[i]);
+        __m256 x = _mm256_add_ps(_mm256_loadu_ps(&pool.px[i]), _mm256_mul_ps(vx, vdt));
+        __m256 y = _mm256_add_ps(_mm256_loadu_ps(&pool.py[i]), _mm256_mul_ps(vy, vdt));
+        __m256 z = _mm256_add_ps(_mm256_loadu_ps(&pool.pz[i]), _mm256_mul_ps(vz, vdt));
+        vy = _mm256_add_ps(vy, gravity);
+
+        _mm256_storeu_ps(&pool.rotation[i], _mm256_add_ps(_mm256_loadu_ps(&pool.rotation[i]),
+                                                          _mm256_mul_ps(_mm256_loadu_ps(&pool.spin[i]), vdt)));
+
+        __m256 lifeRatio = _mm256_div_ps(life, _mm256_loadu_ps(&pool.lifetime[i]));
+
+        _mm256_storeu_ps(&pool.life[i], life);
+        _mm256_storeu_ps(&pool.px[i], x);
+        _mm256_storeu_ps(&pool.py[i], y);
+        _mm256_storeu_ps(&pool.pz[i], z);
+        _mm256_storeu_ps(&pool.vy[i], vy);
+        _mm256_storeu_ps(&pool.a[i], lifeRatio);
+        _mm256_storeu_ps(&pool.size[i], _mm256_add_ps(one, _mm256_mul_ps(_mm256_sub_ps(one, lifeRatio), two)));
+    }
+    return i;
+}
+
+SIMD_TARGET_AVX2 size_t smokeAvx2(ParticlePool& pool, float dt, const float* driftX, const float* driftZ) {
+    const size_t n = pool.count();
+    const __m256 vdt = _mm256_set1_ps(dt);
+    const __m256 buoyancy = _mm256_set1_ps(SMOKE_BUOYANCY * dt);
+    const __m256 drift = _mm256_set1_ps(SMOKE_DRIFT * dt);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 drag = _mm256_set1_ps(SMOKE_DRAG);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 four = _mm256_set1_ps(4.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 life = _mm256_sub_ps(_mm256_loadu_ps(&pool.life[i]), vdt);
+        __m256 vx = _mm256_loadu_ps(&pool.vx[i]);
+        __m256 vy = _mm256_loadu_ps(&pool.vy[i]);
+        __m256 vz = _mm256_loadu_ps(&pool.vz[i]);
+        _mm256_storeu_ps(&pool.px[i], _mm256_add_ps(_mm256_loadu_ps(&pool.px[i]), _mm256_mul_ps(vx, vdt)));
+        _mm256_storeu_ps(&pool.py[i], _mm256_add_ps(_mm256_loadu_ps(&pool.py[i]), _mm256_mul_ps(vy, vdt)));
+        _mm256_storeu_ps(&pool.pz[i], _mm256_add_ps(_mm256_loadu_ps(&pool.pz[i]), _mm256_mul_ps(vz, vdt)));
+
+        vy = _mm256_add_ps(vy, buoyancy);
+        vx = _mm256_add_ps(vx, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&driftX[i]), half), drift));
+        vz = _mm256_add_ps(vz, _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&driftZ[i]), half), drift));
+
+        _mm256_storeu_ps(&pool.vx[i], _mm256_mul_ps(vx, drag));
+        _mm256_storeu_ps(&pool.vy[i], _mm256_mul_ps(vy, drag));
+        _mm256_storeu_ps(&pool.vz[i], _mm256_mul_ps(vz, drag));
+
+        _mm256_storeu_ps(&pool.rotation[i], _mm256_add_ps(_mm256_loadu_ps(&pool.rotation[i]),
+                                                          _mm256_mul_ps(_mm256_loadu_ps(&pool.spin[i]), vdt)));
+
+        __m256 lifeRatio = _mm256_div_ps(life, _mm256_loadu_ps(&pool.lifetime[i]));
+        _mm256_storeu_ps(&pool.life[i], life);
+        _mm256_storeu_ps(&pool.a[i], lifeRatio);
+        _mm256_storeu_ps(&pool.size[i], _mm256_add_ps(two, _mm256_mul_ps(_mm256_sub_ps(one, lifeRatio), four)));
+    }
+
+    return i;
+}
+
+#endif
+
+#if defined(PARTICLE_KERNEL_SSE2)
+
+size_t glowSse2(ParticlePool& pool, float dt) {
+    const size_t n = pool.count();
+    const __m128 vdt = _mm_set1_ps(dt);
+    const __m128 gravity = _mm_set1_ps(GRAVITY * dt);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 life = _mm_sub_ps(_mm_loadu_ps(&pool.life[i]), vdt);
+        __m128 vx = _mm_loadu_ps(&pool.vx[i]);
+        __m128 vy = _mm_loadu_ps(&pool.vy[i]);
+        __m128 vz = _mm_loadu_ps(&pool.vz[i]);
+        __m128 x = _mm_add_ps(_mm_loadu_ps(&pool.px[i]), _mm_mul_ps(vx, vdt));
+        __m128 y = _mm_add_ps(_mm_loadu_ps(&pool.py[i]), _mm_mul_ps(vy, vdt));
+        __m128 z = _mm_add_ps(_mm_loadu_ps(&pool.pz[i]), _mm_mul_ps(vz, vdt));
+        vy = _mm_add_ps(vy, gravity);
+
+        _mm_storeu_ps(&pool.rotation[i], _mm_add_ps(_mm_loadu_ps(&pool.rotation[i]),
+                                                    _mm_mul_ps(_mm_loadu_ps(&pool.spin[i]), vdt)));
+
+        __m128 lifeRatio = _mm_div_ps(life, _mm_loadu_ps(&pool.lifetime[i]));
+
+        _mm_storeu_ps(&pool.life[i], life);
+        _mm_storeu_ps(&pool.px[i], x);
+        _mm_storeu_ps(&pool.py[i], y);
+        _mm_storeu_ps(&pool.pz[i], z);
+        _mm_storeu_ps(&pool.vy[i], vy);
+        _mm_storeu_ps(&pool.a[i], lifeRatio);
+        _mm_storeu_ps(&pool.size[i], _mm_add_ps(one, _mm_mul_ps(_mm_sub_ps(one, lifeRatio), two)));
+    }
+    return i;
+}
+
+size_t smokeSse2(ParticlePool& pool, float dt, const float* driftX, const float* driftZ) {
+    const size_t n = pool.count();
+    const __m128 vdt = _mm_set1_ps(dt);
+    const __m128 buoyancy = _mm_set1_ps(SMOKE_BUOYANCY * dt);
+    const __m128 drift = _mm_set1_ps(SMOKE_DRIFT * dt);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 drag = _mm_set1_ps(SMOKE_DRAG);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 four = _mm_set1_ps(4.0f);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 life = _mm_sub_ps(_mm_loadu_ps(&pool.life[i]), vdt);
+        __m128 vx = _mm_loadu_ps(&pool.vx[i]);
+        __m128 vy = _mm_loadu_ps(&pool.vy[i]);
+        __m128 vz = _mm_loadu_ps(&pool.vz[i]);
+        _mm_storeu_ps(&pool.px[i], _mm_add_ps(_mm_loadu_ps(&pool.px[i]), _mm_mul_ps(vx, vdt)));
+        _mm_storeu_ps(&pool.py[i], _mm_add_ps(_mm_loadu_ps(&pool.py[i]), _mm_mul_ps(vy, vdt)));
+        _mm_storeu_ps(&pool.pz[i], _mm_add_ps(_mm_loadu_ps(&pool.pz[i]), _mm_mul_ps(vz, vdt)));
+
+        vy = _mm_add_ps(vy, buoyancy);
+        vx = _mm_add_ps(vx, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&driftX[i]), half), drift));
+        vz = _mm_add_ps(vz, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&driftZ[i]), half), drift));
+
+        _mm_storeu_ps(&pool.vx[i], _mm_mul_ps(vx, drag));
+        _mm_storeu_ps(&pool.vy[i], _mm_mul_ps(vy, drag));
+        _mm_storeu_ps(&pool.vz[i], _mm_mul_ps(vz, drag));
+
+        _mm_storeu_ps(&pool.rotation[i], _mm_add_ps(_mm_loadu_ps(&pool.rotation[i]),
+                                                    _mm_mul_ps(_mm_loadu_ps(&pool.spin[i]), vdt)));
+
+        __m128 lifeRatio = _mm_div_ps(life, _mm_loadu_ps(&pool.lifetime[i]));
+        _mm_storeu_ps(&pool.life[i], life);
+        _mm_storeu_ps(&pool.a[i], lifeRatio);
+        _mm_storeu_ps(&pool.size[i], _mm_add_ps(two, _mm_mul_ps(_mm_sub_ps(one, lifeRatio), four)));
+    }
+
+    return i;
+}
+
+#endif
+
+// the widest kernel the CPU has, returns the particles done (the scalar kernel does the rest)
+size_t glowSimd(ParticlePool& pool, float dt) {
+#if defined(SIMD_AVX2_KERNELS)
+    if (cpuHasAvx2()) {
+        return glowAvx2(pool, dt);
+    }
+#endif
+#if defined(PARTICLE_KERNEL_SSE2)
+    return glowSse2(pool, dt);
+#else
+    return 0;
+#endif
+}
+
+size_t smokeSimd(ParticlePool& pool, float dt, const float* driftX, const float* driftZ) {
+#if defined(SIMD_AVX2_KERNELS)
+    if (cpuHasAvx2()) {
+        return smokeAvx2(pool, dt, driftX, driftZ);
+    }
+#endif
+#if defined(PARTICLE_KERNEL_SSE2)
+    return smokeSse2(pool, dt, driftX, driftZ);
+#else
+    return 0;
+#endif
+}
+
+} // namespace
+
+void ParticlePool::reserve(size_t capacity) {
+    for (PoolArray array : POOL_ARRAYS) {
+        (this->*array).reserve(capacity);
+    }
+}
+
+void ParticlePool::clear() {
+    for (PoolArray array : POOL_ARRAYS) {
+        (this->*array).clear();
+    }
+}
+
+void ParticlePool::push(const glm::vec3& position, const glm::vec3& velocity, const glm::vec4& color, float lifetime, float size,
+                        float rotation, float spin) {
+    px.push_back(position.x);
+    py.push_back(position.y);
+    pz.push_back(position.z);
+    vx.push_back(velocity.x);
+    vy.push_back(velocity.y);
+    vz.push_back(velocity.z);
+    life.push_back(lifetime);
+    this->lifetime.push_back(lifetime);
+    this->size.push_back(size);
+    this->rotation.push_back(rotation);
+    this->spin.push_back(spin);
+    r.push_back(color.r);
+    g.push_back(color.g);
+    b.push_back(color.b);
+    a.push_back(color.a);
+}
+
+void ParticlePool::moveLast(size_t to) {
+    for (PoolArray array : POOL_ARRAYS) {
+        std::vector<float>& values = this->*array;
+        values[to] = values.back();
+        values.pop_back();
+    }
+}
+
+void ParticlePool::removeDead() {
+    size_t i = 0;
+    while (i < count()) {
+        if (life[i] <= 0.0f) {
+            moveLast(i); // the moved particle is checked in the next iteration
+        } else {
+            i++;
+        }
+    }
+}
+
+void integrateGlowParticles(ParticlePool& pool, float deltaTime, ParticleKernelPath path) {
+    size_t done = path == ParticleKernelPath::SIMD ? glowSimd(pool, deltaTime) : 0;
+    glowScalar(pool, done, pool.count(), deltaTime);
+}
+
+void integrateSmokeParticles(ParticlePool& pool, float deltaTime, ParticleRandom& random, ParticleKernelPath path) {
+    // two drift values per particle, generated in bulk
+    const size_t n = pool.count();
+    random.lanes.fill(random.drift, 2 * n);
+    const float* driftX = random.drift.data();
+    const float* driftZ = driftX + n;
+
+    size_t done = path == ParticleKernelPath::SIMD ? smokeSimd(pool, deltaTime, driftX, driftZ) : 0;
+    smokeScalar(pool, done, n, deltaTime, driftX, driftZ);
+}
+
+void integrateSparkParticles(ParticlePool& pool, float deltaTime) {
+    const size_t n = pool.count();
+    float* px = pool.px.data();
+    float* py = pool.py.data();
+    float* pz = pool.pz.data();
+    float* vx = pool.vx.data();
+    float* vy = pool.vy.data();
+    float* vz = pool.vz.data();
+    float* life = pool.life.data();
+    const float* lifetime = pool.lifetime.data();
+    float* size = pool.size.data();
+    float* alpha = pool.a.data();
+
+    for (size_t i = 0; i < n; i++) {
+        life[i] -= deltaTime;
+        px[i] += vx[i] * deltaTime;
+        py[i] += vy[i] * deltaTime;
+        pz[i] += vz[i] * deltaTime;
+        vx[i] *= SPARK_DRAG;
+        vy[i] = (vy[i] + GRAVITY * deltaTime) * SPARK_DRAG;
+        vz[i] *= SPARK_DRAG;
+
+        float lifeRatio = life[i] / lifetime[i];
+        alpha[i] = lifeRatio;
+        size[i] = 0.3f + lifeRatio * 0.7f; // sparks shrink as they cool down
+    }
+}
+
+void collideParticles(ParticlePool& pool, float deltaTime, const ParticleCollisionGrid& grid,
+                      const ParticleCollisionResponse& response) {
+    const size_t n = pool.count();
+    for (size_t i = 0; i < n; i++) {
+        float x = pool.px[i], y = pool.py[i], z = pool.pz[i];
+        float vx = pool.vx[i], vy = pool.vy[i], vz = pool.vz[i];
+
+        // Static colliders: a particle that moved into a solid cell goes back along the
+        // axes that crossed into it. Particles that were already inside (spawned there)
+        // are left alone until they get out.
+        if (grid.isSolid(x, y, z)) {
+            const float oldX = x - vx * deltaTime;
+            const float oldY = y - vy * deltaTime;
+            const float oldZ = z - vz * deltaTime;
+            if (!grid.isSolid(oldX, oldY, oldZ)) {
+                bool hitX = grid.isSolid(x, oldY, oldZ);
+                bool hitY = grid.isSolid(oldX, y, oldZ);
+                bool hitZ = grid.isSolid(oldX, oldY, z);
+                if (!hitX && !hitY && !hitZ) {
+                    hitX = hitY = hitZ = true; // through an edge or a corner
+                }
+                if (hitX) {
+                    x = oldX;
+                    vx = -vx * response.bounce;
+                }
+                if (hitY) {
+                    y = oldY;
+                    vy = -vy * response.bounce;
+                }
+                if (hitZ) {
+                    z = oldZ;
+                    vz = -vz * response.bounce;
+                }
+                vx *= hitX ? 1.0f : response.friction;
+                vy *= hitY ? 1.0f : response.friction;
+                vz *= hitZ ? 1.0f : response.friction;
+            }
+        }
+
+        // Terrain
+        const float ground = grid.groundHeight(x, z);
+        if (y <= ground) {
+            y = ground;
+            vy = -vy * response.bounce;
+            vx *= response.friction;
+            vz *= response.friction;
+        }
+
+        pool.px[i] = x;
+        pool.py[i] = y;
+        pool.pz[i] = z;
+        pool.vx[i] = vx;
+        pool.vy[i] = vy;
+        pool.vz[i] = vz;
+    }
+}
+
+const char* particleKernelName() {
+#if defined(SIMD_AVX2_KERNELS)
+    if (cpuHasAvx2()) {
+        return "AVX2";
+    }
+#endif
+#if defined(PARTICLE_KERNEL_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+void benchmarkParticleKernels(size_t particleCount, int frames) {
+    // long lifetimes, nothing dies during the run, so every frame has the same work
+    RandomStream generator(12345);
+    auto dis = [](RandomStream& stream) { return stream.range(-1.0f, 1.0f); };
+    ParticlePool glow, smoke;
+    glow.reserve(particleCount / 2);
+    smoke.reserve(particleCount - particleCount / 2);
+    for (size_t i = 0; i < particleCount; i++) {
+        ParticlePool& pool = (i % 2 == 0) ? glow : smoke;
+        pool.push(glm::vec3(dis(generator), 5.0f + dis(generator), dis(generator)) * 10.0f,
+                  glm::vec3(dis(generator), dis(generator), dis(generator)) * 5.0f,
+                  glm::vec4(1.0f), 1000.0f, 1.0f, 0.0f, dis(generator));
+    }
+
+    const float dt = 1.0f / 60.0f;
+    ParticleRandom random(RandomLanes(1u));
+    float msPerFrame[2] = {};
+    const ParticleKernelPath paths[2] = {ParticleKernelPath::SCALAR, ParticleKernelPath::SIMD};
+
+    for (int p = 0; p < 2; p++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int frame = 0; frame < frames; frame++) {
+            integrateGlowParticles(glow, dt, paths[p]);
+            integrateSmokeParticles(smoke, dt, random, paths[p]);
+            glow.removeDead();
+            smoke.removeDead();
+        }
+        msPerFrame[p] = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / frames;
+    }
+
+    std::cout << "  CPU kernels, " << particleCount << " particles: scalar " << particleCount / msPerFrame[0]
+              << " particles/ms, " << particleKernelName() << " " << particleCount / msPerFrame[1]
+              << " particles/ms (" << msPerFrame[0] / msPerFrame[1] << "x)" << std::endl;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "Random.hpp"
+#include "ParticleCollision.hpp"
+
+// Live particles of one type as a structure of arrays.
+//
+// Only live particles are stored: emission appends, and a particle that dies is
+// replaced by the last one (swap-remove), so the per-frame cost is proportional to
+// the number of live particles and the arrays can be streamed by SIMD kernels.
+struct ParticlePool {
+    std::vector<float> px, py, pz;
+    std::vector<float> vx, vy, vz;
+    std::vector<float> life, lifetime;
+    std::vector<float> size;
+    std::vector<float> rotation, spin; // billboard angle and its angular velocity (rad/s)
+    std::vector<float> r, g, b, a;
+
+    size_t count() const { return life.size(); }
+    bool empty() const { return life.empty(); }
+
+    void reserve(size_t capacity);
+    void clear();
+    void push(const glm::vec3& position, const glm::vec3& velocity, const glm::vec4& color, float lifetime, float size,
+              float rotation, float spin);
+    void removeDead(); // swap-remove of every particle with life <= 0
+    glm::vec3 position(size_t i) const { return glm::vec3(px[i], py[i], pz[i]); }
+
+private:
+    void moveLast(size_t to);
+};
+
+// Which implementation the kernels use, SIMD = the widest one the CPU supports
+enum class ParticleKernelPath {
+    SCALAR,
+    SIMD
+};
+
+// random numbers of the smoke drift, generated in bulk every frame
+struct ParticleRandom {
+    RandomLanes lanes;
+    std::vector<float> drift; // x of all particles, then z of all particles
+
+    explicit ParticleRandom(const RandomLanes& lanes) : lanes(lanes) {}
+};
+
+// How a particle type reacts to the terrain and static colliders
+struct ParticleCollisionResponse {
+    float bounce;   // part of the normal velocity kept (reflected), 0 = stops
+    float friction; // tangential velocity multiplier per contact
+};
+
+// gravity, fade, sizing and spin
+void integrateGlowParticles(ParticlePool& pool, float deltaTime, ParticleKernelPath path = ParticleKernelPath::SIMD);
+// buoyancy, random drift, air drag, fade, growth and spin
+void integrateSmokeParticles(ParticlePool& pool, float deltaTime, ParticleRandom& random,
+                             ParticleKernelPath path = ParticleKernelPath::SIMD);
+// gravity, strong drag, fade and shrink; branch free, left to the auto-vectorizer
+void integrateSparkParticles(ParticlePool& pool, float deltaTime);
+// pushes particles that entered a solid cell or went below the terrain back out,
+// runs after an integrate* kernel (which moved the particles by velocity * deltaTime)
+void collideParticles(ParticlePool& pool, float deltaTime, const ParticleCollisionGrid& grid,
+                      const ParticleCollisionResponse& response);
+
+const char* particleKernelName(); // "AVX2", "SSE2" or "scalar"
+
+// Times the scalar and SIMD kernels on the CPU only and prints particles per millisecond
+void benchmarkParticleKernels(size_t particleCount, int frames);
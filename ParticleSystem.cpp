@@ -1,23 +1,45 @@
 #include "ParticleSystem.hpp"
+#include "PhysicsSystem.hpp"
 #include <iostream>
 #include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <type_traits>
 
-ParticleSystem::ParticleSystem(ShaderProgram& shaderProgram, size_t maxParticles)
-    : shader(shaderProgram), maxParticles(maxParticles), emitterPosition(0.0f, 10.0f, 0.0f), 
-      emissionRate(50.0f), lastEmissionTime(0.0f), generator(std::random_device{}()), dis(0.0f, 1.0f),
+ParticleSystem::ParticleSystem(ShaderProgram& shaderProgram, size_t maxParticles, ParticleBackend backend)
+    : random(RandomService::instance().lanes("particles.drift")), VAO(0), VBO(0), mappedInstances(nullptr), segmentFences{}, streamSegment(0),
+      shader(&shaderProgram), generator(RandomService::instance().stream("particles")),
+      maxParticles(maxParticles), emitterPosition(0.0f, 10.0f, 0.0f),
       smokeTexture(0), smokeTextureLoaded(false), currentParticleType(ParticleType::GLOW) {
     
-    particles.resize(maxParticles);
-    setupBuffers();
-    loadSmokeTexture();
-    
-    // Initialize all particles as inactive
-    for (auto& particle : particles) {
-        particle.life = 0.0f;
+    if (backend == ParticleBackend::GPU) {
+        gpu = std::make_unique<GpuParticleBackend>(maxParticles);
+        updateCollisionGrid();
+    } else {
+        setupBuffers();
     }
+    loadSmokeTexture();
+}
+
+ParticleSystem::ParticleSystem(size_t maxParticles)
+    : random(RandomService::instance().lanes("particles.drift")), VAO(0), VBO(0), mappedInstances(nullptr), segmentFences{}, streamSegment(0),
+      shader(nullptr), generator(RandomService::instance().stream("particles")),
+      maxParticles(maxParticles), emitterPosition(0.0f, 10.0f, 0.0f),
+      smokeTexture(0), smokeTextureLoaded(false), currentParticleType(ParticleType::GLOW) {
 }
 
 ParticleSystem::~ParticleSystem() {
+    if (isRenderless()) {
+        return; // no GL objects, maybe no context
+    }
+    for (GLsync& fence : segmentFences) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+    if (mappedInstances) {
+        glUnmapNamedBuffer(VBO);
+    }
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     if (smokeTextureLoaded && smokeTexture != 0) {
@@ -26,20 +48,93 @@ ParticleSystem::~ParticleSystem() {
 }
 
 void ParticleSystem::setupBuffers() {
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
+    glCreateVertexArrays(1, &VAO);
+    glCreateBuffers(1, &VBO);
     
-    glBindVertexArray(VAO);
-    
-    // Create buffer for particle positions (will be updated dynamically)
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, maxParticles * sizeof(glm::vec3), nullptr, GL_DYNAMIC_DRAW);
+    // Immutable storage, mapped once for the lifetime of the system. Every segment
+    // holds the instance streams of all live particles (at most maxParticles of all types).
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const GLsizeiptr segmentBytes = INSTANCE_STREAMS * maxParticles * sizeof(float);
+    glNamedBufferStorage(VBO, STREAM_SEGMENTS * segmentBytes, nullptr, flags);
+    mappedInstances = static_cast<float*>(glMapNamedBufferRange(VBO, 0, STREAM_SEGMENTS * segmentBytes, flags));
+    if (!mappedInstances) {
+        throw std::runtime_error("Failed to map particle vertex buffer");
+    }
     
-    // Position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
-    glEnableVertexAttribArray(0);
+    // Instance data is written straight from the SoA pools, so every value is a float
+    // stream with its own attribute, advanced once per billboard (see particle.vert).
+    // The quad corners come from gl_VertexID.
+    for (GLuint stream = 0; stream < INSTANCE_STREAMS; stream++) {
+        glEnableVertexArrayAttrib(VAO, stream);
+        glVertexArrayAttribFormat(VAO, stream, 1, GL_FLOAT, GL_FALSE, 0);
+        glVertexArrayAttribBinding(VAO, stream, stream);
+        glVertexArrayBindingDivisor(VAO, stream, 1);
+    }
+}
+
+ParticleEmitterHandle ParticleSystem::createEmitter(const ParticleEmitterDesc& desc) {
+    uint32_t index;
+    if (!freeEmitters.empty()) {
+        index = freeEmitters.back();
+        freeEmitters.pop_back();
+    } else {
+        index = static_cast<uint32_t>(emitters.size());
+        emitters.emplace_back();
+    }
     
-    glBindVertexArray(0);
+    EmitterSlot& slot = emitters[index];
+    slot.desc = desc;
+    slot.accumulator = 0.0f;
+    slot.burst = 0;
+    slot.alive = true;
+    stats.emitterCount++;
+    return { index, slot.generation };
+}
+
+void ParticleSystem::destroyEmitter(ParticleEmitterHandle handle) {
+    EmitterSlot* slot = findEmitter(handle);
+    if (!slot) {
+        return;
+    }
+    // particles already spawned live on, the handle becomes stale
+    slot->alive = false;
+    slot->generation++;
+    freeEmitters.push_back(handle.index);
+    stats.emitterCount--;
+}
+
+ParticleSystem::EmitterSlot* ParticleSystem::findEmitter(ParticleEmitterHandle handle) {
+    if (handle.index >= emitters.size()) {
+        return nullptr;
+    }
+    EmitterSlot& slot = emitters[handle.index];
+    return slot.alive && slot.generation == handle.generation ? &slot : nullptr;
+}
+
+ParticleEmitterDesc* ParticleSystem::getEmitter(ParticleEmitterHandle handle) {
+    EmitterSlot* slot = findEmitter(handle);
+    return slot ? &slot->desc : nullptr;
+}
+
+void ParticleSystem::setEmitterPosition(ParticleEmitterHandle handle, const glm::vec3& position) {
+    if (EmitterSlot* slot = findEmitter(handle)) {
+        slot->desc.position = position;
+    }
+}
+
+void ParticleSystem::setEmitterActive(ParticleEmitterHandle handle, bool active) {
+    if (EmitterSlot* slot = findEmitter(handle)) {
+        if (!slot->desc.active && active) {
+            slot->accumulator = 0.0f; // no catch-up burst after a pause
+        }
+        slot->desc.active = active;
+    }
+}
+
+void ParticleSystem::burst(ParticleEmitterHandle handle, int count) {
+    if (EmitterSlot* slot = findEmitter(handle)) {
+        slot->burst += std::max(0, count);
+    }
 }
 
 void ParticleSystem::set_emitter_position(const glm::vec3& position) {
@@ -50,6 +145,52 @@ void ParticleSystem::setParticleType(ParticleType type) {
     currentParticleType = type;
 }
 
+void ParticleSystem::setCollisionWorld(const PhysicsSystem* physics) {
+    if (physics != collisionWorld) {
+        // other world, its revisions may repeat those of the old one
+        uploadedSolidRevision = UINT32_MAX;
+        terrainUploaded = false;
+    }
+    collisionWorld = physics;
+    updateCollisionGrid();
+}
+
+void ParticleSystem::setCollisionGrid(const ParticleCollisionGrid* grid) {
+    if ((grid == nullptr) != (sharedGrid == nullptr)) {
+        uploadedSolidRevision = UINT32_MAX; // other grid, other revisions
+        terrainUploaded = false;
+    }
+    sharedGrid = grid;
+    updateCollisionGrid();
+}
+
+void ParticleSystem::updateCollisionGrid() {
+    if (!sharedGrid && collisionGrid.needsRebuild(collisionWorld)) {
+        collisionGrid.build(collisionWorld);
+    }
+    if (!sharedGrid && collisionWorld) {
+        collisionGrid.setSolidOffset(collisionWorld->getWorldOffset());
+    }
+    if (!gpu) {
+        return;
+    }
+
+    // Only the part that changed goes to the GPU: houses coming and going change the
+    // solid cells, the world scrolling over the terrain changes the columns. The shared
+    // grid alternates between two copies, equal revisions and keys mean equal parts.
+    const ParticleCollisionGrid& grid = getCollisionGrid();
+    if (grid.getSourceRevision() != uploadedSolidRevision) {
+        gpu->setSolidCells(grid);
+        uploadedSolidRevision = grid.getSourceRevision();
+    }
+    if (!terrainUploaded || grid.getTerrainKey() != uploadedTerrain) {
+        gpu->setTerrain(grid);
+        uploadedTerrain = grid.getTerrainKey();
+        terrainUploaded = true;
+    }
+    gpu->setSolidOffset(grid.getSolidOffset()); // a uniform, the world scrolls every step
+}
+
 void ParticleSystem::loadSmokeTexture() {
     try {
         smokeTexture = TextureLoader::textureInit("resources/textures/smoke1.png");
@@ -63,245 +204,289 @@ void ParticleSystem::loadSmokeTexture() {
 }
 
 void ParticleSystem::update(float deltaTime) {
-    // Update existing particles
-    for (auto& particle : particles) {
-        if (particle.life > 0.0f) {
-            // Update physics
-            particle.life -= deltaTime;
-            particle.position += particle.velocity * deltaTime;
-            
-            // Apply different physics based on particle type
-            if (particle.type == ParticleType::SMOKE) {
-                // Smoke particles rise and drift with reduced gravity
-                particle.velocity.y += -GRAVITY * 0.1f * deltaTime; // Much lighter than normal gravity
-                
-                // Add some horizontal drift for realistic smoke movement
-                particle.velocity.x += (dis(generator) - 0.5f) * 0.5f * deltaTime;
-                particle.velocity.z += (dis(generator) - 0.5f) * 0.5f * deltaTime;
-                
-                // Apply air resistance to slow down over time
-                particle.velocity *= 0.98f;
-            } else {
-                // Normal gravity for glow particles
-                particle.velocity.y += GRAVITY * deltaTime;
-            }
-            
-            // Ground collision (only for glow particles)
-            if (particle.type == ParticleType::GLOW && particle.position.y <= GROUND_LEVEL) {
-                particle.position.y = GROUND_LEVEL;
-                particle.velocity.y = -particle.velocity.y * BOUNCE_DAMPING;
-                
-                // Add some friction
-                particle.velocity.x *= 0.9f;
-                particle.velocity.z *= 0.9f;
-            }
-            
-            // Update color based on life (fade out)
-            float lifeRatio = particle.life / particle.lifetime;
-            particle.color.a = lifeRatio;
-            
-            // Size based on life - smoke particles grow over time, glow particles shrink
-            if (particle.type == ParticleType::SMOKE) {
-                particle.size = 2.0f + (1.0f - lifeRatio) * 4.0f; // Smoke grows as it dissipates
-            } else {
-                particle.size = 1.0f + (1.0f - lifeRatio) * 2.0f;
-            }
-        }
+    auto start = std::chrono::high_resolution_clock::now();
+    
+    particleHashValid = false;
+    updateCollisionGrid();
+    processEmission(deltaTime);
+    
+    if (gpu) {
+        gpu->update(deltaTime);
+        stats.aliveCount = gpu->getAliveCount();
+        stats.updateGpuMs = gpu->getGpuTimeMs();
+        stats.updateCpuMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        return;
+    }
+    
+    // Every type has its own pool and kernel, so the loops run without per-particle type branches
+    forEachPool([&](auto& typed) {
+        using Policy = typename std::decay_t<decltype(typed)>::policy;
+        Policy::integrate(typed.pool, deltaTime, random, ParticleKernelPath::SIMD);
+        collideParticles(typed.pool, deltaTime, getCollisionGrid(), Policy::COLLISION);
+        typed.pool.removeDead();
+    });
+    
+    stats.aliveCount = liveCount();
+    stats.updateCpuMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+template <typename Policy>
+void ParticleSystem::setupStyle(ShaderProgram& program) {
+    // smoke falls back to a soft procedural puff if its texture is missing
+    const bool textured = Policy::STYLE == ParticleStyle::TEXTURED && smokeTextureLoaded;
+    program.setUniform("useTexture", textured ? 1 : 0);
+    program.setUniform("uSoftSmoke", Policy::STYLE != ParticleStyle::GLOW && !textured ? 1 : 0);
+    program.setUniform("uSizeScale", Policy::SIZE_SCALE);
+    program.setUniform("particleColor", Policy::tint()); // per-particle colors are multiplied by the tint
+    if (textured) {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, smokeTexture);
+        program.setUniform("particleTexture", 0);
     }
 }
 
-void ParticleSystem::draw(const glm::mat4& view, const glm::mat4& projection) {
-    shader.activate();
+void ParticleSystem::draw(const glm::mat4& view, const glm::mat4& projection, const glm::vec2& viewportSize,
+                          ParticleBlendMode blendMode) {
+    if (isRenderless()) {
+        return;
+    }
+    auto start = std::chrono::high_resolution_clock::now();
     
-    // Set uniforms
-    shader.setUniform("uV_m", view);
-    shader.setUniform("uProj_m", projection);
+    // the GPU backend reads particles from its SSBO, so it has its own vertex shader
+    ShaderProgram& program = gpu ? gpu->getDrawShader() : *shader;
+    program.activate();
     
-    // Enable point size variation in vertex shader
-    glEnable(GL_PROGRAM_POINT_SIZE);
+    // Set uniforms
+    program.setUniform("uV_m", view);
+    program.setUniform("uProj_m", projection);
+    program.setUniform("uViewportSize", viewportSize);
+    program.setUniform("uOitPass", blendMode == ParticleBlendMode::ORDER_INDEPENDENT ? 1 : 0);
     
     // Enable blending for transparency
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    
-    glBindVertexArray(VAO);
-    
-    // Count particles by type and prepare position data
-    std::vector<glm::vec3> glowPositions;
-    std::vector<glm::vec3> smokePositions;
-    
-    for (const auto& particle : particles) {
-        if (particle.life > 0.0f) {
-            if (particle.type == ParticleType::GLOW) {
-                glowPositions.push_back(particle.position);
-            } else if (particle.type == ParticleType::SMOKE) {
-                smokePositions.push_back(particle.position);
-            }
-        }
+    if (blendMode == ParticleBlendMode::ALPHA) {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     }
     
-    // Draw glow particles first (no texture)
-    if (!glowPositions.empty()) {
-        shader.setUniform("useTexture", 0);
-        shader.setUniform("uPointSize", 10.0f);
-        shader.setUniform("particleColor", glm::vec4(0.15f, 0.95f, 0.2f, 0.6f)); // Green glow
+    if (gpu) {
+        // instance counts were produced by the simulation kernel (indirect draw)
+        forEachPool([&](const auto& typed) {
+            using Policy = typename std::decay_t<decltype(typed)>::policy;
+            setupStyle<Policy>(program);
+            gpu->draw(Policy::TYPE);
+        });
+    } else {
+        // All types are written into the current segment one after another,
+        // each as INSTANCE_STREAMS consecutive streams
+        waitForSegment(streamSegment);
+        size_t first = streamSegment * INSTANCE_STREAMS * maxParticles;
+        glBindVertexArray(VAO);
         
-        // Update buffer with glow positions
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, maxParticles * sizeof(glm::vec3), nullptr, GL_DYNAMIC_DRAW); // Re-allocate buffer
-        glBufferSubData(GL_ARRAY_BUFFER, 0, glowPositions.size() * sizeof(glm::vec3), glowPositions.data());
+        forEachPool([&](const auto& typed) {
+            using Policy = typename std::decay_t<decltype(typed)>::policy;
+            if (typed.pool.empty()) {
+                return;
+            }
+            streamInstances(typed.pool, mappedInstances + first);
+            setupStyle<Policy>(program);
+            bindInstances(first, typed.pool.count());
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(typed.pool.count()));
+            first += INSTANCE_STREAMS * typed.pool.count();
+        });
         
-        glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(glowPositions.size()));
+        // the segment may be rewritten once these draws are finished
+        segmentFences[streamSegment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        streamSegment = (streamSegment + 1) % STREAM_SEGMENTS;
     }
     
-    // Draw smoke particles with texture
-    if (!smokePositions.empty() && smokeTextureLoaded) {
-        shader.setUniform("useTexture", 1);
-        shader.setUniform("uPointSize", 200.0f); // Larger point size for smoke
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, smokeTexture);
-        shader.setUniform("particleTexture", 0);
-        shader.setUniform("particleColor", glm::vec4(0.6f, 0.6f, 0.6f, 0.7f)); // Gray smoke
-        
-        // Update buffer with smoke positions
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, maxParticles * sizeof(glm::vec3), nullptr, GL_DYNAMIC_DRAW); // Re-allocate buffer
-        glBufferSubData(GL_ARRAY_BUFFER, 0, smokePositions.size() * sizeof(glm::vec3), smokePositions.data());
-        
-        glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(smokePositions.size()));
+    if (blendMode == ParticleBlendMode::ALPHA) {
+        glDisable(GL_BLEND);
     }
-    
-    glDisable(GL_PROGRAM_POINT_SIZE);
-    glDisable(GL_BLEND);
     glBindVertexArray(0);
-    shader.deactivate();
+    program.deactivate();
+    
+    stats.drawCpuMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void ParticleSystem::waitForSegment(int segment) {
+    GLsync& fence = segmentFences[segment];
+    if (!fence) {
+        return;
+    }
+    
+    // normally already signaled, the segment was drawn STREAM_SEGMENTS - 1 frames ago
+    GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    while (status == GL_TIMEOUT_EXPIRED) {
+        status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1 ms
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void ParticleSystem::streamInstances(const ParticlePool& pool, float* destination) {
+    // same order as the attribute locations in particle.vert
+    const std::vector<float> ParticlePool::* streams[INSTANCE_STREAMS] = {
+        &ParticlePool::px, &ParticlePool::py, &ParticlePool::pz,
+        &ParticlePool::size, &ParticlePool::rotation,
+        &ParticlePool::r, &ParticlePool::g, &ParticlePool::b, &ParticlePool::a
+    };
+    
+    const size_t count = pool.count();
+    for (int stream = 0; stream < INSTANCE_STREAMS; stream++) {
+        const std::vector<float>& values = pool.*streams[stream];
+        std::copy(values.begin(), values.end(), destination + stream * count);
+    }
 }
 
-void ParticleSystem::updateBuffers() {
-    // This function is no longer needed as buffer updates are handled in draw()
+void ParticleSystem::bindInstances(size_t firstFloat, size_t count) {
+    const GLintptr offset = firstFloat * sizeof(float);
+    const GLintptr streamBytes = count * sizeof(float);
+    for (GLuint stream = 0; stream < INSTANCE_STREAMS; stream++) {
+        glVertexArrayVertexBuffer(VAO, stream, VBO, offset + stream * streamBytes, sizeof(float));
+    }
+}
+
+void ParticleSystem::emit(const ParticleEmitterDesc& desc, int count) {
+    if (count > 0) {
+        bursts.push_back({ desc, count });
+    }
 }
 
 void ParticleSystem::emit(int count) {
-    for (int i = 0; i < count; ++i) {
-        // Find inactive particle
-        auto it = std::find_if(particles.begin(), particles.end(), 
-                              [](const Particle& p) { return p.life <= 0.0f; });
-        
-        if (it != particles.end()) {
-            if (currentParticleType == ParticleType::SMOKE) {
-                *it = createSmokeParticle();
-            } else {
-                *it = createParticle();
-            }
-        }
+    if (count <= 0) {
+        return;
     }
+    ParticleEmitterDesc desc = ParticleEmitterDesc::defaults(currentParticleType);
+    desc.position = emitterPosition;
+    bursts.push_back({ desc, count });
 }
 
 void ParticleSystem::emit_smoke(int count) {
-    ParticleType previousType = currentParticleType;
-    setParticleType(ParticleType::SMOKE);
-    emit(count);
-    setParticleType(previousType);
+    if (count <= 0) {
+        return;
+    }
+    ParticleEmitterDesc desc = ParticleEmitterDesc::defaults(ParticleType::SMOKE);
+    desc.position = emitterPosition;
+    bursts.push_back({ desc, count });
 }
 
-Particle ParticleSystem::createParticle() {
-    Particle particle;
-    
-    particle.position = emitterPosition + glm::vec3(
-        (dis(generator) - 0.5f) * 2.0f,
-        (dis(generator) - 0.5f) * 1.0f,
-        (dis(generator) - 0.5f) * 2.0f
-    );
-    
-    // Random spherical velocity
-    particle.velocity = glm::sphericalRand(5.0f + dis(generator) * 10.0f);
-    
-    particle.lifetime = 2.0f + dis(generator) * 3.0f;
-    particle.life = particle.lifetime;
-    
-    // Random color with full alpha
-    particle.color = glm::vec4(
-        0.5f + dis(generator) * 0.5f,
-        0.3f + dis(generator) * 0.4f,
-        0.1f + dis(generator) * 0.3f,
-        1.0f
-    );
+void ParticleSystem::processEmission(float deltaTime) {
+    // Collect what every emitter wants this frame
+    emissionBatch.clear();
+    for (EmitterSlot& slot : emitters) {
+        if (!slot.alive) {
+            continue;
+        }
+        int count = slot.burst;
+        slot.burst = 0;
+        if (slot.desc.active && slot.desc.rate > 0.0f) {
+            // frame rate independent: the fractional part waits for the next frame
+            slot.accumulator += slot.desc.rate * deltaTime;
+            const int whole = static_cast<int>(slot.accumulator);
+            slot.accumulator -= static_cast<float>(whole);
+            count += whole;
+        }
+        if (count > 0) {
+            emissionBatch.push_back({ &slot.desc, count });
+        }
+    }
+    for (const Burst& burst : bursts) {
+        emissionBatch.push_back({ &burst.desc, burst.count });
+    }
     
-    particle.size = 1.0f;
-    particle.type = ParticleType::GLOW;
+    // Global budget: higher priorities first, equal priorities in creation order.
+    // The GPU alive count is a few frames old, the dead list catches the rest.
+    std::stable_sort(emissionBatch.begin(), emissionBatch.end(), [](const EmissionRequest& a, const EmissionRequest& b) {
+        return a.desc->priority > b.desc->priority;
+    });
+    const size_t live = gpu ? gpu->getAliveCount() : liveCount();
+    size_t budget = live < maxParticles ? maxParticles - live : 0;
     
-    return particle;
+    stats.emitted = 0;
+    stats.dropped = 0;
+    for (const EmissionRequest& request : emissionBatch) {
+        const size_t count = std::min(static_cast<size_t>(request.count), budget);
+        budget -= count;
+        stats.emitted += count;
+        stats.dropped += request.count - count;
+        if (count == 0) {
+            continue;
+        }
+        
+        if (gpu) {
+            gpu->emit(*request.desc, static_cast<int>(count), generator.next());
+        } else {
+            spawn(*request.desc, count);
+        }
+    }
+    bursts.clear();
 }
 
-Particle ParticleSystem::createSmokeParticle() {
-    Particle particle;
-    
-    // Spawn around the emitter with some randomness
-    particle.position = emitterPosition + glm::vec3(
-        (dis(generator) - 0.5f) * 4.0f,  // Wider spread for smoke
-        dis(generator) * 0.5f,            // Start near ground level
-        (dis(generator) - 0.5f) * 4.0f
-    );
-    
-    // Smoke particles rise with some random horizontal movement
-    particle.velocity = glm::vec3(
-        (dis(generator) - 0.5f) * 2.0f,  // Some horizontal drift
-        2.0f + dis(generator) * 3.0f,    // Upward movement
-        (dis(generator) - 0.5f) * 2.0f   // Some horizontal drift
-    );
-    
-    particle.lifetime = 4.0f + dis(generator) * 3.0f; // Longer lifetime for smoke
-    particle.life = particle.lifetime;
-    
-    // Grayish smoke color with transparency
-    particle.color = glm::vec4(
-        0.5f + dis(generator) * 0.3f,    // Gray tones
-        0.5f + dis(generator) * 0.3f,
-        0.5f + dis(generator) * 0.3f,
-        0.8f - dis(generator) * 0.3f     // Semi-transparent
-    );
-    
-    particle.size = 2.0f + dis(generator) * 2.0f;
-    particle.type = ParticleType::SMOKE;
-    
-    return particle;
+template <typename Policy>
+void ParticleSystem::spawnParticles(ParticlePool& pool, const ParticleEmitterDesc& emitter, size_t count) {
+    // Appending to the pool is O(1)
+    for (size_t i = 0; i < count; ++i) {
+        Particle particle = Policy::spawn(emitter, generator);
+        pool.push(particle.position, particle.velocity, particle.color, particle.lifetime, particle.size,
+                  particle.rotation, particle.spin);
+    }
 }
 
-void ParticleSystem::respawnParticle(Particle& particle) {
-    if (currentParticleType == ParticleType::SMOKE) {
-        particle = createSmokeParticle();
-    } else {
-        particle = createParticle();
-    }
+void ParticleSystem::spawn(const ParticleEmitterDesc& emitter, size_t count) {
+    // the type is resolved once per request, the spawn loop is instantiated per policy
+    forEachPool([&](auto& typed) {
+        using Policy = typename std::decay_t<decltype(typed)>::policy;
+        if (Policy::TYPE == emitter.type) {
+            spawnParticles<Policy>(typed.pool, emitter, count);
+        }
+    });
+}
+
+size_t ParticleSystem::liveCount() const {
+    size_t count = 0;
+    forEachPool([&](const auto& typed) { count += typed.pool.count(); });
+    return count;
 }
 
 void ParticleSystem::reset() {
-    for (auto& particle : particles) {
-        particle.life = 0.0f;
+    if (gpu) {
+        gpu->reset();
     }
+    stats.aliveCount = 0;
+    particleHashValid = false;
+    bursts.clear();
+    forEachPool([](auto& typed) { typed.pool.clear(); });
 }
 
-bool ParticleSystem::checkCollisionWithBox(const glm::vec3& boxMin, const glm::vec3& boxMax) {
-    for (const auto& particle : particles) {
-        if (particle.life > 0.0f) {
-            if (particle.position.x >= boxMin.x && particle.position.x <= boxMax.x &&
-                particle.position.y >= boxMin.y && particle.position.y <= boxMax.y &&
-                particle.position.z >= boxMin.z && particle.position.z <= boxMax.z) {
-                return true;
-            }
+const ParticleSpatialHash& ParticleSystem::getParticleHash() {
+    if (particleHashValid) {
+        return particleHash;
+    }
+    
+    particleHash.clear();
+    if (gpu) {
+        std::vector<glm::vec3> positions;
+        gpu->readAlivePositions(positions);
+        for (const glm::vec3& p : positions) {
+            particleHash.add(p.x, p.y, p.z);
         }
+    } else {
+        forEachPool([&](const auto& typed) {
+            const ParticlePool& pool = typed.pool;
+            for (size_t i = 0; i < pool.count(); i++) {
+                particleHash.add(pool.px[i], pool.py[i], pool.pz[i]);
+            }
+        });
     }
-    return false;
+    particleHash.build();
+    particleHashValid = true;
+    return particleHash;
+}
+
+bool ParticleSystem::checkCollisionWithBox(const glm::vec3& boxMin, const glm::vec3& boxMax) {
+    return getParticleHash().anyInBox(boxMin, boxMax);
 }
 
 bool ParticleSystem::checkCollisionWithSphere(const glm::vec3& center, float radius) {
-    for (const auto& particle : particles) {
-        if (particle.life > 0.0f) {
-            float distance = glm::length(particle.position - center);
-            if (distance <= radius) {
-                return true;
-            }
-        }
-    }
-    return false;
+    return getParticleHash().anyInSphere(center, radius);
 }
@@ -1,45 +1,62 @@
 #pragma once
 
 #include <vector>
-#include <random>
+#include <memory>
 #include <GL/glew.h>
 #include <glm/glm.hpp>
-#include <glm/gtc/random.hpp>
 #include "ShaderProgram.hpp"
 #include "TextureLoader.hpp"
 #include "assets.hpp"
+#include "GpuParticles.hpp"
+#include "ParticleKernels.hpp"
+#include "ParticleEmitter.hpp"
+#include "ParticleTypes.hpp"
+#include "ParticleCollision.hpp"
 
-// Particle types for different effects
-enum class ParticleType {
-    GLOW,    // Original green glow particles
-    SMOKE    // Smoke particles with texture
+class PhysicsSystem;
+
+// Where particles are simulated (selected by "particles.backend" in app_settings.json)
+enum class ParticleBackend {
+    CPU,     // SoA pools per type (ParticleKernels.hpp), streamed into a persistently mapped triple-buffered VBO
+    GPU      // compute shaders, see GpuParticles.hpp
+};
+
+// Who owns the blend state when particles are drawn
+enum class ParticleBlendMode {
+    ALPHA,             // classic alpha blending, set up by draw()
+    ORDER_INDEPENDENT, // inside TransparencyPass (weighted blended OIT)
+    EXTERNAL           // inside ParticleTarget, the target sets the blending
 };
 
-// Simple particle structure for our system
-struct Particle {
-    glm::vec3 position;
-    glm::vec3 velocity;
-    glm::vec4 color;
-    float life;        // remaining life time
-    float lifetime;    // total lifetime
-    float size;
-    ParticleType type; // Type of particle
-    
-    Particle() : position(0.0f), velocity(0.0f), color(1.0f), life(0.0f), lifetime(0.0f), size(1.0f), type(ParticleType::GLOW) {}
+struct ParticleStats {
+    size_t aliveCount = 0;   // GPU backend: a few frames late
+    float updateCpuMs = 0.0f; // CPU time of update() (GPU backend: only the submission)
+    float drawCpuMs = 0.0f;   // CPU time of draw()
+    float updateGpuMs = 0.0f; // GPU time of emission + simulation (GPU backend only)
+    size_t emitterCount = 0;  // live emitters
+    size_t emitted = 0;       // particles spawned by the last update()
+    size_t dropped = 0;       // requested by the last update() but over the budget
 };
 
 class ParticleSystem {
 private:
-    std::vector<Particle> particles;
+    // Live particles of the CPU backend, one SoA pool per type policy (ParticleTypes.hpp)
+    ParticlePools pools;
+    ParticleRandom random;
     GLuint VAO, VBO;
-    ShaderProgram& shader;
-    std::mt19937 generator;
-    std::uniform_real_distribution<float> dis;
+    
+    // Instance streaming of the CPU backend: VBO is split into STREAM_SEGMENTS segments
+    // that stay mapped; a segment is rewritten only after the fence of its last draw passed
+    static constexpr int STREAM_SEGMENTS = 3;
+    static constexpr int INSTANCE_STREAMS = 9; // x, y, z, size, rotation, r, g, b, a
+    float* mappedInstances;
+    GLsync segmentFences[STREAM_SEGMENTS];
+    int streamSegment;
+    ShaderProgram* shader; // null when render-less
+    RandomStream generator; // spawning, "particles" stream of the RandomService
     
     size_t maxParticles;
     glm::vec3 emitterPosition;
-    float emissionRate;
-    float lastEmissionTime;
     
     // Texture support
     GLuint smokeTexture;
@@ -48,32 +65,124 @@ private:
     // Current particle type for new emissions
     ParticleType currentParticleType;
     
-    // Physics constants
-    const float GRAVITY = -9.8f;
-    const float BOUNCE_DAMPING = 0.7f;
-    const float GROUND_LEVEL = 0.0f;
+    // Persistent emitters, a handle is an index into emitters plus its generation
+    struct EmitterSlot {
+        ParticleEmitterDesc desc;
+        float accumulator = 0.0f; // fractional particles carried over to the next frame
+        int burst = 0;            // one-shot particles requested for the next update()
+        uint32_t generation = 0;
+        bool alive = false;
+    };
+    std::vector<EmitterSlot> emitters;
+    std::vector<uint32_t> freeEmitters;
+    
+    // One-shot emissions of emit(), spawned by the next update()
+    struct Burst {
+        ParticleEmitterDesc desc;
+        int count;
+    };
+    std::vector<Burst> bursts;
+    
+    // Emission batch of one update(), sorted by priority
+    struct EmissionRequest {
+        const ParticleEmitterDesc* desc;
+        int count;
+    };
+    std::vector<EmissionRequest> emissionBatch;
+    
+    // Static world the particles collide with, rebuilt when its colliders change,
+    // or a grid built elsewhere (sharedGrid, e.g. by the PhysicsWorker)
+    const PhysicsSystem* collisionWorld = nullptr;
+    ParticleCollisionGrid collisionGrid;
+    const ParticleCollisionGrid* sharedGrid = nullptr;
+    // the grid on the GPU: solid cells of a source revision and terrain columns of a key
+    uint32_t uploadedSolidRevision = UINT32_MAX;
+    ParticleCollisionGrid::TerrainKey uploadedTerrain;
+    bool terrainUploaded = false;
+    
+    // Positions of the live particles for the collision queries, built by the first query after update()
+    ParticleSpatialHash particleHash;
+    bool particleHashValid = false;
+    
+    // Compute shader backend, null for the CPU backend
+    std::unique_ptr<GpuParticleBackend> gpu;
+    ParticleStats stats;
     
 public:
-    ParticleSystem(ShaderProgram& shaderProgram, size_t maxParticles = 1000);
+    // throws if the GPU backend cannot be created (e.g. compute shader compilation fails)
+    ParticleSystem(ShaderProgram& shaderProgram, size_t maxParticles = 1000, ParticleBackend backend = ParticleBackend::CPU);
+    // render-less: the CPU backend without any GL object (no context needed), draw does nothing
+    explicit ParticleSystem(size_t maxParticles);
     ~ParticleSystem();
     
+    // Emitters; all of them are processed in one batched emission pass in update()
+    ParticleEmitterHandle createEmitter(const ParticleEmitterDesc& desc);
+    void destroyEmitter(ParticleEmitterHandle handle);
+    // null for a destroyed emitter; the description may be changed in place
+    ParticleEmitterDesc* getEmitter(ParticleEmitterHandle handle);
+    void setEmitterPosition(ParticleEmitterHandle handle, const glm::vec3& position);
+    void setEmitterActive(ParticleEmitterHandle handle, bool active);
+    // spawns count particles at once in the next update() (also for inactive emitters)
+    void burst(ParticleEmitterHandle handle, int count);
+    
+    // one-shot burst without a persistent emitter, spawned by the next update()
+    void emit(const ParticleEmitterDesc& desc, int count);
+    
+    // Legacy single emitter API: emit() spawns a one-shot burst at the emitter position
     void set_emitter_position(const glm::vec3& position);
     void setParticleType(ParticleType type); // New method to set particle type
     void update(float deltaTime);
-    void draw(const glm::mat4& view, const glm::mat4& projection);
+    // camera facing billboards, viewportSize = size of the target in pixels (for the size clamp)
+    void draw(const glm::mat4& view, const glm::mat4& projection, const glm::vec2& viewportSize,
+              ParticleBlendMode blendMode = ParticleBlendMode::ALPHA);
     void emit(int count = 1);
     void emit_smoke(int count = 1); // New method specifically for smoke
     void reset();
     
-    // Collision detection methods
+    // terrain and static colliders of the physics world (null = flat ground at height 0);
+    // the world must outlive the particle system or be detached first
+    void setCollisionWorld(const PhysicsSystem* physics);
+    // a grid built and kept up to date by someone else, used instead of the collision
+    // world until it is set back to null; it must stay valid until the next call
+    void setCollisionGrid(const ParticleCollisionGrid* grid);
+    const ParticleCollisionGrid& getCollisionGrid() const { return sharedGrid ? *sharedGrid : collisionGrid; }
+    
+    ParticleBackend getBackend() const { return gpu ? ParticleBackend::GPU : ParticleBackend::CPU; }
+    bool isRenderless() const { return !shader && !gpu; }
+    size_t getMaxParticles() const { return maxParticles; }
+    const ParticleStats& getStats() const { return stats; }
+    
+    // Is any particle inside the volume; answered from a spatial hash of the particles that
+    // is built once per frame (the GPU backend reads the particles back for it, slow)
     bool checkCollisionWithBox(const glm::vec3& boxMin, const glm::vec3& boxMax);
     bool checkCollisionWithSphere(const glm::vec3& center, float radius);
     
 private:
     void setupBuffers();
-    void updateBuffers();
-    Particle createParticle();
-    Particle createSmokeParticle(); // New method for creating smoke particles
-    void respawnParticle(Particle& particle);
+    void waitForSegment(int segment);
+    void streamInstances(const ParticlePool& pool, float* destination);
+    void bindInstances(size_t firstFloat, size_t count);
+    size_t liveCount() const;
+    EmitterSlot* findEmitter(ParticleEmitterHandle handle);
+    void processEmission(float deltaTime);
+    void spawn(const ParticleEmitterDesc& emitter, size_t count);
+    
+    // The per-type code is instantiated for every policy, the type is resolved
+    // at compile time (per pool), never per particle
+    template <typename Policy>
+    void spawnParticles(ParticlePool& pool, const ParticleEmitterDesc& emitter, size_t count);
+    template <typename Policy>
+    void setupStyle(ShaderProgram& program);
+    
+    template <typename F>
+    void forEachPool(F&& f) {
+        std::apply([&](auto&... typed) { (f(typed), ...); }, pools);
+    }
+    template <typename F>
+    void forEachPool(F&& f) const {
+        std::apply([&](const auto&... typed) { (f(typed), ...); }, pools);
+    }
+    void updateCollisionGrid();
+    const ParticleSpatialHash& getParticleHash();
     void loadSmokeTexture(); // New method to load smoke texture
 };
@@ -0,0 +1,220 @@
+#include "ParticleTarget.hpp"
+#include <stdexcept>
+
+ParticleTarget::ParticleTarget(int width, int height, int divisor)
+    : width(width > 0 ? width : 1), height(height > 0 ? height : 1), divisor(1)
+{
+    downsampleShader = ShaderProgram("resources/shaders/fullscreen.vert", "resources/shaders/particle_depth_downsample.frag");
+    downsampleShader.activate();
+    downsampleShader.setUniform("depthTexture", 0);
+    downsampleShader.deactivate();
+
+    upsampleShader = ShaderProgram("resources/shaders/fullscreen.vert", "resources/shaders/particle_upsample.frag");
+    upsampleShader.activate();
+    upsampleShader.setUniform("particleTexture", 0);
+    upsampleShader.setUniform("lowDepthTexture", 1);
+    upsampleShader.setUniform("fullDepthTexture", 2);
+    upsampleShader.deactivate();
+
+    // fullscreen triangle is generated from gl_VertexID, core profile still needs a VAO
+    glCreateVertexArrays(1, &emptyVAO);
+    glCreateQueries(GL_TIME_ELAPSED, QUERY_RING, timerQueries);
+
+    setDivisor(divisor);
+}
+
+ParticleTarget::~ParticleTarget()
+{
+    deleteTargets();
+    glDeleteQueries(QUERY_RING, timerQueries);
+    glDeleteVertexArrays(1, &emptyVAO);
+    downsampleShader.clear();
+    upsampleShader.clear();
+}
+
+void ParticleTarget::resize(int width, int height)
+{
+    if (width <= 0 || height <= 0 || (width == this->width && height == this->height))
+        return;
+
+    this->width = width;
+    this->height = height;
+    deleteTargets();
+    createTargets();
+}
+
+void ParticleTarget::setDivisor(int divisor)
+{
+    divisor = divisor >= 3 ? 4 : (divisor == 2 ? 2 : 1);
+    if (divisor == this->divisor && (divisor == 1 || framebuffer))
+        return;
+
+    this->divisor = divisor;
+    deleteTargets();
+    createTargets();
+}
+
+glm::vec2 ParticleTarget::getViewportSize() const
+{
+    if (!isOffscreen())
+        return glm::vec2(width, height);
+    return glm::vec2(lowWidth, lowHeight);
+}
+
+void ParticleTarget::createTargets()
+{
+    if (!isOffscreen())
+        return;
+
+    lowWidth = (width + divisor - 1) / divisor;
+    lowHeight = (height + divisor - 1) / divisor;
+
+    // copy of the opaque depth (same format as the default framebuffer, so it can be blitted)
+    glCreateTextures(GL_TEXTURE_2D, 1, &fullDepthTexture);
+    glTextureStorage2D(fullDepthTexture, 1, GL_DEPTH24_STENCIL8, width, height);
+    glTextureParameteri(fullDepthTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTextureParameteri(fullDepthTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glCreateFramebuffers(1, &fullDepthFramebuffer);
+    glNamedFramebufferTexture(fullDepthFramebuffer, GL_DEPTH_STENCIL_ATTACHMENT, fullDepthTexture, 0);
+
+    // premultiplied particle color, alpha = coverage
+    glCreateTextures(GL_TEXTURE_2D, 1, &colorTexture);
+    glTextureStorage2D(colorTexture, 1, GL_RGBA16F, lowWidth, lowHeight);
+    glTextureParameteri(colorTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTextureParameteri(colorTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &depthTexture);
+    glTextureStorage2D(depthTexture, 1, GL_DEPTH_COMPONENT32F, lowWidth, lowHeight);
+    glTextureParameteri(depthTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTextureParameteri(depthTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glCreateFramebuffers(1, &framebuffer);
+    glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, colorTexture, 0);
+    glNamedFramebufferTexture(framebuffer, GL_DEPTH_ATTACHMENT, depthTexture, 0);
+
+    if (glCheckNamedFramebufferStatus(fullDepthFramebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE ||
+        glCheckNamedFramebufferStatus(framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        throw std::runtime_error("Particle framebuffer is not complete");
+    }
+}
+
+void ParticleTarget::deleteTargets()
+{
+    glDeleteFramebuffers(1, &fullDepthFramebuffer);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteTextures(1, &fullDepthTexture);
+    glDeleteTextures(1, &colorTexture);
+    glDeleteTextures(1, &depthTexture);
+    fullDepthFramebuffer = framebuffer = fullDepthTexture = colorTexture = depthTexture = 0;
+}
+
+void ParticleTarget::begin(const glm::mat4 &projection)
+{
+    if (!isOffscreen())
+        return;
+
+    active = true;
+    // near and far plane of a perspective projection
+    nearFar = glm::vec2(projection[3][2] / (projection[2][2] - 1.0f), projection[3][2] / (projection[2][2] + 1.0f));
+
+    glBlitNamedFramebuffer(0, fullDepthFramebuffer, 0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, lowWidth, lowHeight);
+
+    // reduce the opaque depth to the target resolution
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthFunc(GL_ALWAYS);
+    downsampleShader.activate();
+    downsampleShader.setUniform("uDivisor", divisor);
+    glBindTextureUnit(0, fullDepthTexture);
+    glBindVertexArray(emptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glBindTextureUnit(0, 0);
+    downsampleShader.deactivate();
+    glDepthFunc(GL_LESS);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+    const GLfloat clearColor[] = {0.0f, 0.0f, 0.0f, 0.0f};
+    glClearNamedFramebufferfv(framebuffer, GL_COLOR, 0, clearColor);
+
+    // color is accumulated premultiplied, alpha as coverage
+    glDepthMask(GL_FALSE);
+    glEnable(GL_BLEND);
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void ParticleTarget::end()
+{
+    if (!active)
+        return;
+
+    active = false;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width, height);
+
+    // bilateral upsample, composited over the scene
+    glDisable(GL_DEPTH_TEST);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    upsampleShader.activate();
+    upsampleShader.setUniform("uDivisor", divisor);
+    upsampleShader.setUniform("uNearFar", nearFar);
+    glBindTextureUnit(0, colorTexture);
+    glBindTextureUnit(1, depthTexture);
+    glBindTextureUnit(2, fullDepthTexture);
+    glBindVertexArray(emptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glBindTextureUnit(0, 0);
+    glBindTextureUnit(1, 0);
+    glBindTextureUnit(2, 0);
+    upsampleShader.deactivate();
+
+    glEnable(GL_DEPTH_TEST);
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+}
+
+void ParticleTarget::beginTiming()
+{
+    collectTimings();
+
+    // a query still waiting for its result is skipped rather than waited for
+    timing = !queryPending[queryIndex];
+    if (timing)
+        glBeginQuery(GL_TIME_ELAPSED, timerQueries[queryIndex]);
+}
+
+void ParticleTarget::endTiming()
+{
+    if (!timing)
+        return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    queryPending[queryIndex] = true;
+    queryIndex = (queryIndex + 1) % QUERY_RING;
+    timing = false;
+}
+
+void ParticleTarget::collectTimings()
+{
+    for (int i = 0; i < QUERY_RING; i++)
+    {
+        if (!queryPending[i])
+            continue;
+
+        GLint available = 0;
+        glGetQueryObjectiv(timerQueries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            continue;
+
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(timerQueries[i], GL_QUERY_RESULT, &nanoseconds);
+        queryPending[i] = false;
+        gpuTimeMs = static_cast<float>(nanoseconds) / 1.0e6f;
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "ShaderProgram.hpp"
+
+// Low resolution offscreen target for particles.
+//
+// Large smoke billboards are limited by fill rate, so they can be drawn into a target
+// with 1/2 or 1/4 of the screen resolution (divisor 2 or 4). begin() copies the opaque
+// depth of the main framebuffer, reduces it to the target resolution and binds the
+// target; end() upsamples the particles with a depth aware (bilateral) filter and
+// composites them over the main framebuffer. With divisor 1 both calls do nothing
+// and particles are drawn directly.
+//
+// The GPU time of everything between beginTiming() and endTiming() is measured with
+// timer queries and read a few frames later, without stalling.
+class ParticleTarget
+{
+public:
+    ParticleTarget(int width, int height, int divisor = 2);
+    ~ParticleTarget();
+
+    ParticleTarget(const ParticleTarget &) = delete;
+    ParticleTarget &operator=(const ParticleTarget &) = delete;
+
+    void resize(int width, int height);
+    // 1, 2 or 4, other values are rounded to the nearest one
+    void setDivisor(int divisor);
+    int getDivisor() const { return divisor; }
+    bool isOffscreen() const { return divisor > 1; }
+
+    // projection is needed to linearize depth for the upsample
+    void begin(const glm::mat4 &projection);
+    void end();
+    // size of the render target in pixels (the screen size with divisor 1)
+    glm::vec2 getViewportSize() const;
+
+    void beginTiming();
+    void endTiming();
+    float getGpuTimeMs() const { return gpuTimeMs; }
+
+private:
+    static constexpr int QUERY_RING = 4;
+
+    void createTargets();
+    void deleteTargets();
+    void collectTimings();
+
+    ShaderProgram downsampleShader;
+    ShaderProgram upsampleShader;
+
+    GLuint fullDepthFramebuffer = 0;
+    GLuint fullDepthTexture = 0;
+    GLuint framebuffer = 0;
+    GLuint colorTexture = 0;
+    GLuint depthTexture = 0;
+    GLuint emptyVAO = 0;
+
+    GLuint timerQueries[QUERY_RING] = {};
+    bool queryPending[QUERY_RING] = {};
+    int queryIndex = 0;
+    bool timing = false;
+    float gpuTimeMs = 0.0f;
+
+    int width;
+    int height;
+    int lowWidth = 1;
+    int lowHeight = 1;
+    int divisor;
+    glm::vec2 nearFar = glm::vec2(0.1f, 1000.0f);
+    bool active = false;
+};
@@ -0,0 +1,109 @@
+#include "ParticleTypes.hpp"
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+
+namespace {
+
+float random01(RandomStream& generator) {
+    return generator.nextFloat();
+}
+
+float randomLifetime(const ParticleEmitterDesc& emitter, RandomStream& generator) {
+    return emitter.lifetimeMin + random01(generator) * (emitter.lifetimeMax - emitter.lifetimeMin);
+}
+
+} // namespace
+
+glm::vec3 sampleEmitterShape(const ParticleEmitterDesc& emitter, RandomStream& generator) {
+    switch (emitter.shape) {
+    case EmitterShape::SPHERE:
+        // uniform inside the sphere
+        return generator.onSphere(emitter.extents.x * std::cbrt(random01(generator)));
+    case EmitterShape::BOX:
+        return glm::vec3(random01(generator) * 2.0f - 1.0f, random01(generator) * 2.0f - 1.0f,
+                         random01(generator) * 2.0f - 1.0f) * emitter.extents;
+    default:
+        return glm::vec3(0.0f);
+    }
+}
+
+Particle GlowParticle::spawn(const ParticleEmitterDesc& emitter, RandomStream& generator) {
+    Particle particle;
+    
+    particle.position = emitter.position + sampleEmitterShape(emitter, generator);
+    
+    // Random spherical velocity
+    particle.velocity = generator.onSphere(5.0f + random01(generator) * 10.0f);
+    
+    particle.lifetime = randomLifetime(emitter, generator);
+    particle.life = particle.lifetime;
+    
+    // Random shade of the green glow with full alpha
+    particle.color = glm::vec4(
+        0.1f + random01(generator) * 0.15f,
+        0.8f + random01(generator) * 0.2f,
+        0.15f + random01(generator) * 0.15f,
+        1.0f
+    );
+    
+    particle.size = 1.0f;
+    particle.rotation = random01(generator) * glm::two_pi<float>();
+    particle.spin = (random01(generator) - 0.5f) * 4.0f;
+    particle.type = TYPE;
+    
+    return particle;
+}
+
+Particle SmokeParticle::spawn(const ParticleEmitterDesc& emitter, RandomStream& generator) {
+    Particle particle;
+    
+    // Spawn inside the emitter volume
+    particle.position = emitter.position + sampleEmitterShape(emitter, generator);
+    
+    // Smoke particles rise with some random horizontal movement
+    particle.velocity = glm::vec3(
+        (random01(generator) - 0.5f) * 2.0f,  // Some horizontal drift
+        2.0f + random01(generator) * 3.0f,    // Upward movement
+        (random01(generator) - 0.5f) * 2.0f   // Some horizontal drift
+    );
+    
+    particle.lifetime = randomLifetime(emitter, generator);
+    particle.life = particle.lifetime;
+    
+    // Grayish smoke color with transparency
+    particle.color = glm::vec4(
+        0.5f + random01(generator) * 0.3f,    // Gray tones
+        0.5f + random01(generator) * 0.3f,
+        0.5f + random01(generator) * 0.3f,
+        0.8f - random01(generator) * 0.3f     // Semi-transparent
+    );
+    
+    particle.size = 2.0f + random01(generator) * 2.0f;
+    particle.rotation = random01(generator) * glm::two_pi<float>();
+    particle.spin = (random01(generator) - 0.5f) * 1.0f; // slow swirl
+    particle.type = TYPE;
+    
+    return particle;
+}
+
+Particle SparkParticle::spawn(const ParticleEmitterDesc& emitter, RandomStream& generator) {
+    Particle particle;
+    
+    particle.position = emitter.position + sampleEmitterShape(emitter, generator);
+    
+    // Fast burst, biased upwards
+    particle.velocity = generator.onSphere(6.0f + random01(generator) * 6.0f) + glm::vec3(0.0f, 4.0f, 0.0f);
+    
+    particle.lifetime = randomLifetime(emitter, generator);
+    particle.life = particle.lifetime;
+    
+    // Yellow to orange
+    particle.color = glm::vec4(1.0f, 0.6f + random01(generator) * 0.35f, 0.1f + random01(generator) * 0.2f, 1.0f);
+    
+    particle.size = 1.0f;
+    particle.rotation = 0.0f;
+    particle.spin = 0.0f;
+    particle.type = TYPE;
+    
+    return particle;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <tuple>
+#include <glm/glm.hpp>
+#include "ParticleEmitter.hpp"
+#include "ParticleKernels.hpp"
+#include "Random.hpp"
+
+// How particle.frag draws a billboard of the type
+enum class ParticleStyle {
+    GLOW,     // procedural glow with a bright core
+    SOFT,     // soft round puff
+    TEXTURED  // smoke texture (SOFT when the texture is missing)
+};
+
+// Simple particle structure, used when a particle is created
+// (the CPU backend stores live particles in ParticlePools)
+struct Particle {
+    glm::vec3 position;
+    glm::vec3 velocity;
+    glm::vec4 color;
+    float life;        // remaining life time
+    float lifetime;    // total lifetime
+    float size;
+    float rotation;    // billboard angle (radians)
+    float spin;        // angular velocity (radians per second)
+    ParticleType type; // Type of particle
+
+    Particle() : position(0.0f), velocity(0.0f), color(1.0f), life(0.0f), lifetime(0.0f), size(1.0f),
+                 rotation(0.0f), spin(0.0f), type(ParticleType::GLOW) {}
+};
+
+// random point of the emitter volume, relative to the emitter position
+glm::vec3 sampleEmitterShape(const ParticleEmitterDesc& emitter, RandomStream& generator);
+
+// Particle type policies.
+//
+// A policy describes one particle type at compile time:
+//   TYPE, STYLE, SIZE_SCALE, tint()    render parameters
+//   COLLISION                          reaction to the terrain and static colliders
+//   spawn(emitter, generator)          a new particle of the type
+//   integrate(pool, dt, random, path)  one simulation step of a whole pool
+// ParticleSystem keeps a tightly packed ParticlePool per policy and instantiates its
+// emission, update and draw code per policy, so no hot loop branches on the type.
+// A new effect needs a ParticleType value, a policy and an entry in ParticlePolicies
+// (and a branch in the GPU shaders, where all types share one buffer).
+
+struct GlowParticle {
+    static constexpr ParticleType TYPE = ParticleType::GLOW;
+    static constexpr ParticleStyle STYLE = ParticleStyle::GLOW;
+    static constexpr float SIZE_SCALE = 0.3f;
+    static glm::vec4 tint() { return glm::vec4(1.0f, 1.0f, 1.0f, 0.6f); }
+    static constexpr ParticleCollisionResponse COLLISION{0.7f, 0.9f}; // bounces
+
+    static Particle spawn(const ParticleEmitterDesc& emitter, RandomStream& generator);
+    static void integrate(ParticlePool& pool, float deltaTime, ParticleRandom&, ParticleKernelPath path) {
+        integrateGlowParticles(pool, deltaTime, path);
+    }
+};
+
+struct SmokeParticle {
+    static constexpr ParticleType TYPE = ParticleType::SMOKE;
+    static constexpr ParticleStyle STYLE = ParticleStyle::TEXTURED;
+    static constexpr float SIZE_SCALE = 1.0f; // smoke puffs are a few meters wide
+    static glm::vec4 tint() { return glm::vec4(1.0f, 1.0f, 1.0f, 0.7f); }
+    static constexpr ParticleCollisionResponse COLLISION{0.0f, 1.0f}; // slides along walls and eaves
+
+    static Particle spawn(const ParticleEmitterDesc& emitter, RandomStream& generator);
+    static void integrate(ParticlePool& pool, float deltaTime, ParticleRandom& random, ParticleKernelPath path) {
+        integrateSmokeParticles(pool, deltaTime, random, path);
+    }
+};
+
+struct SparkParticle {
+    static constexpr ParticleType TYPE = ParticleType::SPARK;
+    static constexpr ParticleStyle STYLE = ParticleStyle::SOFT;
+    static constexpr float SIZE_SCALE = 0.25f;
+    static glm::vec4 tint() { return glm::vec4(1.0f, 1.0f, 1.0f, 0.9f); }
+    static constexpr ParticleCollisionResponse COLLISION{0.0f, 0.8f}; // no rebound, skid along the surface losing 20% speed per contact
+
+    static Particle spawn(const ParticleEmitterDesc& emitter, RandomStream& generator);
+    static void integrate(ParticlePool& pool, float deltaTime, ParticleRandom&, ParticleKernelPath) {
+        integrateSparkParticles(pool, deltaTime);
+    }
+};
+
+template <typename... Policies>
+struct ParticlePolicyList {
+    static constexpr size_t size = sizeof...(Policies);
+};
+
+// every particle type in ParticleType order
+using ParticlePolicies = ParticlePolicyList<GlowParticle, SmokeParticle, SparkParticle>;
+static_assert(ParticlePolicies::size == PARTICLE_TYPE_COUNT, "every ParticleType needs a policy");
+
+// live particles of one type
+template <typename Policy>
+struct TypedParticlePool {
+    using policy = Policy;
+    ParticlePool pool;
+};
+
+template <typename List>
+struct ParticlePoolTuple;
+
+template <typename... Policies>
+struct ParticlePoolTuple<ParticlePolicyList<Policies...>> {
+    using type = std::tuple<TypedParticlePool<Policies>...>;
+};
+
+using ParticlePools = ParticlePoolTuple<ParticlePolicies>::type;
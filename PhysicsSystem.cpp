@@ -1,7 +1,12 @@
 #include "PhysicsSystem.hpp"
 #include "camera.hpp"
+#include "HeightField.hpp"
 #include <algorithm>
 #include <iostream>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include "Random.hpp"
 
 PhysicsSystem::PhysicsSystem() : worldBounds(glm::vec3(-50.0f, -10.0f, -50.0f), glm::vec3(50.0f, 50.0f, 50.0f)) {
     // Default world bounds - can be changed later
@@ -10,6 +15,7 @@ PhysicsSystem::PhysicsSystem() : worldBounds(glm::vec3(-50.0f, -10.0f, -50.0f),
 void PhysicsSystem::setWorldBounds(const glm::vec3& min, const glm::vec3& max) {
     worldBounds.min = min;
     worldBounds.max = max;
+    revision++;
 }
 
 bool PhysicsSystem::isInsideWorld(const glm::vec3& position) const {
@@ -26,44 +32,271 @@ glm::vec3 PhysicsSystem::constrainToWorld(const glm::vec3& position) const {
     );
 }
 
-void PhysicsSystem::addCollisionObject(const CollisionObject& obj) {
+CollisionHandle PhysicsSystem::addCollisionObject(const CollisionObject& obj) {
+    uint32_t slot;
+    if (!freeColliderSlots.empty()) {
+        slot = freeColliderSlots.back();
+        takeFreeSlot(slot);
+    } else {
+        slot = static_cast<uint32_t>(colliderSlots.size());
+        colliderSlots.emplace_back();
+    }
+    placeCollisionObject(slot, obj);
+    return makeHandle(slot);
+}
+
+void PhysicsSystem::insertCollisionObject(CollisionHandle handle, const CollisionObject& obj) {
+    if (handle.index >= colliderSlots.size()) {
+        // the slots skipped over are free
+        const uint32_t first = static_cast<uint32_t>(colliderSlots.size());
+        colliderSlots.resize(handle.index + 1);
+        for (uint32_t slot = first; slot < handle.index; slot++) {
+            pushFreeSlot(slot);
+        }
+    } else {
+        if (colliderSlots[handle.index].alive) {
+            removeCollisionObject(makeHandle(handle.index));
+        }
+        if (colliderSlots[handle.index].freeIndex != UINT32_MAX) {
+            takeFreeSlot(handle.index);
+        }
+    }
+    colliderSlots[handle.index].generation = handle.generation;
+    placeCollisionObject(handle.index, obj);
+}
+
+void PhysicsSystem::pushFreeSlot(uint32_t slot) {
+    colliderSlots[slot].freeIndex = static_cast<uint32_t>(freeColliderSlots.size());
+    freeColliderSlots.push_back(slot);
+}
+
+void PhysicsSystem::takeFreeSlot(uint32_t slot) {
+    const uint32_t index = colliderSlots[slot].freeIndex;
+    const uint32_t last = freeColliderSlots.back();
+    freeColliderSlots[index] = last;
+    colliderSlots[last].freeIndex = index;
+    freeColliderSlots.pop_back();
+    colliderSlots[slot].freeIndex = UINT32_MAX;
+}
+
+void PhysicsSystem::placeCollisionObject(uint32_t slot, const CollisionObject& obj) {
+    ColliderSlot& entry = colliderSlots[slot];
+    entry.dense = static_cast<uint32_t>(collisionObjects.size());
+    entry.alive = true;
     collisionObjects.push_back(obj);
+    denseSlots.push_back(slot);
+
+    if (obj.type == CollisionType::PLANE) {
+        entry.proxy = DynamicAabbTree::NULL_NODE;
+        unboundedObjects.push_back(slot);
+    } else {
+        entry.proxy = broadphase.createProxy(getBounds(obj), slot);
+    }
+    revision++;
+}
+
+void PhysicsSystem::removeCollisionObject(CollisionHandle handle) {
+    if (!isAlive(handle)) {
+        return;
+    }
+    ColliderSlot& entry = colliderSlots[handle.index];
+    if (entry.proxy != DynamicAabbTree::NULL_NODE) {
+        broadphase.destroyProxy(entry.proxy);
+    } else {
+        unboundedObjects.erase(std::find(unboundedObjects.begin(), unboundedObjects.end(), handle.index));
+    }
+
+    // the last collider moves into the hole
+    const uint32_t lastDense = static_cast<uint32_t>(collisionObjects.size() - 1);
+    if (entry.dense != lastDense) {
+        collisionObjects[entry.dense] = collisionObjects[lastDense];
+        denseSlots[entry.dense] = denseSlots[lastDense];
+        colliderSlots[denseSlots[entry.dense]].dense = entry.dense;
+    }
+    collisionObjects.pop_back();
+    denseSlots.pop_back();
+
+    entry.alive = false;
+    entry.proxy = DynamicAabbTree::NULL_NODE;
+    entry.generation++;
+    pushFreeSlot(handle.index);
+    revision++;
 }
 
 void PhysicsSystem::clearCollisionObjects() {
     collisionObjects.clear();
+    denseSlots.clear();
+    broadphase.clear();
+    unboundedObjects.clear();
+    // outstanding handles must stay stale, so the slots are freed, not dropped
+    freeColliderSlots.clear();
+    for (uint32_t slot = static_cast<uint32_t>(colliderSlots.size()); slot-- > 0;) {
+        ColliderSlot& entry = colliderSlots[slot];
+        if (entry.alive) {
+            entry.alive = false;
+            entry.proxy = DynamicAabbTree::NULL_NODE;
+            entry.generation++;
+        }
+        pushFreeSlot(slot);
+    }
+    revision++;
 }
 
-bool PhysicsSystem::checkCollision(const glm::vec3& position, float radius) const {
+const CollisionObject* PhysicsSystem::getCollisionObject(CollisionHandle handle) const {
+    return isAlive(handle) ? &collisionObjects[colliderSlots[handle.index].dense] : nullptr;
+}
+
+void PhysicsSystem::moveCollisionObject(CollisionHandle handle, const glm::vec3& position) {
+    if (!isAlive(handle)) {
+        return;
+    }
+    const ColliderSlot& entry = colliderSlots[handle.index];
+    CollisionObject& obj = collisionObjects[entry.dense];
+    obj.position = position;
+    if (entry.proxy != DynamicAabbTree::NULL_NODE) {
+        broadphase.moveProxy(entry.proxy, getBounds(obj)); // small moves stay inside the fat bounds
+    }
+    revision++;
+}
+
+Aabb PhysicsSystem::getBounds(const CollisionObject& obj) {
+    const glm::vec3 half = obj.type == CollisionType::BOX ? obj.size * 0.5f : glm::vec3(obj.size.x);
+    return { obj.position - half, obj.position + half };
+}
+
+void PhysicsSystem::gatherCandidates(const glm::vec3& min, const glm::vec3& max) const {
+    candidates.clear();
+    for (uint32_t slot : unboundedObjects) {
+        candidates.push_back(colliderSlots[slot].dense);
+    }
+    broadphase.queryOverlap({ min, max }, [this](uint32_t slot) {
+        candidates.push_back(colliderSlots[slot].dense);
+        return true;
+    });
+}
+
+void PhysicsSystem::queryOverlap(const glm::vec3& min, const glm::vec3& max, std::vector<CollisionHandle>& result) const {
+    // the tree stores fat bounds, the candidates are checked against the exact ones
+    const Aabb box{ min - worldOffset, max - worldOffset };
+    result.clear();
+    gatherCandidates(box.min, box.max);
+    for (uint32_t index : candidates) {
+        const CollisionObject& obj = collisionObjects[index];
+        const bool overlaps = obj.type == CollisionType::PLANE ? box.min.y <= obj.position.y : getBounds(obj).overlaps(box);
+        if (overlaps) {
+            result.push_back(makeHandle(denseSlots[index]));
+        }
+    }
+}
+
+bool PhysicsSystem::sweepAgainst(const CollisionObject& obj, const glm::vec3& origin, float radius, const glm::vec3& direction,
+                                 float maxDistance, float& distance, glm::vec3& normal) const {
+    switch (obj.type) {
+        case CollisionType::SPHERE: {
+            // ray against the sphere grown by the radius
+            const glm::vec3 offset = origin - obj.position;
+            if (glm::dot(offset, offset) <= (obj.size.x + radius) * (obj.size.x + radius)) {
+                distance = 0.0f;
+                normal = -direction; // started inside
+                return true;
+            }
+            if (!intersectRaySphere(origin, direction, obj.position, obj.size.x + radius, maxDistance, distance)) {
+                return false;
+            }
+            normal = glm::normalize(offset + direction * distance);
+            return true;
+        }
+        case CollisionType::BOX:
+            return intersectSweptSphereAabb(origin, direction, radius, getBounds(obj), maxDistance, distance, normal);
+        case CollisionType::PLANE: {
+            // floor, solid below its height
+            const float height = origin.y - radius - obj.position.y;
+            if (height <= 0.0f) {
+                distance = 0.0f;
+                normal = -direction;
+                return true;
+            }
+            if (direction.y >= 0.0f || height > -direction.y * maxDistance) {
+                return false;
+            }
+            distance = height / -direction.y;
+            normal = glm::vec3(0.0f, 1.0f, 0.0f);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PhysicsSystem::sphereCast(const glm::vec3& origin, float radius, const glm::vec3& direction, float maxDistance, RaycastHit& hit) const {
+    const float length = glm::length(direction);
+    if (length <= 0.0f) {
+        return false;
+    }
+    const glm::vec3 dir = direction / length;
+    const glm::vec3 start = origin - worldOffset;
+
+    bool found = false;
+    const auto test = [&](uint32_t slot) {
+        float distance;
+        glm::vec3 normal;
+        if (sweepAgainst(collisionObjects[colliderSlots[slot].dense], start, radius, dir, maxDistance, distance, normal)) {
+            found = true;
+            maxDistance = distance; // only closer hits from now on
+            hit.distance = distance;
+            hit.normal = normal;
+            hit.point = origin + dir * distance - normal * radius;
+            hit.collider = makeHandle(slot);
+        }
+    };
+
+    for (uint32_t slot : unboundedObjects) {
+        test(slot);
+    }
+    broadphase.raycast(start, dir, radius, maxDistance, [&](uint32_t slot, float) {
+        test(slot);
+        return maxDistance;
+    });
+    return found;
+}
+
+bool PhysicsSystem::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RaycastHit& hit) const {
+    return sphereCast(origin, 0.0f, direction, maxDistance, hit);
+}
+
+bool PhysicsSystem::collidesWith(const CollisionObject& obj, const glm::vec3& center, float radius) const {
+    switch (obj.type) {
+        case CollisionType::SPHERE:
+            return checkSphereCollision(center, radius, obj);
+        case CollisionType::BOX:
+            return checkBoxCollision(center, radius, obj);
+        case CollisionType::PLANE:
+            // Simple plane collision (floor)
+            return center.y - radius <= obj.position.y;
+    }
+    return false;
+}
+
+bool PhysicsSystem::checkCandidates(const glm::vec3& position, float radius) const {
     // Check world bounds first
     if (!isInsideWorld(position)) {
         return true;
     }
     
-    // Check collision objects
-    for (const auto& obj : collisionObjects) {
-        switch (obj.type) {
-            case CollisionType::SPHERE:
-                if (checkSphereCollision(position, radius, obj)) {
-                    return true;
-                }
-                break;
-            case CollisionType::BOX:
-                if (checkBoxCollision(position, radius, obj)) {
-                    return true;
-                }
-                break;
-            case CollisionType::PLANE:
-                // Simple plane collision (floor)
-                if (position.y - radius <= obj.position.y) {
-                    return true;
-                }
-                break;
+    const glm::vec3 local = position - worldOffset;
+    for (uint32_t index : candidates) {
+        if (collidesWith(collisionObjects[index], local, radius)) {
+            return true;
         }
     }
     return false;
 }
 
+bool PhysicsSystem::checkCollision(const glm::vec3& position, float radius) const {
+    const glm::vec3 local = position - worldOffset;
+    gatherCandidates(local - radius, local + radius);
+    return checkCandidates(position, radius);
+}
+
 bool PhysicsSystem::checkSphereCollision(const glm::vec3& center, float radius, const CollisionObject& obj) const {
     float distance = glm::length(center - obj.position);
     return distance <= (radius + obj.size.x); // obj.size.x is the sphere radius
@@ -82,25 +315,14 @@ bool PhysicsSystem::checkBoxCollision(const glm::vec3& center, float radius, con
 }
 
 glm::vec3 PhysicsSystem::moveCamera(Camera& camera, const glm::vec3& movement) const {
-    glm::vec3 newPosition = camera.Position + movement;
+    const float radius = 0.5f;
     
-    // Check if the new position would cause a collision
-    if (checkCollision(newPosition, 0.5f)) {
-        // Try sliding along walls
-        glm::vec3 slidingMovement = calculateWallSliding(movement, camera.Position, 0.5f);
-        newPosition = camera.Position + slidingMovement;
-        
-        // Final check - if still colliding, don't move
-        if (checkCollision(newPosition, 0.5f)) {
-            return glm::vec3(0.0f); // No movement
-        }
-        
-        // Trigger wall hit callback
-        if (wallHitCallback) {
-            wallHitCallback(newPosition);
-        }
-        
-        return slidingMovement;
+    // one broadphase query, the contacts slide the camera along walls and corners
+    std::vector<Contact> contacts;
+    glm::vec3 newPosition = camera.Position + resolveMovement(camera.Position, movement, radius, &contacts);
+    
+    if (!contacts.empty()) {
+        events.push_back({ PhysicsEventType::WALL_HIT, newPosition });
     }
     
     // Check world bounds
@@ -117,35 +339,41 @@ bool PhysicsSystem::checkPlayerCollision(const glm::vec3& playerPos, float playe
 }
 
 bool PhysicsSystem::checkProjectileHit(const glm::vec3& projectilePos, float projectileRadius, glm::vec3& hitPoint) const {
-    for (const auto& obj : collisionObjects) {
-        bool hit = false;
-        
-        switch (obj.type) {
-            case CollisionType::SPHERE:
-                hit = checkSphereCollision(projectilePos, projectileRadius, obj);
-                break;
-            case CollisionType::BOX:
-                hit = checkBoxCollision(projectilePos, projectileRadius, obj);
-                break;
-            case CollisionType::PLANE:
-                hit = (projectilePos.y - projectileRadius <= obj.position.y);
-                break;
-        }
-        
-        if (hit) {
-            hitPoint = obj.position;
-            if (objectHitCallback) {
-                objectHitCallback(hitPoint);
-            }
+    const glm::vec3 local = projectilePos - worldOffset;
+    gatherCandidates(local - projectileRadius, local + projectileRadius);
+    for (uint32_t index : candidates) {
+        const CollisionObject& obj = collisionObjects[index];
+        if (collidesWith(obj, local, projectileRadius)) {
+            hitPoint = obj.position + worldOffset;
+            events.push_back({ PhysicsEventType::OBJECT_HIT, hitPoint });
             return true;
         }
     }
     return false;
 }
 
+void PhysicsSystem::setTerrain(const HeightField* heights) {
+    terrain = heights;
+    terrainRevision++;
+}
+
+void PhysicsSystem::setWorldOffset(const glm::vec3& offset) {
+    worldOffset = offset;
+    // every step moves the world a little, the sampled heights only need to follow
+    // once it adds up to a grid cell
+    const glm::vec3 moved = glm::abs(offset - terrainRevisionOffset);
+    if (std::max(moved.x, moved.z) >= TERRAIN_REVISION_STEP) {
+        terrainRevisionOffset = offset;
+        terrainRevision++;
+    }
+}
+
 float PhysicsSystem::getHeightAtPosition(const glm::vec3& position) const {
-    // Simple height map implementation - can be extended with actual height map data
-    // For now, create some simple hills using sine waves
+    if (terrain) {
+        return terrain->getHeight(position.x - worldOffset.x, position.z - worldOffset.z);
+    }
+
+    // no terrain: some simple hills using sine waves
     float height = 0.0f;
     
     // Add some terrain variation
@@ -168,43 +396,140 @@ glm::vec3 PhysicsSystem::adjustForHeightMap(const glm::vec3& position) const {
 }
 
 glm::vec3 PhysicsSystem::calculateWallSliding(const glm::vec3& desiredMovement, const glm::vec3& position, float radius) const {
-    // Get the normal of the collision surface
-    glm::vec3 normal = getNormalAtCollision(position + desiredMovement, radius);
-    
-    // Project the movement vector onto the plane perpendicular to the normal
-    // Sliding vector = movement - (movement · normal) * normal
-    float dot = glm::dot(desiredMovement, normal);
-    glm::vec3 slidingMovement = desiredMovement - dot * normal;
-    
-    // Scale down the sliding movement to prevent getting stuck
-    slidingMovement *= 0.8f;
-    
-    return slidingMovement;
+    // the part of the movement along the contact surfaces
+    return resolveMovement(position, desiredMovement, radius);
 }
 
-glm::vec3 PhysicsSystem::getNormalAtCollision(const glm::vec3& position, float radius) const {
-    // Simple normal calculation - in a real implementation, this would be more sophisticated
+bool PhysicsSystem::sphereSphereContact(const glm::vec3& center, float radius, const CollisionObject& obj, Contact& contact) const {
+    const glm::vec3 offset = center - obj.position;
+    const float distanceSq = glm::dot(offset, offset);
+    const float combined = radius + obj.size.x; // obj.size.x is the sphere radius
+    if (distanceSq > combined * combined) {
+        return false;
+    }
+    const float distance = std::sqrt(distanceSq);
+    contact.normal = distance > 1e-6f ? offset / distance : glm::vec3(0.0f, 1.0f, 0.0f);
+    contact.depth = combined - distance;
+    contact.point = obj.position + contact.normal * obj.size.x;
+    return true;
+}
+
+bool PhysicsSystem::sphereBoxContact(const glm::vec3& center, float radius, const CollisionObject& obj, Contact& contact) const {
+    const glm::vec3 boxMin = obj.position - obj.size * 0.5f;
+    const glm::vec3 boxMax = obj.position + obj.size * 0.5f;
+    const glm::vec3 closestPoint = glm::clamp(center, boxMin, boxMax);
+    const glm::vec3 offset = center - closestPoint;
+    const float distanceSq = glm::dot(offset, offset);
+    if (distanceSq > radius * radius) {
+        return false;
+    }
     
-    // Check each direction to find the collision normal
-    const float epsilon = 0.01f;
-    glm::vec3 normals[] = {
-        glm::vec3(1.0f, 0.0f, 0.0f),   // Right
-        glm::vec3(-1.0f, 0.0f, 0.0f),  // Left
-        glm::vec3(0.0f, 1.0f, 0.0f),   // Up
-        glm::vec3(0.0f, -1.0f, 0.0f),  // Down
-        glm::vec3(0.0f, 0.0f, 1.0f),   // Forward
-        glm::vec3(0.0f, 0.0f, -1.0f)   // Backward
-    };
+    if (distanceSq > 1e-12f) {
+        // center outside the box: the closest point is the contact
+        const float distance = std::sqrt(distanceSq);
+        contact.normal = offset / distance;
+        contact.depth = radius - distance;
+        contact.point = closestPoint;
+        return true;
+    }
     
-    for (const auto& normal : normals) {
-        glm::vec3 testPos = position + normal * epsilon;
-        if (!checkCollision(testPos, radius)) {
-            return -normal; // Return inward normal
+    // center inside the box: out through the nearest face
+    const glm::vec3 toMin = center - boxMin;
+    const glm::vec3 toMax = boxMax - center;
+    int axis = 0;
+    float sign = -1.0f;
+    float faceDistance = toMin.x;
+    for (int i = 0; i < 3; i++) {
+        if (toMin[i] < faceDistance) {
+            faceDistance = toMin[i];
+            axis = i;
+            sign = -1.0f;
+        }
+        if (toMax[i] < faceDistance) {
+            faceDistance = toMax[i];
+            axis = i;
+            sign = 1.0f;
         }
     }
+    contact.normal = glm::vec3(0.0f);
+    contact.normal[axis] = sign;
+    contact.depth = faceDistance + radius;
+    contact.point = center;
+    contact.point[axis] = sign > 0.0f ? boxMax[axis] : boxMin[axis];
+    return true;
+}
+
+bool PhysicsSystem::spherePlaneContact(const glm::vec3& center, float radius, const CollisionObject& obj, Contact& contact) const {
+    // floor, solid below its height
+    const float depth = obj.position.y - (center.y - radius);
+    if (depth < 0.0f) {
+        return false;
+    }
+    contact.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+    contact.depth = depth;
+    contact.point = glm::vec3(center.x, obj.position.y, center.z);
+    return true;
+}
+
+bool PhysicsSystem::contactWith(const CollisionObject& obj, const glm::vec3& center, float radius, Contact& contact) const {
+    switch (obj.type) {
+        case CollisionType::SPHERE:
+            return sphereSphereContact(center, radius, obj, contact);
+        case CollisionType::BOX:
+            return sphereBoxContact(center, radius, obj, contact);
+        case CollisionType::PLANE:
+            return spherePlaneContact(center, radius, obj, contact);
+    }
+    return false;
+}
+
+size_t PhysicsSystem::findContacts(const glm::vec3& center, float radius, std::vector<Contact>& contacts) const {
+    const size_t first = contacts.size();
+    const glm::vec3 local = center - worldOffset;
+    gatherCandidates(local - radius, local + radius);
+    for (uint32_t index : candidates) {
+        Contact contact;
+        if (contactWith(collisionObjects[index], local, radius, contact)) {
+            contact.point += worldOffset;
+            contact.collider = makeHandle(denseSlots[index]);
+            contacts.push_back(contact);
+        }
+    }
+    return contacts.size() - first;
+}
+
+glm::vec3 PhysicsSystem::resolveMovement(const glm::vec3& position, const glm::vec3& movement, float radius,
+                                         std::vector<Contact>* contacts) const {
+    // resolved in road space, a push never takes the sphere further than its radius
+    const glm::vec3 start = position - worldOffset;
+    const glm::vec3 target = start + movement;
+    const float reach = 2.0f * (radius + CONTACT_SKIN);
+    gatherCandidates(glm::min(start, target) - reach, glm::max(start, target) + reach);
     
-    // Default to up normal if no clear direction is found
-    return glm::vec3(0.0f, 1.0f, 0.0f);
+    // Each contact pushes the sphere out along its normal, which removes the movement
+    // into the surface and keeps the part along it. In a corner the pushes of the walls
+    // interact, a few passes settle them.
+    glm::vec3 resolved = target;
+    for (int iteration = 0; iteration < MAX_RESOLVE_ITERATIONS; iteration++) {
+        bool pushed = false;
+        for (uint32_t index : candidates) {
+            Contact contact;
+            if (!contactWith(collisionObjects[index], resolved, radius, contact) || contact.depth <= 0.0f) {
+                continue;
+            }
+            resolved += contact.normal * (contact.depth + CONTACT_SKIN);
+            pushed = true;
+            if (contacts) {
+                contact.point += worldOffset;
+                contact.collider = makeHandle(denseSlots[index]);
+                contacts->push_back(contact);
+            }
+        }
+        if (!pushed) {
+            break;
+        }
+    }
+    return resolved - start;
 }
 
 void PhysicsSystem::setWallHitCallback(std::function<void(const glm::vec3&)> callback) {
@@ -215,13 +540,70 @@ void PhysicsSystem::setObjectHitCallback(std::function<void(const glm::vec3&)> c
     objectHitCallback = callback;
 }
 
-void PhysicsSystem::remove_collision_object(const glm::vec3& position) {
-    collisionObjects.erase(
-        std::remove_if(collisionObjects.begin(), collisionObjects.end(),
-            [&](const CollisionObject& obj) {
-                // Using a small epsilon for floating-point comparison
-                return glm::all(glm::epsilonEqual(obj.position, position, 0.001f));
-            }),
-        collisionObjects.end()
-    );
+void PhysicsSystem::dispatchEvents() {
+    for (const PhysicsEvent& event : events) {
+        const auto& callback = event.type == PhysicsEventType::WALL_HIT ? wallHitCallback : objectHitCallback;
+        if (callback) {
+            callback(event.point);
+        }
+    }
+    events.clear();
+}
+
+void benchmarkPhysicsQueries() {
+    const int counts[] = { 100, 1000, 4000, 16000 };
+    const int queries = 100000;
+    RandomStream generator(4242);
+
+    std::cout << "Physics query benchmark, " << queries << " queries per run" << std::endl;
+
+    for (int count : counts) {
+        // houses on both sides of a road along -z, like spawn_new_houses
+        PhysicsSystem physics;
+        const float length = count * 5.0f;
+        physics.setWorldBounds(glm::vec3(-100.0f, -10.0f, -length - 50.0f), glm::vec3(100.0f, 50.0f, 50.0f));
+        std::vector<CollisionHandle> handles(count);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < count; i++) {
+            const float side = i % 2 == 0 ? -12.0f : 12.0f;
+            handles[i] = physics.addCollisionObject({ CollisionType::BOX, glm::vec3(side, 0.0f, -(i / 2) * 10.0f), glm::vec3(8.0f, 10.0f, 8.0f) });
+        }
+        const float nsPerAdd = std::chrono::duration<float, std::nano>(std::chrono::high_resolution_clock::now() - start).count() / count;
+
+        std::vector<glm::vec3> points(queries);
+        for (glm::vec3& point : points) {
+            point = glm::vec3(generator.range(-20.0f, 20.0f), generator.range(0.0f, 8.0f), -generator.range(0.0f, length));
+        }
+
+        int hits[2] = {};
+        float nsPerQuery[2] = {};
+        for (int run = 0; run < 2; run++) {
+            start = std::chrono::high_resolution_clock::now();
+            for (const glm::vec3& point : points) {
+                if (run == 0) {
+                    // the linear scan the queries did before the broadphase
+                    for (const auto& obj : physics.getCollisionObjects()) {
+                        if (physics.checkBoxCollision(point, 0.5f, obj)) {
+                            hits[run]++;
+                            break;
+                        }
+                    }
+                } else {
+                    hits[run] += physics.checkCollision(point, 0.5f) ? 1 : 0;
+                }
+            }
+            nsPerQuery[run] = std::chrono::duration<float, std::nano>(std::chrono::high_resolution_clock::now() - start).count() / queries;
+        }
+
+        // the houses leave in the order they came, like in update_houses
+        start = std::chrono::high_resolution_clock::now();
+        for (CollisionHandle handle : handles) {
+            physics.removeCollisionObject(handle);
+        }
+        const float nsPerRemove = std::chrono::duration<float, std::nano>(std::chrono::high_resolution_clock::now() - start).count() / count;
+
+        std::cout << "  " << count << " colliders: linear " << nsPerQuery[0] << " ns/query, tree "
+                  << nsPerQuery[1] << " ns/query (" << (hits[0] == hits[1] ? "same hits" : "HITS DIFFER") << "), add "
+                  << nsPerAdd << " ns, remove " << nsPerRemove << " ns" << std::endl;
+    }
 }
\ No newline at end of file
@@ -3,10 +3,13 @@
 #include <glm/glm.hpp>
 #include <vector>
 #include <functional>
+#include <cstdint>
+#include "AabbTree.hpp"
 
 // Forward declarations
 class Camera;
 class ParticleSystem;
+class HeightField;
 
 // Collision types
 enum class CollisionType {
@@ -26,6 +29,43 @@ struct CollisionObject {
         : type(t), position(pos), size(sz), isStatic(stat) {}
 };
 
+// Stable reference to a collider, valid until the collider is removed
+// (a removed collider's slot is reused with a new generation)
+struct CollisionHandle {
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool isValid() const { return index != UINT32_MAX; }
+    bool operator==(const CollisionHandle& other) const { return index == other.index && generation == other.generation; }
+};
+
+// First collider along a ray or swept sphere
+struct RaycastHit {
+    float distance = 0.0f;
+    glm::vec3 point{0.0f};  // on the collider surface
+    glm::vec3 normal{0.0f};
+    CollisionHandle collider;
+};
+
+// Contact of a sphere with a collider, the normal points from the collider to the sphere
+struct Contact {
+    glm::vec3 normal{0.0f, 1.0f, 0.0f};
+    glm::vec3 point{0.0f}; // deepest point of the collider surface
+    float depth = 0.0f;    // penetration, > 0 when overlapping
+    CollisionHandle collider;
+};
+
+// Hit reported by a query, delivered to the callbacks by dispatchEvents
+enum class PhysicsEventType {
+    WALL_HIT,   // moveCamera slid along a collider
+    OBJECT_HIT  // checkProjectileHit hit a collider
+};
+
+struct PhysicsEvent {
+    PhysicsEventType type;
+    glm::vec3 point;
+};
+
 // Physics world boundaries
 struct WorldBounds {
     glm::vec3 min;
@@ -39,10 +79,40 @@ class PhysicsSystem {
 private:
     std::vector<CollisionObject> collisionObjects;
     WorldBounds worldBounds;
+    uint32_t revision = 0; // changes with every change of the colliders or bounds
+    
+    // Colliders are stored densely (getCollisionObjects) and addressed through slots,
+    // so a handle survives the swap-remove of other colliders. Every collider except
+    // the planes has a proxy in the AABB tree, the planes are tested by every query.
+    struct ColliderSlot {
+        uint32_t dense = 0;
+        uint32_t proxy = DynamicAabbTree::NULL_NODE;
+        uint32_t generation = 0;
+        uint32_t freeIndex = UINT32_MAX; // position in freeColliderSlots, UINT32_MAX while in use
+        bool alive = false;
+    };
+    std::vector<ColliderSlot> colliderSlots;
+    std::vector<uint32_t> freeColliderSlots;
+    std::vector<uint32_t> denseSlots; // slot of every collisionObjects entry
+    DynamicAabbTree broadphase;
+    std::vector<uint32_t> unboundedObjects; // slots
     
-    // Collision callbacks
+    // The colliders and the terrain are in road space, the world scrolls over them by
+    // worldOffset (world = road + worldOffset). Scrolling only changes the offset, the
+    // colliders, their broadphase proxies and the revision stay as they are.
+    const HeightField* terrain = nullptr;
+    glm::vec3 worldOffset{0.0f};
+    glm::vec3 terrainRevisionOffset{0.0f}; // offset at the last terrainRevision change
+    uint32_t terrainRevision = 0;
+    
+    // scratch of the queries: dense indices of the colliders of the last gather
+    mutable std::vector<uint32_t> candidates;
+    
+    // Collision callbacks, the queries only record events (they may run on a copy of
+    // the world another thread owns, see PhysicsWorker)
     std::function<void(const glm::vec3&)> wallHitCallback;
     std::function<void(const glm::vec3&)> objectHitCallback;
+    mutable std::vector<PhysicsEvent> events;
     
 public:
     PhysicsSystem();
@@ -52,9 +122,39 @@ public:
     bool isInsideWorld(const glm::vec3& position) const;
     glm::vec3 constrainToWorld(const glm::vec3& position) const;
     
-    // Collision objects
-    void addCollisionObject(const CollisionObject& obj);
+    // Collision objects, positioned in road space (see setWorldOffset)
+    CollisionHandle addCollisionObject(const CollisionObject& obj);
+    // adds under a handle given out elsewhere (the copies of PhysicsWorker), the slot must be free
+    void insertCollisionObject(CollisionHandle handle, const CollisionObject& obj);
+    void removeCollisionObject(CollisionHandle handle); // ignores stale handles
     void clearCollisionObjects();
+    const CollisionObject* getCollisionObject(CollisionHandle handle) const; // null when removed
+    void moveCollisionObject(CollisionHandle handle, const glm::vec3& position);
+    const std::vector<CollisionObject>& getCollisionObjects() const { return collisionObjects; }
+    const WorldBounds& getWorldBounds() const { return worldBounds; }
+    // caches built from the colliders (e.g. ParticleCollisionGrid) compare revisions
+    uint32_t getRevision() const { return revision; }
+    
+    // Terrain (null = the built-in hills) and how far the world has scrolled over the
+    // terrain and the colliders. The queries take and return world positions. The terrain
+    // revision changes with the terrain and whenever the offset has moved by
+    // TERRAIN_REVISION_STEP, caches of sampled heights follow it; getRevision does not.
+    void setTerrain(const HeightField* heights);
+    void setWorldOffset(const glm::vec3& offset);
+    const glm::vec3& getWorldOffset() const { return worldOffset; }
+    uint32_t getTerrainRevision() const { return terrainRevision; }
+    
+    // Spatial queries
+    void queryOverlap(const glm::vec3& min, const glm::vec3& max, std::vector<CollisionHandle>& result) const;
+    bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RaycastHit& hit) const;
+    bool sphereCast(const glm::vec3& origin, float radius, const glm::vec3& direction, float maxDistance, RaycastHit& hit) const;
+    
+    // Contacts of a sphere with every collider it overlaps (one broadphase query)
+    size_t findContacts(const glm::vec3& center, float radius, std::vector<Contact>& contacts) const;
+    // Analytic narrowphase, false when the sphere does not touch the collider (center in road space)
+    bool sphereSphereContact(const glm::vec3& center, float radius, const CollisionObject& obj, Contact& contact) const;
+    bool sphereBoxContact(const glm::vec3& center, float radius, const CollisionObject& obj, Contact& contact) const;
+    bool spherePlaneContact(const glm::vec3& center, float radius, const CollisionObject& obj, Contact& contact) const;
     
     // Collision detection
     bool checkCollision(const glm::vec3& position, float radius = 0.5f) const;
@@ -70,19 +170,56 @@ public:
     // Projectile collision
     bool checkProjectileHit(const glm::vec3& projectilePos, float projectileRadius, glm::vec3& hitPoint) const;
     
-    // Height map walking (simplified)
+    // Height map walking
     float getHeightAtPosition(const glm::vec3& position) const;
     glm::vec3 adjustForHeightMap(const glm::vec3& position) const;
     
+    // Moves a sphere and pushes it out of every collider it ends in, one contact after
+    // another, so it slides along walls and stops in corners. Returns the movement that
+    // was possible, contacts (optional) receives the contacts that were resolved.
+    glm::vec3 resolveMovement(const glm::vec3& position, const glm::vec3& movement, float radius,
+                              std::vector<Contact>* contacts = nullptr) const;
+    
     // Wall sliding calculation
     glm::vec3 calculateWallSliding(const glm::vec3& desiredMovement, const glm::vec3& position, float radius) const;
     
-    // Callbacks
+    // Callbacks, called by dispatchEvents with the events of the queries since the last call
     void setWallHitCallback(std::function<void(const glm::vec3&)> callback);
     void setObjectHitCallback(std::function<void(const glm::vec3&)> callback);
-
-    void remove_collision_object(const glm::vec3& position);
+    void dispatchEvents();
+    size_t getPendingEventCount() const { return events.size(); }
     
 private:
-    glm::vec3 getNormalAtCollision(const glm::vec3& position, float radius) const;
+    static constexpr int MAX_RESOLVE_ITERATIONS = 4;
+    static constexpr float CONTACT_SKIN = 0.001f; // resolved spheres end this far outside
+    static constexpr float TERRAIN_REVISION_STEP = 1.0f; // meters, a particle grid cell
+    
+    // narrowphase of one collider
+    bool collidesWith(const CollisionObject& obj, const glm::vec3& center, float radius) const;
+    bool contactWith(const CollisionObject& obj, const glm::vec3& center, float radius, Contact& contact) const;
+    
+    // swept sphere against one collider, false = no hit before maxDistance
+    bool sweepAgainst(const CollisionObject& obj, const glm::vec3& origin, float radius, const glm::vec3& direction,
+                      float maxDistance, float& distance, glm::vec3& normal) const;
+    
+    // fills a free slot, taken off the free list already
+    void placeCollisionObject(uint32_t slot, const CollisionObject& obj);
+    
+    // broadphase
+    static Aabb getBounds(const CollisionObject& obj);
+    void pushFreeSlot(uint32_t slot);
+    void takeFreeSlot(uint32_t slot); // O(1), the last free slot takes its place
+    CollisionHandle makeHandle(uint32_t slot) const { return { slot, colliderSlots[slot].generation }; }
+    bool isAlive(CollisionHandle handle) const {
+        return handle.index < colliderSlots.size() && colliderSlots[handle.index].alive &&
+               colliderSlots[handle.index].generation == handle.generation;
+    }
+    // fills candidates with the colliders that may touch the box
+    void gatherCandidates(const glm::vec3& min, const glm::vec3& max) const;
+    // world bounds and the gathered candidates
+    bool checkCandidates(const glm::vec3& position, float radius) const;
 };
+
+// Times checkCollision with the AABB tree against a linear scan over growing numbers
+// of colliders, and add/remove of all of them (key F7), prints the time per query
+void benchmarkPhysicsQueries();
@@ -0,0 +1,217 @@
+#include "PhysicsWorker.hpp"
+#include <chrono>
+
+PhysicsWorker::PhysicsWorker(bool threaded, bool particleGrid) : threaded(threaded), particleGrid(particleGrid) {
+    if (threaded) {
+        worker = std::thread(&PhysicsWorker::workerLoop, this);
+    }
+}
+
+PhysicsWorker::~PhysicsWorker() {
+    if (worker.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+}
+
+CollisionHandle PhysicsWorker::addCollisionObject(const CollisionObject& obj) {
+    // the same slot reuse as PhysicsSystem, the copies get the handle as it is
+    uint32_t slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        slot = static_cast<uint32_t>(slots.size());
+        slots.emplace_back();
+    }
+    slots[slot].alive = true;
+
+    Command command{ CommandType::ADD };
+    command.handle = { slot, slots[slot].generation };
+    command.object = obj;
+    queued.push_back(command);
+    return command.handle;
+}
+
+bool PhysicsWorker::isAlive(CollisionHandle handle) const {
+    return handle.index < slots.size() && slots[handle.index].alive && slots[handle.index].generation == handle.generation;
+}
+
+void PhysicsWorker::removeCollisionObject(CollisionHandle handle) {
+    if (!isAlive(handle)) {
+        return;
+    }
+    slots[handle.index].alive = false;
+    slots[handle.index].generation++;
+    freeSlots.push_back(handle.index);
+
+    Command command{ CommandType::REMOVE };
+    command.handle = handle;
+    queued.push_back(command);
+}
+
+void PhysicsWorker::moveCollisionObject(CollisionHandle handle, const glm::vec3& position) {
+    if (!isAlive(handle)) {
+        return;
+    }
+    Command command{ CommandType::MOVE };
+    command.handle = handle;
+    command.min = position;
+    queued.push_back(command);
+}
+
+void PhysicsWorker::clearCollisionObjects() {
+    freeSlots.clear();
+    for (uint32_t slot = static_cast<uint32_t>(slots.size()); slot-- > 0;) {
+        if (slots[slot].alive) {
+            slots[slot].alive = false;
+            slots[slot].generation++;
+        }
+        freeSlots.push_back(slot);
+    }
+    queued.push_back(Command{ CommandType::CLEAR });
+}
+
+void PhysicsWorker::setWorldBounds(const glm::vec3& min, const glm::vec3& max) {
+    Command command{ CommandType::BOUNDS };
+    command.min = min;
+    command.max = max;
+    queued.push_back(command);
+}
+
+void PhysicsWorker::setTerrain(const HeightField* heights) {
+    Command command{ CommandType::TERRAIN };
+    command.terrain = heights;
+    queued.push_back(command);
+}
+
+void PhysicsWorker::setWorldOffset(const glm::vec3& offset) {
+    Command command{ CommandType::WORLD_OFFSET };
+    command.min = offset;
+    queued.push_back(command);
+}
+
+void PhysicsWorker::setWallHitCallback(std::function<void(const glm::vec3&)> callback) {
+    worlds[0].setWallHitCallback(callback);
+    worlds[1].setWallHitCallback(callback);
+}
+
+void PhysicsWorker::setObjectHitCallback(std::function<void(const glm::vec3&)> callback) {
+    worlds[0].setObjectHitCallback(callback);
+    worlds[1].setObjectHitCallback(callback);
+}
+
+void PhysicsWorker::apply(PhysicsSystem& world, const Command& command) {
+    switch (command.type) {
+    case CommandType::ADD:
+        world.insertCollisionObject(command.handle, command.object);
+        break;
+    case CommandType::REMOVE:
+        world.removeCollisionObject(command.handle);
+        break;
+    case CommandType::MOVE:
+        world.moveCollisionObject(command.handle, command.min);
+        break;
+    case CommandType::CLEAR:
+        world.clearCollisionObjects();
+        break;
+    case CommandType::BOUNDS:
+        world.setWorldBounds(command.min, command.max);
+        break;
+    case CommandType::TERRAIN:
+        world.setTerrain(command.terrain);
+        break;
+    case CommandType::WORLD_OFFSET:
+        world.setWorldOffset(command.min);
+        break;
+    }
+}
+
+void PhysicsWorker::submit() {
+    sync();
+    if (queued.empty() && catchUp.empty()) {
+        return; // both copies are current
+    }
+
+    running.swap(queued);
+    queued.clear();
+    stepRunning = true;
+
+    if (!threaded) {
+        runStep();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stepPending = true;
+    }
+    wake.notify_one();
+}
+
+void PhysicsWorker::sync() {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    if (stepRunning) {
+        if (threaded) {
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [this] { return !stepPending; });
+        }
+        stepRunning = false;
+
+        // events of the queries on the old front, then the stepped copy takes over
+        worlds[front].dispatchEvents();
+        front = 1 - front;
+        catchUp.swap(running);
+        running.clear();
+
+        stats.stepMs = lastStepMs;
+        stats.commands = lastCommands;
+        stats.steps++;
+    }
+    worlds[front].dispatchEvents();
+
+    stats.waitMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void PhysicsWorker::runStep() {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    PhysicsSystem& world = worlds[1 - front];
+    for (const Command& command : catchUp) {
+        apply(world, command);
+    }
+    for (const Command& command : running) {
+        apply(world, command);
+    }
+    lastCommands = catchUp.size() + running.size();
+    catchUp.clear();
+
+    ParticleCollisionGrid& grid = grids[1 - front];
+    if (particleGrid) {
+        if (grid.needsRebuild(&world)) {
+            grid.build(&world);
+        }
+        grid.setSolidOffset(world.getWorldOffset());
+    }
+
+    lastStepMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void PhysicsWorker::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [this] { return stepPending || quit; });
+        if (quit) {
+            return;
+        }
+        lock.unlock();
+        runStep();
+        lock.lock();
+        stepPending = false;
+        done.notify_one();
+    }
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include "PhysicsSystem.hpp"
+#include "ParticleCollision.hpp"
+
+struct PhysicsWorkerStats {
+    float stepMs = 0.0f; // worker time of the last step
+    float waitMs = 0.0f; // main thread blocked in the last sync
+    size_t commands = 0; // applied by the last step, catching up included
+    uint64_t steps = 0;
+};
+
+// Runs the physics world on a worker thread.
+//
+// The world exists twice. Gameplay reads the front copy (the state after the last
+// finished step) without locks while the worker brings the back copy up to date.
+// Changes do not touch either copy directly: they are queued as commands and applied by
+// the next step, only the handles of added colliders are handed out at once (the copies
+// take them over through PhysicsSystem::insertCollisionObject). sync() waits for the
+// running step and swaps the copies; the new back copy catches up with the commands of
+// that step during the next one, so the copies never need to be copied.
+//
+// A step also rebuilds the ParticleCollisionGrid of its copy when houses came or went;
+// the colliders stay in road space while the world scrolls (setWorldOffset), so a step
+// without them only hands the new offset to the grid. Wall and hit events of the
+// queries on the front copy are delivered to the callbacks in a batch by sync(), on the
+// calling thread.
+class PhysicsWorker {
+public:
+    // threaded false = submit runs the step itself; particleGrid false = no particle grid is
+    // built (a world nothing collides particles with, the step only applies the commands)
+    explicit PhysicsWorker(bool threaded = true, bool particleGrid = true);
+    ~PhysicsWorker();
+
+    PhysicsWorker(const PhysicsWorker&) = delete;
+    PhysicsWorker& operator=(const PhysicsWorker&) = delete;
+
+    // Commands, applied by the next step
+    CollisionHandle addCollisionObject(const CollisionObject& obj);
+    void removeCollisionObject(CollisionHandle handle); // ignores stale handles
+    void moveCollisionObject(CollisionHandle handle, const glm::vec3& position);
+    void clearCollisionObjects();
+    void setWorldBounds(const glm::vec3& min, const glm::vec3& max);
+    void setTerrain(const HeightField* heights);
+    void setWorldOffset(const glm::vec3& offset);
+    bool isAlive(CollisionHandle handle) const; // as of the queued commands
+
+    void setWallHitCallback(std::function<void(const glm::vec3&)> callback);
+    void setObjectHitCallback(std::function<void(const glm::vec3&)> callback);
+
+    // Starts a step with the queued commands, after waiting for the running one
+    void submit();
+    // Waits for the running step, swaps the copies and delivers the events
+    void sync();
+
+    // The world and particle grid of the last finished step, valid until the next sync
+    const PhysicsSystem& getWorld() const { return worlds[front]; }
+    const ParticleCollisionGrid& getParticleGrid() const { return grids[front]; }
+    bool isThreaded() const { return threaded; }
+    const PhysicsWorkerStats& getStats() const { return stats; }
+
+private:
+    enum class CommandType {
+        ADD,
+        REMOVE,
+        MOVE,
+        CLEAR,
+        BOUNDS,
+        TERRAIN,
+        WORLD_OFFSET
+    };
+    struct Command {
+        CommandType type;
+        CollisionHandle handle{};
+        CollisionObject object{ CollisionType::SPHERE, glm::vec3(0.0f), glm::vec3(0.0f) }; // ADD
+        glm::vec3 min{0.0f}; // MOVE, BOUNDS, WORLD_OFFSET
+        glm::vec3 max{0.0f}; // BOUNDS
+        const HeightField* terrain = nullptr;
+    };
+
+    static void apply(PhysicsSystem& world, const Command& command);
+    void runStep(); // worker thread, owns the back copy
+    void workerLoop();
+
+    PhysicsSystem worlds[2];
+    ParticleCollisionGrid grids[2];
+    int front = 0;
+
+    // main thread: commands since the last submit and the handle slots as they will be
+    std::vector<Command> queued;
+    struct Slot {
+        uint32_t generation = 0;
+        bool alive = false;
+    };
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+
+    // owned by the running step until sync
+    std::vector<Command> running;
+    std::vector<Command> catchUp; // what the back copy is missing, the last step of the front
+    bool stepRunning = false;
+
+    bool threaded;
+    bool particleGrid;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    bool stepPending = false; // guarded by mutex
+    bool quit = false;        // guarded by mutex
+
+    PhysicsWorkerStats stats;
+    float lastStepMs = 0.0f; // written by the worker, read after sync
+    size_t lastCommands = 0;
+};
@@ -2,12 +2,14 @@
 #include <iostream>
 
 Projectile::Projectile(glm::vec3 pos, glm::vec3 vel, float r)
-    : position(pos), velocity(vel), radius(r), life(5.0f), alive(true) {
+    : position(pos), previousPosition(pos), velocity(vel), radius(r), life(5.0f), alive(true) {
 }
 
 void Projectile::update(float deltaTime) {
     if (!alive) return;
     
+    previousPosition = position;
+    
     // Apply gravity
     velocity.y -= 9.81f * deltaTime;
     
@@ -26,12 +28,15 @@ void Projectile::update(float deltaTime) {
     }
 }
 
-void Projectile::draw(Model* cupcakeModel) {
+void Projectile::draw(Model* cupcakeModel, float alpha, const glm::vec3& worldStep) const {
     if (!alive || !cupcakeModel) return;
     
+    // previousPosition was taken after the world moved, the step started at previousPosition - worldStep
+    const glm::vec3 renderPosition = glm::mix(previousPosition - worldStep, position, alpha);
+    
     // Create model matrix for this projectile
     glm::mat4 modelMatrix = glm::mat4(1.0f);
-    modelMatrix = glm::translate(modelMatrix, position);
+    modelMatrix = glm::translate(modelMatrix, renderPosition);
     
     // Rotate cupcake to face upwards (rotate 90 degrees around X-axis)
     modelMatrix = glm::rotate(modelMatrix, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
@@ -42,3 +47,68 @@ void Projectile::draw(Model* cupcakeModel) {
     // The cupcake model will handle its own drawing with the current shader
     cupcakeModel->draw(modelMatrix);
 }
+
+ProjectilePool::ProjectilePool(size_t capacity)
+    : slots(capacity) {
+    projectiles.reserve(capacity);
+    denseSlots.reserve(capacity);
+    freeSlots.reserve(capacity);
+    // the low slots first
+    for (size_t slot = capacity; slot-- > 0;) {
+        freeSlots.push_back(static_cast<uint32_t>(slot));
+    }
+}
+
+ProjectileHandle ProjectilePool::spawn(const glm::vec3& position, const glm::vec3& velocity, float radius) {
+    if (freeSlots.empty()) {
+        return {};
+    }
+    const uint32_t slot = freeSlots.back();
+    freeSlots.pop_back();
+    slots[slot].dense = static_cast<uint32_t>(projectiles.size());
+    slots[slot].alive = true;
+    projectiles.emplace_back(position, velocity, radius);
+    denseSlots.push_back(slot);
+    return { slot, slots[slot].generation };
+}
+
+void ProjectilePool::destroy(ProjectileHandle handle) {
+    if (isAlive(handle)) {
+        removeAt(slots[handle.index].dense);
+    }
+}
+
+void ProjectilePool::removeAt(size_t index) {
+    Slot& removed = slots[denseSlots[index]];
+    removed.alive = false;
+    removed.generation++;
+    freeSlots.push_back(denseSlots[index]);
+
+    const size_t last = projectiles.size() - 1;
+    if (index != last) {
+        projectiles[index] = projectiles[last];
+        denseSlots[index] = denseSlots[last];
+        slots[denseSlots[index]].dense = static_cast<uint32_t>(index);
+    }
+    projectiles.pop_back();
+    denseSlots.pop_back();
+}
+
+void ProjectilePool::removeDead() {
+    // from the back, so the projectile moved into a hole has been checked already
+    for (size_t i = projectiles.size(); i-- > 0;) {
+        if (!projectiles[i].alive) {
+            removeAt(i);
+        }
+    }
+}
+
+void ProjectilePool::clear() {
+    for (uint32_t slot : denseSlots) {
+        slots[slot].alive = false;
+        slots[slot].generation++;
+        freeSlots.push_back(slot);
+    }
+    projectiles.clear();
+    denseSlots.clear();
+}
@@ -5,10 +5,14 @@
 #include "ShaderProgram.hpp"
 #include "Model.hpp"
 #include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
 
 class Projectile {
 public:
     glm::vec3 position;
+    glm::vec3 previousPosition; // start of the last update step, swept for collisions
     glm::vec3 velocity;
     float radius;
     float life;
@@ -18,5 +22,63 @@ public:
     ~Projectile() = default;
     
     void update(float deltaTime);
-    void draw(Model* cupcakeModel);
+    // alpha interpolates from the previous step, worldStep = scroll of the world in that step
+    void draw(Model* cupcakeModel, float alpha = 1.0f, const glm::vec3& worldStep = glm::vec3(0.0f)) const;
+};
+
+// Stable reference to a projectile, valid until it is removed
+// (a removed projectile's slot is reused with a new generation)
+struct ProjectileHandle {
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool isValid() const { return index != UINT32_MAX; }
+};
+
+// Projectiles in flight, stored contiguously in a pool of fixed capacity.
+//
+// All the memory is taken by the constructor, a shot only constructs a projectile at
+// the end of the array and a removal moves the last one into the hole, so firing
+// never allocates and updates walk one dense array. Iteration covers the projectiles
+// in the pool, dead or not, until removeDead.
+class ProjectilePool {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 4096; // stress tests keep thousands in flight
+
+    explicit ProjectilePool(size_t capacity = DEFAULT_CAPACITY);
+
+    // invalid handle when the pool is full
+    ProjectileHandle spawn(const glm::vec3& position, const glm::vec3& velocity, float radius);
+    void destroy(ProjectileHandle handle); // ignores stale handles
+    void removeAt(size_t index);           // the last projectile moves to index
+    void removeDead();                     // all that are not alive
+    void clear();
+
+    bool isAlive(ProjectileHandle handle) const {
+        return handle.index < slots.size() && slots[handle.index].alive && slots[handle.index].generation == handle.generation;
+    }
+    Projectile* get(ProjectileHandle handle) { return isAlive(handle) ? &projectiles[slots[handle.index].dense] : nullptr; }
+
+    size_t size() const { return projectiles.size(); }
+    size_t capacity() const { return slots.size(); }
+    bool empty() const { return projectiles.empty(); }
+    bool full() const { return projectiles.size() == slots.size(); }
+
+    Projectile& operator[](size_t index) { return projectiles[index]; }
+    const Projectile& operator[](size_t index) const { return projectiles[index]; }
+    std::vector<Projectile>::iterator begin() { return projectiles.begin(); }
+    std::vector<Projectile>::iterator end() { return projectiles.end(); }
+    std::vector<Projectile>::const_iterator begin() const { return projectiles.begin(); }
+    std::vector<Projectile>::const_iterator end() const { return projectiles.end(); }
+
+private:
+    struct Slot {
+        uint32_t dense = 0;
+        uint32_t generation = 0;
+        bool alive = false;
+    };
+    std::vector<Projectile> projectiles; // dense, reserved to the capacity
+    std::vector<uint32_t> denseSlots;    // slot of every projectile
+    std::vector<Slot> slots;             // one per unit of capacity
+    std::vector<uint32_t> freeSlots;
 };
@@ -0,0 +1,238 @@
+#include "Random.hpp"
+#include "CpuFeatures.hpp"
+#include <cmath>
+#include <random>
+#include <glm/gtc/constants.hpp>
+
+#if defined(SIMD_AVX2_KERNELS)
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RANDOM_SSE2
+#endif
+
+namespace {
+
+uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// the state of xoshiro must not be all zeros, splitmix64 output practically never is
+void seedState(uint64_t seed, uint32_t* state, size_t stride) {
+    uint64_t a = splitmix64(seed);
+    uint64_t b = splitmix64(seed);
+    state[0] = static_cast<uint32_t>(a);
+    state[stride] = static_cast<uint32_t>(a >> 32);
+    state[2 * stride] = static_cast<uint32_t>(b);
+    state[3 * stride] = static_cast<uint32_t>(b >> 32) | 1u;
+}
+
+inline uint32_t rotl(uint32_t x, int k) {
+    return (x << k) | (x >> (32 - k));
+}
+
+// upper 24 bits -> [0, 1)
+inline float toUnitFloat(uint32_t bits) {
+    return static_cast<float>(bits >> 8) * (1.0f / 16777216.0f);
+}
+
+uint64_t fnv1a(std::string_view text) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (char c : text) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+constexpr int LANES = RandomLanes::LANES;
+using LaneState = uint32_t[LANES]; // one word of the state of every lane
+
+#if defined(SIMD_AVX2_KERNELS)
+
+SIMD_TARGET_AVX2 size_t fillAvx2(LaneState* s, float* out, size_t count) {
+    size_t i = 0;
+    __m256i s0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(s[0]));
+    __m256i s1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(s[1]));
+    __m256i s2 = _mm256_load_si256(reinterpret_cast<const __m256i*>(s[2]));
+    __m256i s3 = _mm256_load_si256(reinterpret_cast<const __m256i*>(s[3]));
+    const __m256 scale = _mm256_set1_ps(1.0f / 16777216.0f);
+
+    for (; i + LANES <= count; i += LANES) {
+        __m256i result = _mm256_add_epi32(s0, s3);
+        __m256i t = _mm256_slli_epi32(s1, 9);
+        s2 = _mm256_xor_si256(s2, s0);
+        s3 = _mm256_xor_si256(s3, s1);
+        s1 = _mm256_xor_si256(s1, s2);
+        s0 = _mm256_xor_si256(s0, s3);
+        s2 = _mm256_xor_si256(s2, t);
+        s3 = _mm256_or_si256(_mm256_slli_epi32(s3, 11), _mm256_srli_epi32(s3, 21));
+
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(result, 8)), scale));
+    }
+
+    _mm256_store_si256(reinterpret_cast<__m256i*>(s[0]), s0);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(s[1]), s1);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(s[2]), s2);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(s[3]), s3);
+    return i;
+}
+
+#endif
+
+#if defined(RANDOM_SSE2)
+
+size_t fillSse2(LaneState* s, float* out, size_t count) {
+    const __m128 scale = _mm_set1_ps(1.0f / 16777216.0f);
+
+    // two halves of four lanes
+    for (int half = 0; half < 2; half++) {
+        __m128i s0 = _mm_load_si128(reinterpret_cast<const __m128i*>(&s[0][half * 4]));
+        __m128i s1 = _mm_load_si128(reinterpret_cast<const __m128i*>(&s[1][half * 4]));
+        __m128i s2 = _mm_load_si128(reinterpret_cast<const __m128i*>(&s[2][half * 4]));
+        __m128i s3 = _mm_load_si128(reinterpret_cast<const __m128i*>(&s[3][half * 4]));
+
+        for (size_t j = 0; j + LANES <= count; j += LANES) {
+            __m128i result = _mm_add_epi32(s0, s3);
+            __m128i t = _mm_slli_epi32(s1, 9);
+            s2 = _mm_xor_si128(s2, s0);
+            s3 = _mm_xor_si128(s3, s1);
+            s1 = _mm_xor_si128(s1, s2);
+            s0 = _mm_xor_si128(s0, s3);
+            s2 = _mm_xor_si128(s2, t);
+            s3 = _mm_or_si128(_mm_slli_epi32(s3, 11), _mm_srli_epi32(s3, 21));
+
+            _mm_storeu_ps(out + j + half * 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(result, 8)), scale));
+        }
+
+        _mm_store_si128(reinterpret_cast<__m128i*>(&s[0][half * 4]), s0);
+        _mm_store_si128(reinterpret_cast<__m128i*>(&s[1][half * 4]), s1);
+        _mm_store_si128(reinterpret_cast<__m128i*>(&s[2][half * 4]), s2);
+        _mm_store_si128(reinterpret_cast<__m128i*>(&s[3][half * 4]), s3);
+    }
+    return count - count % LANES;
+}
+
+#endif
+
+// whole steps of all lanes with the widest kernel the CPU has, returns the floats written
+// (both kernels give the same numbers, a seed reproduces a run on any CPU)
+size_t fillSimd(LaneState* s, float* out, size_t count) {
+#if defined(SIMD_AVX2_KERNELS)
+    if (cpuHasAvx2()) {
+        return fillAvx2(s, out, count);
+    }
+#endif
+#if defined(RANDOM_SSE2)
+    return fillSse2(s, out, count);
+#else
+    return 0;
+#endif
+}
+
+} // namespace
+
+RandomStream::RandomStream(uint64_t seed) {
+    seedState(seed, s, 1);
+}
+
+uint32_t RandomStream::next() {
+    const uint32_t result = s[0] + s[3];
+    const uint32_t t = s[1] << 9;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 11);
+
+    return result;
+}
+
+float RandomStream::nextFloat() {
+    return toUnitFloat(next());
+}
+
+float RandomStream::range(float min, float max) {
+    return min + nextFloat() * (max - min);
+}
+
+size_t RandomStream::index(size_t count) {
+    // multiply-shift, the bias is negligible for the small counts used here
+    return static_cast<size_t>((static_cast<uint64_t>(next()) * count) >> 32);
+}
+
+glm::vec3 RandomStream::onSphere(float radius) {
+    const float z = nextFloat() * 2.0f - 1.0f;
+    const float angle = nextFloat() * glm::two_pi<float>();
+    const float r = std::sqrt(1.0f - z * z);
+    return glm::vec3(r * std::cos(angle), r * std::sin(angle), z) * radius;
+}
+
+RandomLanes::RandomLanes(uint64_t seed) {
+    uint64_t state = seed;
+    for (int lane = 0; lane < LANES; lane++) {
+        seedState(splitmix64(state), &s[0][lane], LANES);
+    }
+}
+
+void RandomLanes::fill(float* out, size_t count) {
+    size_t i = fillSimd(s, out, count);
+
+    // scalar steps of all lanes, also for the tail, so the lanes stay in lockstep
+    while (i < count) {
+        for (int lane = 0; lane < LANES; lane++) {
+            const uint32_t result = s[0][lane] + s[3][lane];
+            const uint32_t t = s[1][lane] << 9;
+            s[2][lane] ^= s[0][lane];
+            s[3][lane] ^= s[1][lane];
+            s[1][lane] ^= s[2][lane];
+            s[0][lane] ^= s[3][lane];
+            s[2][lane] ^= t;
+            s[3][lane] = rotl(s[3][lane], 11);
+
+            if (i + lane < count) {
+                out[i + lane] = toUnitFloat(result);
+            }
+        }
+        i += LANES;
+    }
+}
+
+RandomService& RandomService::instance() {
+    static RandomService service;
+    return service;
+}
+
+RandomService::RandomService() {
+    setMasterSeed(0);
+}
+
+void RandomService::setMasterSeed(uint64_t seed) {
+    if (seed == 0) {
+        std::random_device device;
+        seed = (static_cast<uint64_t>(device()) << 32) | device();
+    }
+    masterSeed = seed;
+}
+
+uint64_t RandomService::seedFor(uint64_t masterSeed, std::string_view subsystem) {
+    uint64_t state = masterSeed ^ fnv1a(subsystem);
+    return splitmix64(state);
+}
+
+RandomStream RandomService::stream(std::string_view subsystem) const {
+    return RandomStream(seedFor(masterSeed, subsystem));
+}
+
+RandomLanes RandomService::lanes(std::string_view subsystem) const {
+    return RandomLanes(seedFor(masterSeed, subsystem));
+}
+
+RandomStream RandomService::streamFor(uint64_t masterSeed, std::string_view subsystem) {
+    return RandomStream(seedFor(masterSeed, subsystem));
+}
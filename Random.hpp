@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+#include <vector>
+#include <glm/glm.hpp>
+
+// One stream of xoshiro128+ (Blackman & Vigna), floats are made from the upper 24 bits.
+// Also a UniformRandomBitGenerator, so it works with <random> distributions and std::shuffle.
+class RandomStream {
+public:
+    using result_type = uint32_t;
+
+    explicit RandomStream(uint64_t seed = 0);
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT32_MAX; }
+    result_type operator()() { return next(); }
+
+    uint32_t next();
+    float nextFloat();                  // [0, 1)
+    float range(float min, float max);  // [min, max)
+    size_t index(size_t count);         // [0, count)
+    glm::vec3 onSphere(float radius);   // uniform on the sphere surface
+
+private:
+    uint32_t s[4];
+};
+
+// Eight xoshiro128+ streams advanced in lockstep, fill() produces floats in bulk
+// with AVX2 (SSE2 on CPUs without it) for the particle kernels
+class RandomLanes {
+public:
+    static constexpr int LANES = 8;
+
+    explicit RandomLanes(uint64_t seed = 0);
+
+    void fill(float* out, size_t count); // [0, 1)
+    void fill(std::vector<float>& out, size_t count) {
+        out.resize(count);
+        fill(out.data(), count);
+    }
+
+private:
+    alignas(32) uint32_t s[4][LANES];
+};
+
+// Source of the random streams of all subsystems.
+//
+// Every subsystem derives its own stream from the master seed and its name, so the
+// streams are independent of each other and of the order in which they are created,
+// and a run can be reproduced from the seed ("random_seed" in app_settings.json).
+// Streams copy their state, the master seed must be set before they are created.
+class RandomService {
+public:
+    static RandomService& instance();
+
+    // 0 = a new nondeterministic seed
+    void setMasterSeed(uint64_t seed);
+    uint64_t getMasterSeed() const { return masterSeed; }
+
+    RandomStream stream(std::string_view subsystem) const;
+    RandomLanes lanes(std::string_view subsystem) const;
+    // the same derivation from another master seed, for simulations with seeds of their own
+    static RandomStream streamFor(uint64_t masterSeed, std::string_view subsystem);
+
+private:
+    RandomService();
+    static uint64_t seedFor(uint64_t masterSeed, std::string_view subsystem);
+
+    uint64_t masterSeed;
+};
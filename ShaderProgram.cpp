@@ -22,6 +22,13 @@ ShaderProgram::ShaderProgram(const std::filesystem::path &VS_file, const std::fi
 	ID = link_shader(shader_ids);
 }
 
+ShaderProgram::ShaderProgram(const std::filesystem::path &CS_file)
+{
+	std::vector<GLuint> shader_ids;
+	shader_ids.push_back(compile_shader(CS_file, GL_COMPUTE_SHADER));
+	ID = link_shader(shader_ids);
+}
+
 void ShaderProgram::setUniform(const std::string &name, const float val)
 {
 	auto loc = glGetUniformLocation(ID, name.c_str());
@@ -51,6 +58,17 @@ void ShaderProgram::setUniform(const std::string &name, const int val)
 	glUniform1i(loc, val);
 }
 
+void ShaderProgram::setUniform(const std::string &name, const glm::vec2 val)
+{
+	auto loc = glGetUniformLocation(ID, name.c_str());
+	if (loc == -1)
+	{
+		std::cerr << "no uniform with name:" << name << '\n';
+		return;
+	}
+	glUniform2fv(loc, 1, glm::value_ptr(val));
+}
+
 void ShaderProgram::setUniform(const std::string &name, const glm::vec3 val)
 {
 	auto loc = glGetUniformLocation(ID, name.c_str());
@@ -14,6 +14,7 @@ public:
 	// you can add more constructors for pipeline with GS, TS etc.
 	ShaderProgram(void) = default;																														 // does nothing
 	ShaderProgram(const std::filesystem::path &VS_file, const std::filesystem::path &FS_file); // TODO: implementation of load, compile, and link shader
+	explicit ShaderProgram(const std::filesystem::path &CS_file);															 // compute shader program
 
 	void activate(void) { glUseProgram(ID); };	// activate shader
 	void deactivate(void) { glUseProgram(0); }; // deactivate current shader program (i.e. activate shader no. 0)
@@ -31,6 +32,7 @@ public:
 	// https://docs.gl/gl4/glUniform
 	void setUniform(const std::string &name, const float val);
 	void setUniform(const std::string &name, const int val); // TODO: implement
+	void setUniform(const std::string &name, const glm::vec2 val);
 	void setUniform(const std::string &name, const glm::vec3 val);
 	void setUniform(const std::string &name, const glm::vec4 val); // TODO: implement
 	void setUniform(const std::string &name, const glm::mat3 val);
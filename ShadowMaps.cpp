@@ -0,0 +1,419 @@
+#include "ShadowMaps.hpp"
+#include "Model.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+#include <string>
+#include <cmath>
+
+namespace
+{
+    int positiveMod(int value, int modulus)
+    {
+        int r = value % modulus;
+        return r < 0 ? r + modulus : r;
+    }
+
+    bool rectsOverlap(const glm::vec4 &a, const glm::vec4 &b)
+    {
+        return a.x < b.z && a.z > b.x && a.y < b.w && a.w > b.y;
+    }
+}
+
+CascadedShadowMaps::CascadedShadowMaps(int resolution)
+    : resolution(resolution)
+{
+    depthShader = ShaderProgram("resources/shaders/shadow_depth.vert", "resources/shaders/shadow_depth.frag");
+
+    // near cascade follows every frame, far ones are cheaper to keep slightly stale
+    const float extents[CASCADE_COUNT] = {40.0f, 120.0f, 360.0f};
+    const int intervals[CASCADE_COUNT] = {1, 2, 4};
+    const float sunThresholdsDeg[CASCADE_COUNT] = {0.5f, 1.5f, 3.0f};
+
+    for (int i = 0; i < CASCADE_COUNT; i++)
+    {
+        cascades[i].extent = extents[i];
+        cascades[i].updateInterval = intervals[i];
+        cascades[i].sunCosThreshold = glm::cos(glm::radians(sunThresholdsDeg[i]));
+        glCreateQueries(GL_TIME_ELAPSED, QUERY_RING, cascades[i].timerQueries);
+    }
+
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &depthTexture);
+    glTextureStorage3D(depthTexture, 1, GL_DEPTH_COMPONENT32F, resolution, resolution, CASCADE_COUNT);
+    glTextureParameteri(depthTexture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(depthTexture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // the cascades are toroidal buffers, sampling has to wrap around
+    glTextureParameteri(depthTexture, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTextureParameteri(depthTexture, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTextureParameteri(depthTexture, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTextureParameteri(depthTexture, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+    glCreateFramebuffers(1, &framebuffer);
+    glNamedFramebufferDrawBuffer(framebuffer, GL_NONE);
+    glNamedFramebufferReadBuffer(framebuffer, GL_NONE);
+
+    std::cout << "Shadow maps: " << CASCADE_COUNT << " cascades, " << resolution << "x" << resolution << std::endl;
+}
+
+CascadedShadowMaps::~CascadedShadowMaps()
+{
+    for (auto &cascade : cascades)
+    {
+        glDeleteQueries(QUERY_RING, cascade.timerQueries);
+    }
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteTextures(1, &depthTexture);
+    depthShader.clear();
+}
+
+void CascadedShadowMaps::invalidate()
+{
+    for (auto &cascade : cascades)
+    {
+        cascade.valid = false;
+        cascade.dirtyRects.clear();
+    }
+}
+
+void CascadedShadowMaps::update(const glm::vec3 &cameraPos, const glm::vec3 &sunDirection, const glm::vec3 &worldOffset,
+                                const std::vector<ShadowCaster> &casters)
+{
+    lastWorldOffset = worldOffset;
+    if (!enabled || depthTexture == 0)
+        return;
+
+    const glm::vec3 sun = glm::normalize(sunDirection);
+    const glm::vec3 roadCamera = cameraPos - worldOffset;
+
+    // Spawned and despawned casters dirty the region they cover
+    currentCasters.clear();
+    for (const auto &caster : casters)
+    {
+        CasterBounds bounds = worldBounds(caster);
+        bounds.min -= worldOffset;
+        bounds.max -= worldOffset;
+        currentCasters[caster.id] = bounds;
+        if (knownCasters.find(caster.id) == knownCasters.end())
+        {
+            markDirty(bounds);
+        }
+    }
+    for (const auto &known : knownCasters)
+    {
+        if (currentCasters.find(known.first) == currentCasters.end())
+        {
+            markDirty(known.second);
+        }
+    }
+    knownCasters.swap(currentCasters);
+
+    bool passActive = false;
+    bool fullBudgetUsed = false;
+
+    for (int i = 0; i < CASCADE_COUNT; i++)
+    {
+        Cascade &cascade = cascades[i];
+        collectQueryResults(cascade);
+        cascade.framesSinceUpdate++;
+
+        const bool sunMoved = glm::dot(cascade.sunDirection, sun) < cascade.sunCosThreshold;
+        const bool drifted = glm::length(roadCamera - cascade.anchor) > depthRange * 0.5f;
+
+        bool full = false;
+        if (!cascade.valid || ((sunMoved || drifted) && !fullBudgetUsed))
+        {
+            rebase(cascade, roadCamera, sun);
+            full = true;
+        }
+        else
+        {
+            if (cascade.framesSinceUpdate < cascade.updateInterval)
+                continue;
+
+            // Scroll the window, only the newly exposed strips need to be rendered
+            glm::ivec2 window = computeWindow(cascade, roadCamera);
+            glm::ivec2 delta = window - cascade.window;
+            if (std::abs(delta.x) >= resolution || std::abs(delta.y) >= resolution)
+            {
+                full = true;
+            }
+            else
+            {
+                if (delta.x > 0)
+                    cascade.dirtyRects.push_back(glm::ivec4(cascade.window.x + resolution, window.y, window.x + resolution, window.y + resolution));
+                else if (delta.x < 0)
+                    cascade.dirtyRects.push_back(glm::ivec4(window.x, window.y, cascade.window.x, window.y + resolution));
+
+                if (delta.y > 0)
+                    cascade.dirtyRects.push_back(glm::ivec4(window.x, cascade.window.y + resolution, window.x + resolution, window.y + resolution));
+                else if (delta.y < 0)
+                    cascade.dirtyRects.push_back(glm::ivec4(window.x, window.y, window.x + resolution, cascade.window.y));
+            }
+            cascade.window = window;
+        }
+
+        if (!full && cascade.dirtyRects.empty())
+        {
+            cascade.framesSinceUpdate = 0;
+            cascade.stats.renderedFraction = 0.0f;
+            cascade.stats.casterDraws = 0;
+            continue;
+        }
+
+        if (!passActive)
+        {
+            glGetIntegerv(GL_VIEWPORT, savedViewport);
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+            glEnable(GL_DEPTH_TEST);
+            glDepthMask(GL_TRUE);
+            glEnable(GL_SCISSOR_TEST);
+            glEnable(GL_POLYGON_OFFSET_FILL);
+            glPolygonOffset(2.0f, 4.0f);
+            depthShader.activate();
+            passActive = true;
+        }
+
+        renderCascade(i, worldOffset, casters, full);
+        if (full)
+            fullBudgetUsed = true;
+    }
+
+    if (passActive)
+    {
+        depthShader.deactivate();
+        glDisable(GL_POLYGON_OFFSET_FILL);
+        glDisable(GL_SCISSOR_TEST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+    }
+}
+
+void CascadedShadowMaps::rebase(Cascade &cascade, const glm::vec3 &roadCamera, const glm::vec3 &sunDirection)
+{
+    cascade.anchor = roadCamera;
+    cascade.sunDirection = sunDirection;
+
+    glm::vec3 up = std::abs(sunDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    cascade.view = glm::lookAt(cascade.anchor, cascade.anchor + sunDirection, up);
+    cascade.window = computeWindow(cascade, roadCamera);
+    cascade.dirtyRects.clear();
+    cascade.valid = true;
+}
+
+glm::ivec2 CascadedShadowMaps::computeWindow(const Cascade &cascade, const glm::vec3 &roadCamera) const
+{
+    // Snap the window to whole texels so that scrolling never resamples the cached depth
+    const float texel = cascade.extent / resolution;
+    glm::vec4 lightPos = cascade.view * glm::vec4(roadCamera, 1.0f);
+    glm::ivec2 center(static_cast<int>(std::floor(lightPos.x / texel)), static_cast<int>(std::floor(lightPos.y / texel)));
+    return center - glm::ivec2(resolution / 2);
+}
+
+void CascadedShadowMaps::renderCascade(int index, const glm::vec3 &worldOffset, const std::vector<ShadowCaster> &casters, bool full)
+{
+    Cascade &cascade = cascades[index];
+    const glm::mat4 worldToLight = cascade.view * glm::translate(glm::mat4(1.0f), -worldOffset);
+
+    // Light space rectangles of the casters, used to skip casters outside the rendered strips
+    casterRects.clear();
+    for (const auto &caster : casters)
+    {
+        glm::vec2 rectMin, rectMax;
+        lightSpaceRect(worldToLight, worldBounds(caster), rectMin, rectMax);
+        casterRects.push_back(glm::vec4(rectMin, rectMax));
+    }
+
+    // Time the update, skip timing if the query slot has not been read back yet
+    const int queryIndex = cascade.queryIndex;
+    const bool timed = !cascade.queryPending[queryIndex];
+    if (timed)
+    {
+        glBeginQuery(GL_TIME_ELAPSED, cascade.timerQueries[queryIndex]);
+    }
+
+    glNamedFramebufferTextureLayer(framebuffer, GL_DEPTH_ATTACHMENT, depthTexture, 0, index);
+
+    const glm::ivec4 windowRect(cascade.window, cascade.window + glm::ivec2(resolution));
+    if (full)
+    {
+        cascade.dirtyRects.clear();
+        cascade.dirtyRects.push_back(windowRect);
+    }
+
+    cascade.stats.casterDraws = 0;
+    long long texels = 0;
+    for (const auto &dirty : cascade.dirtyRects)
+    {
+        glm::ivec4 rect(glm::max(glm::ivec2(dirty.x, dirty.y), glm::ivec2(windowRect.x, windowRect.y)),
+                        glm::min(glm::ivec2(dirty.z, dirty.w), glm::ivec2(windowRect.z, windowRect.w)));
+        if (rect.x >= rect.z || rect.y >= rect.w)
+            continue;
+        renderRect(cascade, rect, worldToLight, casters);
+        texels += static_cast<long long>(rect.z - rect.x) * (rect.w - rect.y);
+    }
+    cascade.dirtyRects.clear();
+
+    if (timed)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        cascade.queryPending[queryIndex] = true;
+        cascade.queryFull[queryIndex] = full;
+        cascade.queryIndex = (queryIndex + 1) % QUERY_RING;
+    }
+
+    cascade.stats.renderedFraction = static_cast<float>(static_cast<double>(texels) / (static_cast<double>(resolution) * resolution));
+    if (full)
+        cascade.stats.fullRedraws++;
+    else
+        cascade.stats.partialUpdates++;
+    cascade.framesSinceUpdate = 0;
+}
+
+void CascadedShadowMaps::renderRect(Cascade &cascade, const glm::ivec4 &rect, const glm::mat4 &worldToLight,
+                                    const std::vector<ShadowCaster> &casters)
+{
+    const float texel = cascade.extent / resolution;
+
+    // A rect can cross the edge of the toroidal texture, split it into up to 2x2 parts
+    int xParts[2][2], yParts[2][2];
+    auto split = [this](int a0, int a1, int parts[2][2]) -> int
+    {
+        int start = positiveMod(a0, resolution);
+        if (start + (a1 - a0) <= resolution)
+        {
+            parts[0][0] = a0;
+            parts[0][1] = a1;
+            return 1;
+        }
+        int first = resolution - start;
+        parts[0][0] = a0;
+        parts[0][1] = a0 + first;
+        parts[1][0] = a0 + first;
+        parts[1][1] = a1;
+        return 2;
+    };
+    const int xCount = split(rect.x, rect.z, xParts);
+    const int yCount = split(rect.y, rect.w, yParts);
+
+    for (int xi = 0; xi < xCount; xi++)
+    {
+        for (int yi = 0; yi < yCount; yi++)
+        {
+            const int x0 = xParts[xi][0], x1 = xParts[xi][1];
+            const int y0 = yParts[yi][0], y1 = yParts[yi][1];
+            const int vx = positiveMod(x0, resolution);
+            const int vy = positiveMod(y0, resolution);
+
+            glViewport(vx, vy, x1 - x0, y1 - y0);
+            glScissor(vx, vy, x1 - x0, y1 - y0);
+            glClear(GL_DEPTH_BUFFER_BIT);
+
+            glm::mat4 projection = glm::ortho(x0 * texel, x1 * texel, y0 * texel, y1 * texel, -depthRange, depthRange);
+            depthShader.setUniform("uLightVP", projection * worldToLight);
+
+            const glm::vec4 partRect(x0 * texel, y0 * texel, x1 * texel, y1 * texel);
+            for (size_t i = 0; i < casters.size(); i++)
+            {
+                if (!rectsOverlap(partRect, casterRects[i]))
+                    continue;
+                casters[i].model->draw_geometry(depthShader, casters[i].modelMatrix);
+                cascade.stats.casterDraws++;
+            }
+        }
+    }
+}
+
+void CascadedShadowMaps::collectQueryResults(Cascade &cascade)
+{
+    for (int i = 0; i < QUERY_RING; i++)
+    {
+        if (!cascade.queryPending[i])
+            continue;
+
+        GLint available = 0;
+        glGetQueryObjectiv(cascade.timerQueries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            continue;
+
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(cascade.timerQueries[i], GL_QUERY_RESULT, &nanoseconds);
+        cascade.queryPending[i] = false;
+
+        float ms = static_cast<float>(nanoseconds) / 1.0e6f;
+        cascade.stats.gpuTimeMs = ms;
+        if (cascade.queryFull[i])
+            cascade.stats.fullRedrawGpuTimeMs = ms;
+    }
+}
+
+void CascadedShadowMaps::markDirty(const CasterBounds &roadBounds)
+{
+    for (auto &cascade : cascades)
+    {
+        if (!cascade.valid)
+            continue;
+
+        const float texel = cascade.extent / resolution;
+        glm::vec2 rectMin, rectMax;
+        lightSpaceRect(cascade.view, roadBounds, rectMin, rectMax);
+        cascade.dirtyRects.push_back(glm::ivec4(
+            static_cast<int>(std::floor(rectMin.x / texel)) - 1, static_cast<int>(std::floor(rectMin.y / texel)) - 1,
+            static_cast<int>(std::ceil(rectMax.x / texel)) + 1, static_cast<int>(std::ceil(rectMax.y / texel)) + 1));
+    }
+}
+
+CascadedShadowMaps::CasterBounds CascadedShadowMaps::worldBounds(const ShadowCaster &caster) const
+{
+    const glm::mat4 m = caster.model->local_model_matrix * caster.modelMatrix;
+    const glm::vec3 &lo = caster.model->bounds_min;
+    const glm::vec3 &hi = caster.model->bounds_max;
+
+    CasterBounds bounds{glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX)};
+    for (int corner = 0; corner < 8; corner++)
+    {
+        glm::vec3 p((corner & 1) ? hi.x : lo.x, (corner & 2) ? hi.y : lo.y, (corner & 4) ? hi.z : lo.z);
+        glm::vec3 w = glm::vec3(m * glm::vec4(p, 1.0f));
+        bounds.min = glm::min(bounds.min, w);
+        bounds.max = glm::max(bounds.max, w);
+    }
+    return bounds;
+}
+
+void CascadedShadowMaps::lightSpaceRect(const glm::mat4 &toLight, const CasterBounds &bounds,
+                                        glm::vec2 &outMin, glm::vec2 &outMax) const
+{
+    outMin = glm::vec2(FLT_MAX);
+    outMax = glm::vec2(-FLT_MAX);
+    for (int corner = 0; corner < 8; corner++)
+    {
+        glm::vec3 p((corner & 1) ? bounds.max.x : bounds.min.x,
+                    (corner & 2) ? bounds.max.y : bounds.min.y,
+                    (corner & 4) ? bounds.max.z : bounds.min.z);
+        glm::vec4 l = toLight * glm::vec4(p, 1.0f);
+        outMin = glm::min(outMin, glm::vec2(l.x, l.y));
+        outMax = glm::max(outMax, glm::vec2(l.x, l.y));
+    }
+}
+
+void CascadedShadowMaps::setupShadowUniforms(ShaderProgram &shader) const
+{
+    static const std::string matrixNames[CASCADE_COUNT] = {"uShadowMatrices[0]", "uShadowMatrices[1]", "uShadowMatrices[2]"};
+    static const std::string windowNames[CASCADE_COUNT] = {"uShadowWindows[0]", "uShadowWindows[1]", "uShadowWindows[2]"};
+
+    shader.activate();
+
+    shader.setUniform("uShadowMap", TEXTURE_UNIT);
+    shader.setUniform("uShadowsEnabled", enabled ? 1 : 0);
+    glBindTextureUnit(TEXTURE_UNIT, depthTexture);
+
+    const glm::mat4 worldToRoad = glm::translate(glm::mat4(1.0f), -lastWorldOffset);
+    for (int i = 0; i < CASCADE_COUNT; i++)
+    {
+        const Cascade &cascade = cascades[i];
+        const float texel = cascade.extent / resolution;
+        shader.setUniform(matrixNames[i], cascade.view * worldToRoad);
+        shader.setUniform(windowNames[i], glm::vec4(cascade.window.x * texel, cascade.window.y * texel, cascade.extent,
+                                                    cascade.valid ? depthRange : 0.0f));
+    }
+
+    shader.deactivate();
+}
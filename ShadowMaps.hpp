@@ -0,0 +1,120 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "ShaderProgram.hpp"
+
+class Model;
+
+// Static geometry that casts a shadow of the sun
+struct ShadowCaster
+{
+    int id;                // stable id (e.g. house id), used to detect spawn/despawn
+    Model *model;
+    glm::mat4 modelMatrix; // world space transformation
+};
+
+struct ShadowCascadeStats
+{
+    float gpuTimeMs = 0.0f;         // GPU time of the last update (0 if skipped)
+    float fullRedrawGpuTimeMs = 0.0f; // GPU time of the last full re-render, for comparison
+    float renderedFraction = 0.0f;  // fraction of cascade texels re-rendered in the last update
+    int casterDraws = 0;            // caster draw calls in the last update
+    int fullRedraws = 0;            // total number of full re-renders
+    int partialUpdates = 0;         // total number of incremental (scroll) updates
+};
+
+// Cascaded shadow maps for the sun.
+//
+// Every cascade is a fixed size, texel snapped window in light space that is centered
+// on the camera. The depth texture is addressed toroidally (GL_REPEAT over absolute
+// light space texel coordinates), so when the window scrolls along the road only the
+// newly exposed strips are cleared and re-rendered. A cascade is fully re-rendered only
+// when the sun moved past its threshold or the window jumped too far. Far cascades
+// update at a reduced rate and at most one full re-render happens per frame.
+//
+// Everything is kept in "road space" (world position minus the accumulated world
+// scroll), in which houses do not move even though the game moves the world towards
+// the camera.
+class CascadedShadowMaps
+{
+public:
+    static constexpr int CASCADE_COUNT = 3;
+
+    CascadedShadowMaps(int resolution = 2048);
+    ~CascadedShadowMaps();
+
+    CascadedShadowMaps(const CascadedShadowMaps &) = delete;
+    CascadedShadowMaps &operator=(const CascadedShadowMaps &) = delete;
+
+    void update(const glm::vec3 &cameraPos, const glm::vec3 &sunDirection, const glm::vec3 &worldOffset,
+                const std::vector<ShadowCaster> &casters);
+    void setupShadowUniforms(ShaderProgram &shader) const;
+
+    void invalidate(); // next update re-renders all cascades
+    void setEnabled(bool enabled) { this->enabled = enabled; }
+    bool isEnabled() const { return enabled; }
+
+    const ShadowCascadeStats &getStats(int cascade) const { return cascades[cascade].stats; }
+    float getExtent(int cascade) const { return cascades[cascade].extent; }
+
+    static constexpr int TEXTURE_UNIT = 5;
+
+private:
+    static constexpr int QUERY_RING = 4;
+
+    struct Cascade
+    {
+        float extent = 0.0f;        // world size of the window
+        int updateInterval = 1;     // update every N frames
+        float sunCosThreshold = 1.0f;
+
+        bool valid = false;
+        glm::vec3 anchor{0.0f};     // road space point the light view is centered on
+        glm::vec3 sunDirection{0.0f, -1.0f, 0.0f};
+        glm::mat4 view{1.0f};       // road space -> light space
+        glm::ivec2 window{0};       // light space texel coordinates of the window minimum
+        std::vector<glm::ivec4> dirtyRects; // light space texel rects (x0, y0, x1, y1) waiting for re-render
+        int framesSinceUpdate = 0;
+
+        GLuint timerQueries[QUERY_RING] = {};
+        bool queryPending[QUERY_RING] = {};
+        bool queryFull[QUERY_RING] = {};
+        int queryIndex = 0;
+
+        ShadowCascadeStats stats;
+    };
+
+    struct CasterBounds
+    {
+        glm::vec3 min;
+        glm::vec3 max;
+    };
+
+    void rebase(Cascade &cascade, const glm::vec3 &roadCamera, const glm::vec3 &sunDirection);
+    glm::ivec2 computeWindow(const Cascade &cascade, const glm::vec3 &roadCamera) const;
+    void renderCascade(int index, const glm::vec3 &worldOffset, const std::vector<ShadowCaster> &casters, bool full);
+    void renderRect(Cascade &cascade, const glm::ivec4 &rect, const glm::mat4 &worldToLight,
+                    const std::vector<ShadowCaster> &casters);
+    void collectQueryResults(Cascade &cascade);
+    void markDirty(const CasterBounds &roadBounds);
+    CasterBounds worldBounds(const ShadowCaster &caster) const;
+    void lightSpaceRect(const glm::mat4 &toLight, const CasterBounds &bounds, glm::vec2 &outMin, glm::vec2 &outMax) const;
+
+    Cascade cascades[CASCADE_COUNT];
+    std::unordered_map<int, CasterBounds> knownCasters; // road space bounds of casters present last frame
+    std::unordered_map<int, CasterBounds> currentCasters;
+    std::vector<glm::vec4> casterRects;                 // scratch: light space rects of the casters
+    glm::vec3 lastWorldOffset{0.0f};
+    GLint savedViewport[4] = {};
+
+    ShaderProgram depthShader;
+    GLuint depthTexture = 0;
+    GLuint framebuffer = 0;
+    int resolution;
+    float depthRange = 400.0f; // half depth of the light frustum around the anchor
+    bool enabled = true;
+};
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+// Nearest-rank percentile (p in [0, 1]) of sorted values, 0 for none
+inline double percentile(const std::vector<double>& values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    const size_t index = static_cast<size_t>(std::ceil(p * values.size()));
+    return values[std::clamp<size_t>(index, 1, values.size()) - 1];
+}
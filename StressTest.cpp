@@ -0,0 +1,277 @@
+#include "StressTest.hpp"
+#include "lighting.hpp"
+#include "camera.hpp"
+#include "JsonRead.hpp"
+#include "Stats.hpp"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+constexpr float MIN_HOUSE_SPACING = 9.0f; // the houses are 8 m deep
+
+const StressSubsystem ISOLATED[] = {
+    StressSubsystem::HOUSES,
+    StressSubsystem::CUPCAKES,
+    StressSubsystem::FIRE,
+    StressSubsystem::PARTICLES,
+    StressSubsystem::LIGHTS,
+};
+
+StressLoad scaleLoad(const StressLoad& base, StressSubsystem subsystem, float scale) {
+    StressLoad load = base;
+    auto scaled = [&](StressSubsystem which) { return subsystem == StressSubsystem::ALL || subsystem == which; };
+
+    if (scaled(StressSubsystem::HOUSES)) {
+        // houses per metre of road grow with the scale, half by more rows and half by a denser street
+        const float split = std::sqrt(scale);
+        load.houseRows = std::max(1, static_cast<int>(std::lround(base.houseRows * split)));
+        load.houseSpacing = std::max(MIN_HOUSE_SPACING, base.houseSpacing / split);
+    }
+    if (scaled(StressSubsystem::CUPCAKES)) {
+        load.flyingCupcakes = static_cast<int>(std::lround(base.flyingCupcakes * scale));
+    }
+    if (scaled(StressSubsystem::FIRE)) {
+        load.fireRate = base.fireRate * scale;
+    }
+    if (scaled(StressSubsystem::PARTICLES)) {
+        load.particles = static_cast<size_t>(std::llround(base.particles * static_cast<double>(scale)));
+    }
+    if (scaled(StressSubsystem::LIGHTS)) {
+        load.pointLights = static_cast<int>(std::lround(base.pointLights * scale));
+    }
+    // the phong shader has a fixed array of point lights
+    load.pointLights = std::clamp(load.pointLights, 0, LightingSystem::MAX_POINT_LIGHTS);
+    return load;
+}
+
+}
+
+const char* stressSubsystemName(StressSubsystem subsystem) {
+    switch (subsystem) {
+    case StressSubsystem::HOUSES: return "houses";
+    case StressSubsystem::CUPCAKES: return "cupcakes";
+    case StressSubsystem::FIRE: return "fire";
+    case StressSubsystem::PARTICLES: return "particles";
+    case StressSubsystem::LIGHTS: return "lights";
+    default: return "all";
+    }
+}
+
+StressSettings StressSettings::parse(const nlohmann::json& object) {
+    StressSettings settings;
+    if (!object.is_object()) {
+        return settings;
+    }
+    readJson(object, "enabled", settings.enabled);
+    readJson(object, "isolate", settings.isolate);
+    readJson(object, "warmup_seconds", settings.warmupSeconds);
+    readJson(object, "measure_seconds", settings.measureSeconds);
+    if (object.contains("scales") && object["scales"].is_array()) {
+        settings.scales.clear();
+        for (const nlohmann::json& scale : object["scales"]) {
+            if (scale.is_number() && scale.get<float>() > 0.0f) {
+                settings.scales.push_back(scale.get<float>());
+            }
+        }
+    }
+    if (object.contains("output") && object["output"].is_string()) {
+        settings.output = object["output"].get<std::string>();
+    }
+    if (object.contains("base") && object["base"].is_object()) {
+        const nlohmann::json& base = object["base"];
+        readJson(base, "house_rows", settings.base.houseRows);
+        readJson(base, "house_spacing", settings.base.houseSpacing);
+        readJson(base, "flying_cupcakes", settings.base.flyingCupcakes);
+        readJson(base, "fire_rate", settings.base.fireRate);
+        readJson(base, "particles", settings.base.particles);
+        readJson(base, "point_lights", settings.base.pointLights);
+    }
+    settings.warmupSeconds = std::max(0.0, settings.warmupSeconds);
+    settings.measureSeconds = std::max(0.1, settings.measureSeconds);
+    return settings;
+}
+
+StressTest::StressTest(const StressSettings& settings) : settings(settings) {
+    for (float scale : settings.scales) {
+        steps.push_back({ StressSubsystem::ALL, scale, scaleLoad(settings.base, StressSubsystem::ALL, scale) });
+    }
+    if (settings.isolate) {
+        for (StressSubsystem subsystem : ISOLATED) {
+            for (float scale : settings.scales) {
+                steps.push_back({ subsystem, scale, scaleLoad(settings.base, subsystem, scale) });
+            }
+        }
+    }
+}
+
+size_t StressTest::getMaxParticles() const {
+    size_t particles = settings.base.particles;
+    for (const StressStep& step : steps) {
+        particles = std::max(particles, step.load.particles);
+    }
+    return particles;
+}
+
+int StressTest::getMaxHouseRows() const {
+    int rows = settings.base.houseRows;
+    for (const StressStep& step : steps) {
+        rows = std::max(rows, step.load.houseRows);
+    }
+    return rows;
+}
+
+bool StressTest::advance(double realDelta) {
+    if (!isRunning()) {
+        return false;
+    }
+    if (!started) {
+        started = true;
+        return true;
+    }
+
+    stepTime += realDelta;
+    if (stepTime < settings.warmupSeconds + settings.measureSeconds) {
+        return false;
+    }
+    finishStep();
+    current++;
+    stepTime = 0.0;
+    shotAccumulator = 0.0f;
+    return isRunning();
+}
+
+void StressTest::record(const StressFrame& frame) {
+    if (isMeasuring()) {
+        frames.push_back(frame);
+    }
+}
+
+void StressTest::finishStep() {
+    StressResult result;
+    result.step = steps[current];
+    result.frames = frames.size();
+
+    std::vector<double> frameMs;
+    frameMs.reserve(frames.size());
+    for (const StressFrame& frame : frames) {
+        frameMs.push_back(frame.frameMs);
+        result.averageMs += frame.frameMs;
+        result.simulationMs += frame.simulationMs;
+        result.physicsMs += frame.physicsMs;
+        result.particleUpdateMs += frame.particleUpdateMs;
+        result.particleDrawMs += frame.particleDrawMs;
+        result.maxHouses = std::max(result.maxHouses, frame.houses);
+        result.maxProjectiles = std::max(result.maxProjectiles, frame.projectiles);
+        result.maxParticles = std::max(result.maxParticles, frame.particles);
+    }
+    if (!frames.empty()) {
+        const double n = static_cast<double>(frames.size());
+        result.averageMs /= n;
+        result.simulationMs /= n;
+        result.physicsMs /= n;
+        result.particleUpdateMs /= n;
+        result.particleDrawMs /= n;
+
+        std::sort(frameMs.begin(), frameMs.end());
+        result.p95Ms = percentile(frameMs, 0.95);
+        result.p99Ms = percentile(frameMs, 0.99);
+        result.maxMs = frameMs.back();
+    }
+    results.push_back(result);
+    frames.clear();
+
+    std::cout << std::fixed << std::setprecision(2) << "[stress] " << stressSubsystemName(result.step.subsystem) << " x"
+              << result.step.scale << ": prumer " << result.averageMs << " ms, p95 " << result.p95Ms << " ms, p99 "
+              << result.p99Ms << " ms (" << result.frames << " snimku)" << std::defaultfloat << std::endl;
+}
+
+void StressTest::updateCamera(Camera& camera) const {
+    const float t = static_cast<float>(stepTime);
+    camera.Position.x = 3.0f * std::sin(t * 0.4f);
+    camera.Yaw = -90.0f + 35.0f * std::sin(t * 0.3f);
+    camera.Pitch = 2.0f + 4.0f * std::sin(t * 0.5f);
+    camera.ProcessMouseMovement(0.0f, 0.0f); // recomputes Front and Right from the angles
+}
+
+int StressTest::takeShots(float delta) {
+    if (!isRunning()) {
+        return 0;
+    }
+    shotAccumulator += steps[current].load.fireRate * delta;
+    const int shots = static_cast<int>(shotAccumulator);
+    shotAccumulator -= static_cast<float>(shots);
+    return shots;
+}
+
+void StressTest::print() const {
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "=== Zatezovy test ===" << std::endl;
+    for (const StressResult& result : results) {
+        const StressLoad& load = result.step.load;
+        std::cout << "  " << std::left << std::setw(10) << stressSubsystemName(result.step.subsystem) << std::right
+                  << " x" << std::setw(6) << result.step.scale << ": prumer " << result.averageMs << " ms, p95 "
+                  << result.p95Ms << " ms, p99 " << result.p99Ms << " ms | simulace " << result.simulationMs
+                  << " ms, fyzika " << result.physicsMs << " ms, castice " << result.particleUpdateMs << " + "
+                  << result.particleDrawMs << " ms | domy " << result.maxHouses << " (" << load.houseRows
+                  << " rad), cupcaky " << load.flyingCupcakes << ", strely " << result.maxProjectiles << ", castice "
+                  << result.maxParticles << ", svetla " << load.pointLights << std::endl;
+    }
+    std::cout << std::defaultfloat;
+}
+
+void StressTest::write() const {
+    std::ofstream file(settings.output);
+    if (!file.is_open()) {
+        throw std::runtime_error("Vysledky zatezoveho testu '" + settings.output.string() + "' nelze zapsat");
+    }
+
+    if (settings.output.extension() == ".json") {
+        nlohmann::json json = nlohmann::json::array();
+        for (const StressResult& result : results) {
+            const StressLoad& load = result.step.load;
+            json.push_back({
+                { "subsystem", stressSubsystemName(result.step.subsystem) },
+                { "scale", result.step.scale },
+                { "house_rows", load.houseRows },
+                { "house_spacing", load.houseSpacing },
+                { "flying_cupcakes", load.flyingCupcakes },
+                { "fire_rate", load.fireRate },
+                { "particle_budget", load.particles },
+                { "point_lights", load.pointLights },
+                { "frames", result.frames },
+                { "average_ms", result.averageMs },
+                { "p95_ms", result.p95Ms },
+                { "p99_ms", result.p99Ms },
+                { "max_ms", result.maxMs },
+                { "simulation_ms", result.simulationMs },
+                { "physics_ms", result.physicsMs },
+                { "particle_update_ms", result.particleUpdateMs },
+                { "particle_draw_ms", result.particleDrawMs },
+                { "max_houses", result.maxHouses },
+                { "max_projectiles", result.maxProjectiles },
+                { "max_particles", result.maxParticles },
+            });
+        }
+        file << json.dump(2) << std::endl;
+        return;
+    }
+
+    file << "subsystem,scale,house_rows,house_spacing,flying_cupcakes,fire_rate,particle_budget,point_lights,frames,"
+            "average_ms,p95_ms,p99_ms,max_ms,simulation_ms,physics_ms,particle_update_ms,particle_draw_ms,"
+            "max_houses,max_projectiles,max_particles\n";
+    for (const StressResult& result : results) {
+        const StressLoad& load = result.step.load;
+        file << stressSubsystemName(result.step.subsystem) << ',' << result.step.scale << ',' << load.houseRows << ','
+             << load.houseSpacing << ',' << load.flyingCupcakes << ',' << load.fireRate << ',' << load.particles << ','
+             << load.pointLights << ',' << result.frames << ',' << result.averageMs << ',' << result.p95Ms << ','
+             << result.p99Ms << ',' << result.maxMs << ',' << result.simulationMs << ',' << result.physicsMs << ','
+             << result.particleUpdateMs << ',' << result.particleDrawMs << ',' << result.maxHouses << ','
+             << result.maxProjectiles << ',' << result.maxParticles << '\n';
+    }
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <cstddef>
+#include <nlohmann/json_fwd.hpp>
+
+class Camera;
+
+// Scene load of one step of a stress test, the base load is the game as it ships
+struct StressLoad {
+    int houseRows = 1;          // rows of houses on each side of the road, GameState::house_rows
+    float houseSpacing = 18.0f; // between two houses along the road, GameState::house_spacing
+    int flyingCupcakes = 5;
+    float fireRate = 1.0f;      // cupcakes shot per second
+    size_t particles = 1000;    // a stress emitter keeps this many alive on top of the game effects
+    int pointLights = 3;        // the bike lights, the rest are street lights along the road
+};
+
+// What a step scales, ALL or (with "isolate") one subsystem while the others keep the base load
+enum class StressSubsystem {
+    ALL,
+    HOUSES,
+    CUPCAKES,
+    FIRE,
+    PARTICLES,
+    LIGHTS
+};
+
+const char* stressSubsystemName(StressSubsystem subsystem);
+
+// "stress_test" object of app_settings.json
+struct StressSettings {
+    bool enabled = false;
+    std::vector<float> scales{1.0f, 10.0f, 100.0f};
+    bool isolate = false;        // scale each subsystem on its own after the steps scaling all
+    double warmupSeconds = 2.0;  // after a load change, not measured
+    double measureSeconds = 10.0;
+    std::filesystem::path output = "stress_results.csv"; // .json or .csv
+    StressLoad base;
+
+    // "enabled", "scales", "isolate", "warmup_seconds", "measure_seconds", "output" and "base"
+    // with the StressLoad fields in snake case; missing ones keep the defaults
+    static StressSettings parse(const nlohmann::json& object);
+};
+
+struct StressStep {
+    StressSubsystem subsystem = StressSubsystem::ALL;
+    float scale = 1.0f;
+    StressLoad load;
+};
+
+// Measured in one frame, filled by the main loop
+struct StressFrame {
+    double frameMs = 0.0;       // whole frame, swap and events included
+    double simulationMs = 0.0;  // fixed steps of the game, cupcakes and particles
+    double physicsMs = 0.0;     // PhysicsWorker step (on its thread)
+    double particleUpdateMs = 0.0;
+    double particleDrawMs = 0.0;
+    size_t houses = 0;
+    size_t projectiles = 0;
+    size_t particles = 0;
+};
+
+struct StressResult {
+    StressStep step;
+    size_t frames = 0;
+    double averageMs = 0.0, p95Ms = 0.0, p99Ms = 0.0, maxMs = 0.0; // frame times
+    double simulationMs = 0.0; // averages of the frame parts
+    double physicsMs = 0.0;
+    double particleUpdateMs = 0.0;
+    double particleDrawMs = 0.0;
+    size_t maxHouses = 0, maxProjectiles = 0, maxParticles = 0;
+};
+
+// Runs the scene through the steps of the settings: every step applies its load, warms
+// up and then measures the frame times while the camera follows a fixed path, so runs
+// on different builds or machines compare step by step. The steps scale the base load by
+// each of the scales; with "isolate" the subsystems are then scaled one at a time, which
+// shows which of them stops scaling first.
+class StressTest {
+public:
+    explicit StressTest(const StressSettings& settings);
+
+    // once per frame before the simulation with the real time of the last frame; true when
+    // a new step starts, its load has to be applied before the frame goes on
+    bool advance(double realDelta);
+    void record(const StressFrame& frame); // ignored during the warmup
+    bool isRunning() const { return current < steps.size(); }
+
+    const StressStep& getStep() const { return steps[current]; }
+    size_t getStepIndex() const { return current; }
+    size_t getStepCount() const { return steps.size(); }
+    bool isMeasuring() const { return isRunning() && stepTime >= settings.warmupSeconds; }
+
+    // the largest loads of all steps, for the budgets set up before the scene exists
+    size_t getMaxParticles() const;
+    int getMaxHouseRows() const;
+
+    // pose on the fixed path at the time since the step started: a slow weave across the
+    // road while looking around at both sides
+    void updateCamera(Camera& camera) const;
+    // cupcakes to shoot in a frame of delta seconds at the fire rate of the step
+    int takeShots(float delta);
+
+    const std::vector<StressResult>& getResults() const { return results; }
+    void print() const;
+    void write() const; // JSON by the extension of the output, CSV otherwise
+    const std::filesystem::path& getOutput() const { return settings.output; }
+
+private:
+    void finishStep();
+
+    StressSettings settings;
+    std::vector<StressStep> steps;
+    size_t current = 0;
+    bool started = false;
+    double stepTime = 0.0; // real seconds since the step started
+    float shotAccumulator = 0.0f; // fractional shots carried over to the next frame
+    std::vector<StressFrame> frames; // measured frames of the step
+    std::vector<StressResult> results;
+};
@@ -0,0 +1,291 @@
+#include "Terrain.hpp"
+#include "ShaderProgram.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+
+Terrain::Terrain(const HeightField& heights, float viewDistance) : heights(heights), viewDistance(viewDistance) {
+    setViewDistance(viewDistance);
+    heightRevision = heights.getRevision();
+
+    glCreateVertexArrays(1, &vao);
+    glEnableVertexArrayAttrib(vao, 0);
+    glVertexArrayAttribFormat(vao, 0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, position));
+    glVertexArrayAttribBinding(vao, 0, 0);
+    glEnableVertexArrayAttrib(vao, 1);
+    glVertexArrayAttribFormat(vao, 1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, normal));
+    glVertexArrayAttribBinding(vao, 1, 0);
+
+    buildIndices();
+    glVertexArrayElementBuffer(vao, indexBuffer);
+}
+
+Terrain::~Terrain() {
+    for (const auto& [key, node] : nodes) {
+        freeBuffers.push_back(node.buffer);
+    }
+    glDeleteBuffers(static_cast<GLsizei>(freeBuffers.size()), freeBuffers.data());
+    glDeleteBuffers(1, &indexBuffer);
+    glDeleteVertexArrays(1, &vao);
+}
+
+void Terrain::setViewDistance(float distance) {
+    viewDistance = std::clamp(distance, LEAF_SIZE, nodeSize(MAX_LEVEL));
+}
+
+void Terrain::buildIndices() {
+    // one vertex layout for every node: the grid row by row, then the skirt copies of
+    // the edges z = 0, z = NODE_QUADS, x = 0 and x = NODE_QUADS
+    auto grid = [](int x, int z) { return static_cast<uint16_t>(z * NODE_VERTICES + x); };
+    auto skirt = [](int edge, int i) { return static_cast<uint16_t>(GRID_VERTICES + edge * NODE_VERTICES + i); };
+
+    std::vector<uint16_t> indices;
+    // counter-clockwise seen from outside the node
+    auto addSkirt = [&](uint16_t edge0, uint16_t edge1, uint16_t skirt0, uint16_t skirt1, bool flip) {
+        if (flip) {
+            indices.insert(indices.end(), { edge0, skirt0, edge1, edge1, skirt0, skirt1 });
+        } else {
+            indices.insert(indices.end(), { edge0, edge1, skirt0, edge1, skirt1, skirt0 });
+        }
+    };
+
+    for (int mip = 0; mip < MIP_LEVELS; mip++) {
+        const int step = 1 << mip;
+        mipIndexOffset[mip] = indices.size() * sizeof(uint16_t);
+
+        for (int z = 0; z < NODE_QUADS; z += step) {
+            for (int x = 0; x < NODE_QUADS; x += step) {
+                const uint16_t a = grid(x, z), b = grid(x + step, z);
+                const uint16_t c = grid(x, z + step), d = grid(x + step, z + step);
+                indices.insert(indices.end(), { a, c, b, b, c, d });
+            }
+        }
+        for (int i = 0; i < NODE_QUADS; i += step) {
+            addSkirt(grid(i, 0), grid(i + step, 0), skirt(0, i), skirt(0, i + step), false);
+            addSkirt(grid(i, NODE_QUADS), grid(i + step, NODE_QUADS), skirt(1, i), skirt(1, i + step), true);
+            addSkirt(grid(0, i), grid(0, i + step), skirt(2, i), skirt(2, i + step), true);
+            addSkirt(grid(NODE_QUADS, i), grid(NODE_QUADS, i + step), skirt(3, i), skirt(3, i + step), false);
+        }
+
+        mipIndexCount[mip] = static_cast<GLsizei>(indices.size() - mipIndexOffset[mip] / sizeof(uint16_t));
+    }
+
+    glCreateBuffers(1, &indexBuffer);
+    glNamedBufferStorage(indexBuffer, indices.size() * sizeof(uint16_t), indices.data(), 0);
+}
+
+void Terrain::update(const glm::vec3& cameraPosition, const glm::mat4& viewProjection) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    camera = cameraPosition;
+    frame++;
+    buildBudget = MAX_BUILDS_PER_FRAME;
+    stats.nodesBuilt = 0;
+    stats.nodesEvicted = 0;
+
+    // a new heightmap invalidates every mesh
+    if (heights.getRevision() != heightRevision) {
+        for (const auto& [key, node] : nodes) {
+            freeBuffers.push_back(node.buffer);
+        }
+        nodes.clear();
+        heightRevision = heights.getRevision();
+    }
+
+    // frustum planes (Gribb & Hartmann), pointing inside
+    const glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+    const glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+    const glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+    const glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+    frustum[0] = row3 + row0;
+    frustum[1] = row3 - row0;
+    frustum[2] = row3 + row1;
+    frustum[3] = row3 - row1;
+    frustum[4] = row3 + row2;
+    frustum[5] = row3 - row2;
+
+    drawList.clear();
+    const float rootSize = nodeSize(MAX_LEVEL);
+    const int minX = static_cast<int>(std::floor((camera.x - viewDistance) / rootSize));
+    const int maxX = static_cast<int>(std::floor((camera.x + viewDistance) / rootSize));
+    const int minZ = static_cast<int>(std::floor((camera.z - viewDistance) / rootSize));
+    const int maxZ = static_cast<int>(std::floor((camera.z + viewDistance) / rootSize));
+    for (int z = minZ; z <= maxZ; z++) {
+        for (int x = minX; x <= maxX; x++) {
+            select(MAX_LEVEL, x, z);
+        }
+    }
+
+    evict();
+
+    stats.nodesDrawn = drawList.size();
+    stats.trianglesDrawn = 0;
+    for (const auto& item : drawList) {
+        stats.trianglesDrawn += mipIndexCount[item.mip] / 3;
+    }
+    stats.nodesCached = nodes.size();
+    stats.updateMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+float Terrain::visibleDistance(int level, int x, int z) const {
+    const float size = nodeSize(level);
+    glm::vec3 boxMin(x * size, heights.getMinHeight(), z * size);
+    glm::vec3 boxMax(boxMin.x + size, heights.getMaxHeight(), boxMin.z + size);
+    auto it = nodes.find(nodeKey(level, x, z));
+    if (it != nodes.end()) {
+        boxMin.y = it->second.minHeight;
+        boxMax.y = it->second.maxHeight;
+    }
+
+    const float distance = glm::length(camera - glm::clamp(camera, boxMin, boxMax));
+    if (distance > viewDistance) {
+        return -1.0f;
+    }
+    for (const glm::vec4& plane : frustum) {
+        // the box corner furthest along the plane normal
+        const glm::vec3 corner(plane.x >= 0.0f ? boxMax.x : boxMin.x, plane.y >= 0.0f ? boxMax.y : boxMin.y,
+                               plane.z >= 0.0f ? boxMax.z : boxMin.z);
+        if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f) {
+            return -1.0f;
+        }
+    }
+    return distance;
+}
+
+void Terrain::select(int level, int x, int z) {
+    const float distance = visibleDistance(level, x, z);
+    if (distance < 0.0f) {
+        return;
+    }
+
+    const float size = nodeSize(level);
+    if (level > 0 && distance < size * LOD_SPLIT_DISTANCE) {
+        // split only once every visible child has its mesh, until then the node stands in
+        bool ready = true;
+        for (int child = 0; child < 4; child++) {
+            const int childX = 2 * x + (child & 1);
+            const int childZ = 2 * z + (child >> 1);
+            if (visibleDistance(level - 1, childX, childZ) >= 0.0f && !acquire(level - 1, childX, childZ, false)) {
+                ready = false;
+            }
+        }
+        if (ready) {
+            for (int child = 0; child < 4; child++) {
+                select(level - 1, 2 * x + (child & 1), 2 * z + (child >> 1));
+            }
+            return;
+        }
+    }
+
+    const Node* node = acquire(level, x, z, true);
+    const float band = size * LOD_SPLIT_DISTANCE;
+    const int mip = distance < 1.5f * band ? 0 : (distance < 2.0f * band ? 1 : 2);
+    drawList.push_back({ glm::vec3(x * size, 0.0f, z * size), node->buffer, mip });
+}
+
+Terrain::Node* Terrain::acquire(int level, int x, int z, bool force) {
+    const uint64_t key = nodeKey(level, x, z);
+    auto it = nodes.find(key);
+    if (it == nodes.end()) {
+        if (!force && buildBudget <= 0) {
+            return nullptr;
+        }
+        buildBudget--;
+        it = nodes.emplace(key, Node()).first;
+        buildMesh(level, x, z, it->second);
+    }
+    it->second.lastUsed = frame;
+    return &it->second;
+}
+
+void Terrain::buildMesh(int level, int x, int z, Node& node) {
+    const float size = nodeSize(level);
+    const float spacing = size / NODE_QUADS;
+    const int heightLevel = std::min(level, heights.getLevelCount() - 1);
+    const glm::vec2 origin(x * size, z * size);
+
+    // heights with a one sample border, the normals use central differences
+    constexpr int BORDERED = NODE_VERTICES + 2;
+    sampledHeights.resize(BORDERED * BORDERED);
+    for (int j = 0; j < BORDERED; j++) {
+        for (int i = 0; i < BORDERED; i++) {
+            sampledHeights[j * BORDERED + i] =
+                heights.sampleLevel(origin.x + (i - 1) * spacing, origin.y + (j - 1) * spacing, heightLevel);
+        }
+    }
+    auto sample = [&](int i, int j) { return sampledHeights[(j + 1) * BORDERED + (i + 1)]; };
+
+    float minHeight = sample(0, 0);
+    float maxHeight = minHeight;
+    vertices.resize(GRID_VERTICES + SKIRT_VERTICES);
+    for (int j = 0; j < NODE_VERTICES; j++) {
+        for (int i = 0; i < NODE_VERTICES; i++) {
+            const float height = sample(i, j);
+            minHeight = std::min(minHeight, height);
+            maxHeight = std::max(maxHeight, height);
+            const glm::vec3 normal(sample(i - 1, j) - sample(i + 1, j), 2.0f * spacing, sample(i, j - 1) - sample(i, j + 1));
+            vertices[j * NODE_VERTICES + i] = { glm::vec3(i * spacing, height, j * spacing), glm::normalize(normal) };
+        }
+    }
+
+    // deep enough for the error of a coarser neighbour, not so deep it shows at the view distance
+    const float skirtDepth = spacing + std::min(maxHeight - minHeight, 4.0f * spacing);
+    for (int i = 0; i < NODE_VERTICES; i++) {
+        const int edges[4] = { i, NODE_QUADS * NODE_VERTICES + i, i * NODE_VERTICES, i * NODE_VERTICES + NODE_QUADS };
+        for (int edge = 0; edge < 4; edge++) {
+            Vertex skirtVertex = vertices[edges[edge]];
+            skirtVertex.position.y -= skirtDepth;
+            vertices[GRID_VERTICES + edge * NODE_VERTICES + i] = skirtVertex;
+        }
+    }
+
+    node.minHeight = minHeight - skirtDepth;
+    node.maxHeight = maxHeight;
+    if (freeBuffers.empty()) {
+        glCreateBuffers(1, &node.buffer);
+        glNamedBufferStorage(node.buffer, vertices.size() * sizeof(Vertex), nullptr, GL_DYNAMIC_STORAGE_BIT);
+    } else {
+        node.buffer = freeBuffers.back();
+        freeBuffers.pop_back();
+    }
+    glNamedBufferSubData(node.buffer, 0, vertices.size() * sizeof(Vertex), vertices.data());
+    stats.nodesBuilt++;
+}
+
+void Terrain::evict() {
+    if (nodes.size() <= MAX_CACHED_NODES) {
+        return;
+    }
+
+    // oldest first, the nodes of this frame stay
+    std::vector<std::pair<uint64_t, uint64_t>> candidates; // last used, key
+    for (const auto& [key, node] : nodes) {
+        if (node.lastUsed < frame) {
+            candidates.emplace_back(node.lastUsed, key);
+        }
+    }
+    const size_t excess = std::min(nodes.size() - MAX_CACHED_NODES, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + excess, candidates.end());
+    for (size_t i = 0; i < excess; i++) {
+        auto it = nodes.find(candidates[i].second);
+        freeBuffers.push_back(it->second.buffer);
+        nodes.erase(it);
+    }
+    stats.nodesEvicted = excess;
+}
+
+void Terrain::draw(ShaderProgram& shader, const glm::mat4& model) const {
+    if (drawList.empty()) {
+        return;
+    }
+
+    glBindVertexArray(vao);
+    for (const auto& item : drawList) {
+        glVertexArrayVertexBuffer(vao, 0, item.buffer, 0, sizeof(Vertex));
+        shader.setUniform("uM_m", glm::translate(model, item.origin));
+        glDrawElements(GL_TRIANGLES, mipIndexCount[item.mip], GL_UNSIGNED_SHORT,
+                       reinterpret_cast<const void*>(mipIndexOffset[item.mip]));
+    }
+    glBindVertexArray(0);
+}
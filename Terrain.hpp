@@ -0,0 +1,124 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include "HeightField.hpp"
+
+class ShaderProgram;
+
+struct TerrainStats {
+    size_t nodesDrawn = 0;
+    size_t trianglesDrawn = 0;
+    size_t nodesBuilt = 0;   // last update
+    size_t nodesEvicted = 0; // last update
+    size_t nodesCached = 0;  // with a vertex buffer
+    float updateMs = 0.0f;   // CPU time of the last update (selection and builds)
+};
+
+// Heightmap terrain drawn as a quadtree of chunks (chunked LOD).
+//
+// Every quadtree node is a grid of NODE_QUADS x NODE_QUADS quads over its square. A node
+// of level k is 2^k leaves wide and samples level k of the height field, and a node is
+// split into its children only while the camera is closer than LOD_SPLIT_DISTANCE times
+// its size, so the number of nodes (and triangles) grows with the log of the view
+// distance. Within a node the shared index buffer has geomipmap levels (every 1st, 2nd
+// and 4th vertex) picked by distance. Every node edge has a skirt hanging down, which
+// hides the cracks between neighbours of different detail without stitching them.
+//
+// Meshes are built when a node is first selected, at most MAX_BUILDS_PER_FRAME per
+// update (the parent is drawn until its children are there), and kept in a cache of
+// vertex buffers. As the camera moves down the road the nodes left behind are evicted,
+// oldest first, once the cache holds more than MAX_CACHED_NODES.
+//
+// The terrain lives in road space: update takes the camera in road space and draw gets
+// the world scroll in the model matrix.
+class Terrain {
+public:
+    static constexpr int NODE_QUADS = 32;
+    static constexpr int NODE_VERTICES = NODE_QUADS + 1;
+    static constexpr float LEAF_SIZE = 64.0f; // meters, one quad per heightmap texel
+    static constexpr int MAX_LEVEL = 6;       // roots are 4 km wide
+    static constexpr int MIP_LEVELS = 3;
+    static constexpr float LOD_SPLIT_DISTANCE = 2.0f;
+    static constexpr int MAX_BUILDS_PER_FRAME = 8;
+    static constexpr size_t MAX_CACHED_NODES = 768;
+    static constexpr float DEFAULT_VIEW_DISTANCE = 2000.0f;
+
+    explicit Terrain(const HeightField& heights, float viewDistance = DEFAULT_VIEW_DISTANCE);
+    ~Terrain();
+
+    Terrain(const Terrain&) = delete;
+    Terrain& operator=(const Terrain&) = delete;
+
+    void setViewDistance(float distance);
+    float getViewDistance() const { return viewDistance; }
+
+    // Selects the nodes seen by a camera at cameraPosition (road space) and builds the
+    // missing meshes. viewProjection maps road space to clip space (world scroll included).
+    void update(const glm::vec3& cameraPosition, const glm::mat4& viewProjection);
+    // Draws the nodes of the last update, the shader has the camera uniforms set already.
+    // model moves road space to the world (the world offset).
+    void draw(ShaderProgram& shader, const glm::mat4& model) const;
+
+    const TerrainStats& getStats() const { return stats; }
+
+private:
+    struct Vertex {
+        glm::vec3 position; // relative to the node corner
+        glm::vec3 normal;
+    };
+    static constexpr int GRID_VERTICES = NODE_VERTICES * NODE_VERTICES;
+    static constexpr int SKIRT_VERTICES = 4 * NODE_VERTICES;
+
+    struct Node {
+        GLuint buffer = 0;
+        float minHeight = 0.0f;
+        float maxHeight = 0.0f;
+        uint64_t lastUsed = 0; // frame
+    };
+    struct DrawItem {
+        glm::vec3 origin; // node corner in road space
+        GLuint buffer;
+        int mip;
+    };
+
+    static uint64_t nodeKey(int level, int x, int z) {
+        return (static_cast<uint64_t>(level) << 58) | (static_cast<uint64_t>(static_cast<uint32_t>(x) & 0x1FFFFFFFu) << 29) |
+               (static_cast<uint32_t>(z) & 0x1FFFFFFFu);
+    }
+    static float nodeSize(int level) { return LEAF_SIZE * static_cast<float>(1 << level); }
+
+    void buildIndices();
+    void select(int level, int x, int z);
+    // the cached node, built now when the budget allows (force = always), else null
+    Node* acquire(int level, int x, int z, bool force);
+    void buildMesh(int level, int x, int z, Node& node);
+    void evict();
+    // distance of the camera to the node box, negative = culled
+    float visibleDistance(int level, int x, int z) const;
+
+    const HeightField& heights;
+    float viewDistance;
+
+    GLuint vao = 0;
+    GLuint indexBuffer = 0;
+    GLsizei mipIndexCount[MIP_LEVELS] = {};
+    size_t mipIndexOffset[MIP_LEVELS] = {}; // bytes
+
+    std::unordered_map<uint64_t, Node> nodes;
+    std::vector<GLuint> freeBuffers;
+    std::vector<DrawItem> drawList;
+    std::vector<Vertex> vertices;      // scratch of buildMesh
+    std::vector<float> sampledHeights; // scratch of buildMesh, with a border for the normals
+
+    glm::vec3 camera{0.0f};
+    glm::vec4 frustum[6];
+    uint64_t frame = 0;
+    int buildBudget = 0;
+    uint32_t heightRevision = 0;
+    TerrainStats stats;
+};
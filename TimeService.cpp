@@ -0,0 +1,60 @@
+#include "TimeService.hpp"
+#include <algorithm>
+#include <cmath>
+
+TimeService& TimeService::instance() {
+    static TimeService service;
+    return service;
+}
+
+void TimeService::reset() {
+    started = false;
+    accumulator = 0.0;
+    alpha = 1.0f;
+    realDelta = 0.0f;
+    frameDelta = 0.0f;
+    simulationTime = 0.0;
+    realTime = 0.0;
+    stepCount = 0;
+    droppedSteps = 0;
+}
+
+void TimeService::setStepRate(float stepsPerSecond) {
+    fixedStep = 1.0f / std::clamp(stepsPerSecond, 10.0f, 1000.0f);
+}
+
+void TimeService::setTimeScale(float scale) {
+    timeScale = std::clamp(scale, 0.0f, 10.0f);
+}
+
+int TimeService::beginFrame() {
+    const Clock::time_point now = Clock::now();
+    // the first frame only starts the clock
+    const float delta = started ? std::chrono::duration<float>(now - lastFrame).count() : 0.0f;
+    lastFrame = now;
+    started = true;
+    return advance(delta);
+}
+
+int TimeService::advance(float delta) {
+    realDelta = std::max(delta, 0.0f);
+    realTime += realDelta;
+
+    frameDelta = paused ? 0.0f : std::min(realDelta, MAX_FRAME_TIME) * timeScale;
+    accumulator += frameDelta;
+
+    int steps = static_cast<int>(std::floor(accumulator / fixedStep));
+    if (steps > MAX_STEPS_PER_FRAME) {
+        // spiral of death: drop the backlog instead of falling further behind
+        droppedSteps += steps - MAX_STEPS_PER_FRAME;
+        steps = MAX_STEPS_PER_FRAME;
+        accumulator = std::fmod(accumulator, static_cast<double>(fixedStep));
+    } else {
+        accumulator -= steps * static_cast<double>(fixedStep);
+    }
+
+    stepCount += steps;
+    simulationTime += steps * static_cast<double>(fixedStep);
+    alpha = static_cast<float>(accumulator / fixedStep);
+    return steps;
+}
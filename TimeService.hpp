@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+
+// The one clock of the application.
+//
+// Game, physics and particles advance in fixed steps: every frame the real time is
+// added to an accumulator (scaled by the time scale, nothing while paused) and as many
+// fixed steps are run as it holds. What is left over, as a fraction of a step, is the
+// alpha used to interpolate render transforms between the last two steps. A long frame
+// (loading, a breakpoint) is cut to MAX_FRAME_TIME and at most MAX_STEPS_PER_FRAME steps
+// run per frame, the rest of the backlog is dropped so slow steps cannot snowball.
+class TimeService {
+public:
+    static constexpr float DEFAULT_STEP_RATE = 60.0f; // steps per simulated second
+    static constexpr float MAX_FRAME_TIME = 0.25f;    // seconds
+    static constexpr int MAX_STEPS_PER_FRAME = 8;
+
+    static TimeService& instance();
+
+    void reset(); // restarts the clocks, keeps rate, scale and pause
+
+    // Once per frame: measures the real frame time and returns the number of fixed
+    // steps to run now. advance takes the frame time explicitly (headless runs).
+    int beginFrame();
+    int advance(float realDelta);
+
+    void setStepRate(float stepsPerSecond);
+    float getStepRate() const { return 1.0f / fixedStep; }
+    float getFixedStep() const { return fixedStep; }
+
+    void setTimeScale(float scale);
+    float getTimeScale() const { return timeScale; }
+    void setPaused(bool pause) { paused = pause; }
+    bool isPaused() const { return paused; }
+
+    float getAlpha() const { return alpha; }           // 0 = previous step, 1 = last step
+    float getRealDelta() const { return realDelta; }   // real time of the frame, for UI
+    float getFrameDelta() const { return frameDelta; } // scaled time of the frame, 0 while paused
+    double getSimulationTime() const { return simulationTime; } // fixed steps run so far
+    double getRealTime() const { return realTime; }             // since the start
+    uint64_t getStepCount() const { return stepCount; }
+    uint64_t getDroppedSteps() const { return droppedSteps; }
+
+private:
+    TimeService() = default;
+
+    using Clock = std::chrono::steady_clock;
+
+    float fixedStep = 1.0f / DEFAULT_STEP_RATE;
+    float timeScale = 1.0f;
+    bool paused = false;
+
+    Clock::time_point lastFrame{};
+    bool started = false;
+    double accumulator = 0.0;
+    float alpha = 1.0f;
+    float realDelta = 0.0f;
+    float frameDelta = 0.0f;
+    double simulationTime = 0.0;
+    double realTime = 0.0;
+    uint64_t stepCount = 0;
+    uint64_t droppedSteps = 0;
+};
@@ -0,0 +1,138 @@
+#include "TransparencyPass.hpp"
+#include <iostream>
+#include <stdexcept>
+
+TransparencyPass::TransparencyPass(int width, int height)
+    : width(width > 0 ? width : 1), height(height > 0 ? height : 1)
+{
+    compositeShader = ShaderProgram("resources/shaders/fullscreen.vert", "resources/shaders/oit_composite.frag");
+    compositeShader.activate();
+    compositeShader.setUniform("accumTexture", 0);
+    compositeShader.setUniform("revealageTexture", 1);
+    compositeShader.deactivate();
+
+    // fullscreen triangle is generated from gl_VertexID, core profile still needs a VAO
+    glCreateVertexArrays(1, &emptyVAO);
+
+    createTargets();
+}
+
+TransparencyPass::~TransparencyPass()
+{
+    deleteTargets();
+    glDeleteVertexArrays(1, &emptyVAO);
+    compositeShader.clear();
+}
+
+void TransparencyPass::resize(int width, int height)
+{
+    if (width <= 0 || height <= 0 || (width == this->width && height == this->height))
+        return;
+
+    this->width = width;
+    this->height = height;
+    deleteTargets();
+    createTargets();
+}
+
+void TransparencyPass::createTargets()
+{
+    glCreateTextures(GL_TEXTURE_2D, 1, &accumTexture);
+    glTextureStorage2D(accumTexture, 1, GL_RGBA16F, width, height);
+    glTextureParameteri(accumTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTextureParameteri(accumTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &revealageTexture);
+    glTextureStorage2D(revealageTexture, 1, GL_R8, width, height);
+    glTextureParameteri(revealageTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTextureParameteri(revealageTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    // same format as the default framebuffer, so the opaque depth can be blitted
+    glCreateRenderbuffers(1, &depthRenderbuffer);
+    glNamedRenderbufferStorage(depthRenderbuffer, GL_DEPTH24_STENCIL8, width, height);
+
+    glCreateFramebuffers(1, &framebuffer);
+    glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, accumTexture, 0);
+    glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT1, revealageTexture, 0);
+    glNamedFramebufferRenderbuffer(framebuffer, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+
+    const GLenum drawBuffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glNamedFramebufferDrawBuffers(framebuffer, 2, drawBuffers);
+
+    if (glCheckNamedFramebufferStatus(framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        throw std::runtime_error("OIT framebuffer is not complete");
+    }
+}
+
+void TransparencyPass::deleteTargets()
+{
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteTextures(1, &accumTexture);
+    glDeleteTextures(1, &revealageTexture);
+    glDeleteRenderbuffers(1, &depthRenderbuffer);
+    framebuffer = accumTexture = revealageTexture = depthRenderbuffer = 0;
+}
+
+void TransparencyPass::setupShader(ShaderProgram &shader) const
+{
+    shader.activate();
+    shader.setUniform("uOitPass", (enabled && active) ? 1 : 0);
+}
+
+void TransparencyPass::begin()
+{
+    active = true;
+    glEnable(GL_BLEND);
+    glDepthMask(GL_FALSE);
+
+    if (!enabled)
+    {
+        // classic blending in submission order (for comparison)
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        return;
+    }
+
+    // translucent surfaces are still occluded by the opaque scene
+    glBlitNamedFramebuffer(0, framebuffer, 0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+    const GLfloat clearAccum[] = {0.0f, 0.0f, 0.0f, 0.0f};
+    const GLfloat clearRevealage[] = {1.0f, 0.0f, 0.0f, 0.0f};
+    glClearNamedFramebufferfv(framebuffer, GL_COLOR, 0, clearAccum);
+    glClearNamedFramebufferfv(framebuffer, GL_COLOR, 1, clearRevealage);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glBlendFunci(0, GL_ONE, GL_ONE);
+    glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+}
+
+void TransparencyPass::end()
+{
+    active = false;
+    glDepthMask(GL_TRUE);
+
+    if (!enabled)
+    {
+        glDisable(GL_BLEND);
+        return;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // resolve: average weighted color, covered by (1 - revealage)
+    glDisable(GL_DEPTH_TEST);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    compositeShader.activate();
+    glBindTextureUnit(0, accumTexture);
+    glBindTextureUnit(1, revealageTexture);
+    glBindVertexArray(emptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glBindTextureUnit(0, 0);
+    glBindTextureUnit(1, 0);
+    compositeShader.deactivate();
+
+    glEnable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+}
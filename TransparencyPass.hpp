@@ -0,0 +1,51 @@
+#pragma once
+
+#include <GL/glew.h>
+#include "ShaderProgram.hpp"
+
+// Weighted blended order independent transparency (McGuire & Bavoil 2013).
+//
+// Translucent geometry is rendered in any order into an accumulation (RGBA16F) and
+// a revealage (R8) target that share the opaque depth of the main framebuffer, and
+// is resolved onto the main framebuffer in one fullscreen pass. No CPU sorting of
+// transparent objects is needed.
+//
+// Shaders that draw into the pass declare "uniform bool uOitPass" and two outputs
+// (location 0 = accumulation, location 1 = revealage), see phong.frag.
+class TransparencyPass
+{
+public:
+    TransparencyPass(int width, int height);
+    ~TransparencyPass();
+
+    TransparencyPass(const TransparencyPass &) = delete;
+    TransparencyPass &operator=(const TransparencyPass &) = delete;
+
+    void resize(int width, int height);
+
+    // begin() copies the opaque depth and binds the OIT targets, end() composites them
+    void begin();
+    void end();
+
+    // sets uOitPass of a shader according to the current state of the pass
+    void setupShader(ShaderProgram &shader) const;
+
+    void setEnabled(bool enabled) { this->enabled = enabled; }
+    bool isEnabled() const { return enabled; }
+
+private:
+    void createTargets();
+    void deleteTargets();
+
+    ShaderProgram compositeShader;
+    GLuint framebuffer = 0;
+    GLuint accumTexture = 0;
+    GLuint revealageTexture = 0;
+    GLuint depthRenderbuffer = 0;
+    GLuint emptyVAO = 0;
+
+    int width;
+    int height;
+    bool enabled = true;
+    bool active = false;
+};
@@ -1,6 +1,8 @@
 #include "lighting.hpp"
 #include "ShaderProgram.hpp"
 #include <iostream>
+#include <string>
+#include <algorithm>
 
 LightingSystem::LightingSystem()
 {
@@ -99,6 +101,36 @@ void LightingSystem::updateBikeLights(const glm::vec3 &cameraPos, const glm::vec
                               glm::vec3(0.0f, heightOffset, forwardOffset);
 }
 
+void LightingSystem::setPointLightCount(int count)
+{
+    count = std::clamp(count, 0, MAX_POINT_LIGHTS);
+
+    // warm street lamps, placed by updateStreetLights
+    for (int i = std::max(pointLightCount, 3); i < count; i++)
+    {
+        pointLights[i] = PointLight(
+            glm::vec3(0.0f),
+            1.0f, 0.09f, 0.032f,           // Attenuation (about 50 m)
+            glm::vec3(0.02f, 0.015f, 0.0f), // Ambient (faint)
+            glm::vec3(1.0f, 0.8f, 0.5f),    // Diffuse (sodium yellow)
+            glm::vec3(0.6f, 0.5f, 0.3f)     // Specular
+        );
+    }
+    pointLightCount = count;
+}
+
+void LightingSystem::updateStreetLights(const glm::vec3 &cameraPos)
+{
+    // pairs of lamps every 12 m ahead of the camera, one on each side of the road
+    const float spacing = 12.0f;
+    for (int i = 3; i < pointLightCount; i++)
+    {
+        const int lamp = i - 3;
+        const float side = (lamp % 2 == 0) ? -6.0f : 6.0f;
+        pointLights[i].position = glm::vec3(side, 5.0f, cameraPos.z - 5.0f - (lamp / 2) * spacing);
+    }
+}
+
 void LightingSystem::setupLightUniforms(ShaderProgram &shader, const glm::vec3 &viewPos)
 {
     shader.activate();
@@ -139,10 +171,17 @@ void LightingSystem::setupDirectionalLight(ShaderProgram &shader)
 
 void LightingSystem::setupPointLights(ShaderProgram &shader)
 {
-    static const std::vector<std::string> uniformNames = {
-        "pointLights[0]", "pointLights[1]", "pointLights[2]"};
+    static std::vector<std::string> uniformNames;
+    if (uniformNames.empty())
+    {
+        for (int i = 0; i < MAX_POINT_LIGHTS; i++)
+        {
+            uniformNames.push_back("pointLights[" + std::to_string(i) + "]");
+        }
+    }
 
-    for (int i = 0; i < 3; i++)
+    shader.setUniform("pointLightCount", pointLightCount);
+    for (int i = 0; i < pointLightCount; i++)
     {
         const std::string &base = uniformNames[i];
 
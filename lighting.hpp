@@ -78,15 +78,21 @@ struct SpotLight
 class LightingSystem
 {
 public:
+    static constexpr int MAX_POINT_LIGHTS = 64; // MAX_POINT_LIGHTS of phong.frag
+
     Material material;
     DirectionalLight dirLight;
-    PointLight pointLights[3];
+    PointLight pointLights[MAX_POINT_LIGHTS];
+    int pointLightCount = 3; // the bike lights and the unused third, the rest are street lights
     SpotLight spotLight;
 
     LightingSystem();
     void setupDefaultLights();
     void updateLights(float time);
     void updateBikeLights(const glm::vec3 &cameraPos, const glm::vec3 &cameraRight);
+    // lights above the first three become street lights along both sides of the road
+    void setPointLightCount(int count);
+    void updateStreetLights(const glm::vec3 &cameraPos);
     void setupLightUniforms(class ShaderProgram &shader, const glm::vec3 &viewPos);
 
 private:
@@ -27,11 +27,23 @@
 #include "lighting.hpp"
 #include "ParticleSystem.hpp"
 #include "PhysicsSystem.hpp"
+#include "PhysicsWorker.hpp"
 #include "AudioEngine.hpp"
 #include "particles.cpp"
 #include "TextureLoader.hpp"
 #include "CupcakeGame.hpp"
 #include "HouseGenerator.hpp"
+#include "ShadowMaps.hpp"
+#include "TransparencyPass.hpp"
+#include "ParticleTarget.hpp"
+#include "Random.hpp"
+#include "TimeService.hpp"
+#include "HeightField.hpp"
+#include "Terrain.hpp"
+#include "Headless.hpp"
+#include "InputRecording.hpp"
+#include "BatchRunner.hpp"
+#include "StressTest.hpp"
 #include <algorithm>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/norm.hpp>
@@ -45,45 +57,6 @@ static GLuint g_road_vao = 0;
 static GLuint g_road_vbo = 0;
 static GLuint g_road_ebo = 0;
 
-// const std::vector<std::string> HOUSE_MODELS = { "bambo_house", "cyprys_house", "building" };
-const std::vector<std::string> HOUSE_MODELS = {"bambo_house"};
-
-void spawn_new_houses(CupcakeGame &game, PhysicsSystem &physics, float zPosition)
-{
-    static std::mt19937 rng(std::random_device{}());
-    static std::uniform_real_distribution<float> dist(0.0f, 1.0f);
-    const float house_side_offset = 10.0f;
-    const float empty_plot_probability = 0.2f;
-
-    // leva strana
-    if (dist(rng) > empty_plot_probability)
-    {
-        House house;
-        house.id = game.get_game_state().next_house_id++;
-        house.modelName = HOUSE_MODELS[rng() % HOUSE_MODELS.size()]; // nahodny dum
-        house.position = glm::vec3(-house_side_offset - 10.0f, 0.0f, zPosition);
-        house.half_extents = game.get_house_extents(house.modelName);
-        house.indicator_height = game.get_indicator_height(house.modelName);
-
-        game.get_game_state().houses.push_back(house);
-        physics.addCollisionObject({CollisionType::BOX, house.position, house.half_extents});
-    }
-
-    // prava strana
-    if (dist(rng) > empty_plot_probability)
-    {
-        House house;
-        house.id = game.get_game_state().next_house_id++;
-        house.modelName = HOUSE_MODELS[rng() % HOUSE_MODELS.size()]; // nahodny dum
-        house.position = glm::vec3(house_side_offset, 0.0f, zPosition);
-        house.half_extents = game.get_house_extents(house.modelName);
-        house.indicator_height = game.get_indicator_height(house.modelName);
-
-        game.get_game_state().houses.push_back(house);
-        physics.addCollisionObject({CollisionType::BOX, house.position, house.half_extents});
-    }
-}
-
 void initRoadGeometry()
 {
     float road_vertices[] = {
@@ -159,15 +132,34 @@ int g_windowed_height = 600;
 int g_windowed_pos_x = 100;
 int g_windowed_pos_y = 100;
 
+ParticleBackend g_particle_backend = ParticleBackend::CPU;
+int g_max_particles = 1000;
+const int g_cpu_fallback_max_particles = 65536; // a GPU budget of millions would map ~100 B of instances per particle
+int g_particle_resolution = 1; // particles are drawn at 1/N of the screen resolution
+uint64_t g_random_seed = 0;    // master seed of the RandomService, 0 = new seed every run
+float g_simulation_rate = TimeService::DEFAULT_STEP_RATE; // fixed steps of the game, physics and particles per second
+std::string g_terrain_heightmap = "resources/textures/heightmap.png"; // 16-bit, generated when missing
+float g_terrain_height_scale = HeightField::DEFAULT_HEIGHT_SCALE;
+float g_terrain_view_distance = Terrain::DEFAULT_VIEW_DISTANCE;
+nlohmann::json g_stress_settings; // "stress_test", ulozi se zpet beze zmeny
+
 // INCLUDY
 
 std::unique_ptr<ShaderProgram> phong_shader;
 std::unique_ptr<ShaderProgram> particle_shader;
 std::unique_ptr<ShaderProgram> road_shader;
+std::unique_ptr<ShaderProgram> terrain_shader;
 std::unique_ptr<LightingSystem> lightning_system;
 std::unique_ptr<ParticleSystem> particle_system;
-std::unique_ptr<PhysicsSystem> physics_system;
+std::unique_ptr<PhysicsWorker> physics_system; // fyzika bezi ve vlakne, hra cte posledni krok
 std::unique_ptr<AudioEngine> audio_engine;
+std::unique_ptr<CascadedShadowMaps> shadow_maps;
+std::unique_ptr<TransparencyPass> transparency_pass;
+std::unique_ptr<ParticleTarget> particle_target;
+std::unique_ptr<HeightField> height_field;
+std::unique_ptr<Terrain> terrain;
+std::vector<ShadowCaster> shadow_casters;
+bool g_show_profiler = false;
 
 static unsigned int g_ambient_sound_handle = 0;
 
@@ -184,6 +176,18 @@ static GLint g_roadTilingLoc = -1;
 
 std::vector<TransparentObject> transparentObjects;
 
+// modely domu podle ArchetypeId, doplni se az s novymi typy domu (scene se po nacteni nemeni)
+std::vector<Model *> house_archetype_models;
+
+void update_house_archetype_models(const HouseArchetypeTable &archetypes)
+{
+    for (size_t id = house_archetype_models.size(); id < archetypes.size(); ++id)
+    {
+        auto it = scene.find(archetypes.get(static_cast<ArchetypeId>(id)).modelName);
+        house_archetype_models.push_back(it != scene.end() ? it->second.get() : nullptr);
+    }
+}
+
 // Flying cupcakes structure
 struct FlyingCupcake
 {
@@ -213,19 +217,28 @@ std::unique_ptr<Camera> camera;
 bool firstMouse = true;
 double lastX = 400, lastY = 300;
 
+// zatezovy test ("stress_test" v app_settings.json), emitor castic nad rozpocet hry
+std::unique_ptr<StressTest> stress_test;
+ParticleEmitterHandle stress_emitter;
+
+// zaznam a prehravani vstupu (--record, --replay), pri prehravani se zive vstupy ignoruji
+InputRecorder input_recorder;
+std::unique_ptr<InputReplay> input_replay;
+std::filesystem::path g_record_path;
+
 void error_callback(int error, const char *description)
 {
     std::cerr << "GLFW Error " << error << ": " << description << std::endl;
 }
 
-void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods)
+void handle_key(GLFWwindow *window, int key, int scancode, int action, int mods)
 {
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
     {
         glfwSetWindowShouldClose(window, GLFW_TRUE);
     }
 
-    particles_key_callback(window, key, scancode, action, mods, particle_system.get(), physics_system.get());
+    particles_key_callback(window, key, scancode, action, mods, particle_system.get(), physics_system ? &physics_system->getWorld() : nullptr);
 
     if (key == GLFW_KEY_F10 && action == GLFW_PRESS)
     {
@@ -283,6 +296,54 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
         std::cout << "Bike lights: " << (bike_lights_on ? "ON" : "OFF") << std::endl;
     }
 
+    if (key == GLFW_KEY_F3 && action == GLFW_PRESS)
+    {
+        g_show_profiler = !g_show_profiler;
+    }
+
+    if (key == GLFW_KEY_H && action == GLFW_PRESS && shadow_maps)
+    {
+        shadow_maps->setEnabled(!shadow_maps->isEnabled());
+        std::cout << "Stiny: " << (shadow_maps->isEnabled() ? "ON" : "OFF") << std::endl;
+    }
+
+    if (key == GLFW_KEY_F6 && action == GLFW_PRESS && particle_shader)
+    {
+        run_particle_benchmark(*particle_shader, vm, pm);
+    }
+
+    if (key == GLFW_KEY_F7 && action == GLFW_PRESS)
+    {
+        benchmarkPhysicsQueries();
+    }
+
+    if ((key == GLFW_KEY_PAGE_UP || key == GLFW_KEY_PAGE_DOWN) && action == GLFW_PRESS)
+    {
+        // zpomaleni / zrychleni simulace
+        TimeService &time = TimeService::instance();
+        time.setTimeScale(key == GLFW_KEY_PAGE_UP ? time.getTimeScale() * 2.0f : time.getTimeScale() * 0.5f);
+        std::cout << "Rychlost casu: " << time.getTimeScale() << "x" << std::endl;
+    }
+
+    if (key == GLFW_KEY_F8 && action == GLFW_PRESS)
+    {
+        benchmarkAabbKernels();
+    }
+
+    if (key == GLFW_KEY_O && action == GLFW_PRESS && transparency_pass)
+    {
+        transparency_pass->setEnabled(!transparency_pass->isEnabled());
+        std::cout << "OIT: " << (transparency_pass->isEnabled() ? "ON" : "OFF") << std::endl;
+    }
+
+    if (key == GLFW_KEY_R && action == GLFW_PRESS && particle_target)
+    {
+        // 1 -> 1/2 -> 1/4 -> 1
+        g_particle_resolution = particle_target->getDivisor() >= 4 ? 1 : particle_target->getDivisor() * 2;
+        particle_target->setDivisor(g_particle_resolution);
+        std::cout << "Rozliseni castic: 1/" << particle_target->getDivisor() << std::endl;
+    }
+
     if (key == GLFW_KEY_F && action == GLFW_PRESS)
     {
         toggleFullscreen(window);
@@ -297,6 +358,7 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
             {
                 // Restart game if it's game over
                 cupcagame->restart_game();
+                TimeService::instance().setPaused(false);
 
                 // Also respawn houses
                 cupcagame->get_game_state().houses.clear();
@@ -304,26 +366,49 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
                 {
                     physics_system->clearCollisionObjects();
                 }
-
-                float z = -15.0f;
-                for (int i = 0; i < 20; ++i)
+                if (shadow_maps)
                 {
-                    spawn_new_houses(*cupcagame, *physics_system, z);
-                    z -= cupcagame->get_game_state().house_spacing;
+                    shadow_maps->invalidate();
                 }
 
+                cupcagame->spawn_initial_houses(physics_system.get());
+
                 std::cout << "Hra restartovana!" << std::endl;
             }
             else
             {
-                // Normal pause/unpause
+                // Normal pause/unpause, the clock stops with the game (particles, lights)
                 cupcagame->get_game_state().active = !cupcagame->get_game_state().active;
+                TimeService::instance().setPaused(!cupcagame->get_game_state().active);
                 std::cout << "Cupcagame: " << (cupcagame->get_game_state().active ? "Aktivni" : "Pauznuty") << std::endl;
             }
         }
     }
 }
 
+void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods)
+{
+    if (input_replay)
+    {
+        // prehrava se zaznam, jde jen ukoncit
+        if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
+        {
+            glfwSetWindowShouldClose(window, GLFW_TRUE);
+        }
+        return;
+    }
+
+    InputEvent event;
+    event.type = InputEventType::KEY;
+    event.code = key;
+    event.scancode = scancode;
+    event.action = action;
+    event.mods = mods;
+    input_recorder.record(event);
+
+    handle_key(window, key, scancode, action, mods);
+}
+
 void window_resize_callback(GLFWwindow *window, int width, int height)
 {
     g_window_width = width;
@@ -331,6 +416,16 @@ void window_resize_callback(GLFWwindow *window, int width, int height)
 
     glViewport(0, 0, width, height);
 
+    if (transparency_pass)
+    {
+        transparency_pass->resize(width, height);
+    }
+
+    if (particle_target)
+    {
+        particle_target->resize(width, height);
+    }
+
     if (height <= 0)
         height = 1;
     float ratio = static_cast<float>(width) / height;
@@ -352,7 +447,7 @@ void window_resize_callback(GLFWwindow *window, int width, int height)
     std::cout << "Window resized to: " << width << "x" << height << std::endl;
 }
 
-void mouse_button_callback(GLFWwindow *window, int button, int action, int mods)
+void handle_mouse_button(int button, int action, int mods)
 {
     if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS)
     {
@@ -363,6 +458,36 @@ void mouse_button_callback(GLFWwindow *window, int button, int action, int mods)
     }
 }
 
+void mouse_button_callback(GLFWwindow *window, int button, int action, int mods)
+{
+    if (input_replay)
+        return;
+
+    InputEvent event;
+    event.type = InputEventType::MOUSE_BUTTON;
+    event.code = button;
+    event.action = action;
+    event.mods = mods;
+    input_recorder.record(event);
+
+    handle_mouse_button(button, action, mods);
+}
+
+void handle_cursor_offset(float xoffset, float yoffset)
+{
+    if (!camera)
+        return;
+
+    if (cupcagame)
+    {
+        cupcagame->handle_mouse_move(camera.get(), xoffset, yoffset); // otoceni a rizeni do stran
+    }
+    else
+    {
+        camera->ProcessMouseMovement(xoffset, yoffset);
+    }
+}
+
 void cursor_position_callback(GLFWwindow *window, double xpos, double ypos)
 {
     if (!camera)
@@ -382,47 +507,82 @@ void cursor_position_callback(GLFWwindow *window, double xpos, double ypos)
     lastX = xpos;
     lastY = ypos;
 
-    camera->ProcessMouseMovement(static_cast<GLfloat>(xoffset), static_cast<GLfloat>(yoffset));
-
-    if (cupcagame && cupcagame->get_game_state().active)
-    {
-        const float steeringSensitivity = 0.01f;
-        const float maxSteeringSpeed = 15.0f;
-
-        float lateralMovement = static_cast<float>(xoffset) * steeringSensitivity;
-        lateralMovement = glm::clamp(lateralMovement, -maxSteeringSpeed, maxSteeringSpeed);
+    if (input_replay)
+        return;
 
-        glm::vec3 rightVector = camera->Right;
-        glm::vec3 movement = rightVector * lateralMovement;
+    // zaznamenava se posun, ne poloha kurzoru, prehravani nezavisi na okne
+    InputEvent event;
+    event.type = InputEventType::CURSOR;
+    event.x = static_cast<float>(xoffset);
+    event.y = static_cast<float>(yoffset);
+    input_recorder.record(event);
 
-        camera->Position += movement;
-    }
+    handle_cursor_offset(event.x, event.y);
 }
 
-void scroll_callback(GLFWwindow *window, double xoffset, double yoffset)
+void handle_scroll(float xoffset, float yoffset)
 {
     if (camera)
     {
-        float speedMultiplier = 1.0f + static_cast<float>(yoffset) * 0.1f;
+        float speedMultiplier = 1.0f + yoffset * 0.1f;
         camera->MovementSpeed *= speedMultiplier;
         camera->MovementSpeed = glm::clamp(camera->MovementSpeed, 0.5f, 15.0f);
         std::cout << "Camera speed: " << camera->MovementSpeed << std::endl;
     }
 }
 
-void init_flying_cupcakes()
+void scroll_callback(GLFWwindow *window, double xoffset, double yoffset)
+{
+    if (input_replay)
+        return;
+
+    InputEvent event;
+    event.type = InputEventType::SCROLL;
+    event.x = static_cast<float>(xoffset);
+    event.y = static_cast<float>(yoffset);
+    input_recorder.record(event);
+
+    handle_scroll(event.x, event.y);
+}
+
+// vstup ze zaznamu jde stejnou cestou jako z callbacku
+void dispatch_input(GLFWwindow *window, const InputEvent &event)
+{
+    switch (event.type)
+    {
+    case InputEventType::KEY:
+        handle_key(window, event.code, event.scancode, event.action, event.mods);
+        break;
+    case InputEventType::MOUSE_BUTTON:
+        handle_mouse_button(event.code, event.action, event.mods);
+        break;
+    case InputEventType::CURSOR:
+        handle_cursor_offset(event.x, event.y);
+        break;
+    case InputEventType::SCROLL:
+        handle_scroll(event.x, event.y);
+        break;
+    }
+}
+
+void init_flying_cupcakes(int count = 5)
 {
     flying_cupcakes.clear();
+    RandomStream rng = RandomService::instance().stream("scene.cupcakes");
 
-    for (int i = 0; i < 5; ++i)
+    for (int i = 0; i < count; ++i)
     {
         FlyingCupcake cupcake;
 
+        // pet drah, dalsi cupcaky je opakuji s nahodnym posunem
+        const int orbit = i % 5;
+        const glm::vec3 shift = i < 5 ? glm::vec3(0.0f) : glm::vec3(rng.range(-60.0f, 60.0f), 0.0f, rng.range(-80.0f, 40.0f));
+
         float angle = (i * 72.0f) * (3.14159f / 180.0f);
-        cupcake.orbit_center = glm::vec3(0.0f, 40.0f + i * 8.0f, -20.0f - i * 10.0f); // Much higher in the sky
-        cupcake.orbit_radius = 20.0f + i * 10.0f;
+        cupcake.orbit_center = glm::vec3(0.0f, 40.0f + orbit * 8.0f, -20.0f - orbit * 10.0f) + shift; // Much higher in the sky
+        cupcake.orbit_radius = 20.0f + orbit * 10.0f;
         cupcake.orbit_angle = angle;
-        cupcake.orbit_speed = 0.3f + i * 0.1f;
+        cupcake.orbit_speed = 0.3f + orbit * 0.1f;
 
         cupcake.position = cupcake.orbit_center + glm::vec3(
                                                       cos(cupcake.orbit_angle) * cupcake.orbit_radius,
@@ -430,14 +590,14 @@ void init_flying_cupcakes()
                                                       sin(cupcake.orbit_angle) * cupcake.orbit_radius);
 
         cupcake.velocity = glm::vec3(
-            (rand() % 200 - 100) / 100.0f * 0.5f,
-            (rand() % 200 - 100) / 100.0f * 0.3f,
-            (rand() % 200 - 100) / 100.0f * 0.5f);
+            rng.range(-1.0f, 1.0f) * 0.5f,
+            rng.range(-1.0f, 1.0f) * 0.3f,
+            rng.range(-1.0f, 1.0f) * 0.5f);
 
-        cupcake.rotation_speed = 5.0f + i * 2.0f;
+        cupcake.rotation_speed = 5.0f + orbit * 2.0f;
         cupcake.rotation_y = 0.0f;
         cupcake.alpha = 0.5f; // 50% transparency for all flying cupcakes
-        cupcake.scale = 0.3f + i * 0.1f;
+        cupcake.scale = 0.3f + orbit * 0.1f;
 
         flying_cupcakes.push_back(cupcake);
     }
@@ -480,19 +640,73 @@ void update_flying_cupcakes(float deltaTime)
     }
 }
 
+// novy krok zatezoveho testu: hra od zacatku se zatizenim kroku, penize a spokojenost nedojdou
+void apply_stress_load(const StressLoad &load)
+{
+    cupcagame->restart_game();
+    GameState &state = cupcagame->get_game_state();
+    state.house_rows = load.houseRows;
+    state.house_spacing = load.houseSpacing;
+
+    physics_system->clearCollisionObjects();
+    physics_system->setWorldOffset(state.world_offset);
+    cupcagame->spawn_initial_houses(physics_system.get());
+
+    init_flying_cupcakes(load.flyingCupcakes);
+    lightning_system->setPointLightCount(load.pointLights);
+
+    if (particle_system)
+    {
+        particle_system->reset();
+        if (!particle_system->getEmitter(stress_emitter))
+        {
+            stress_emitter = particle_system->createEmitter(ParticleEmitterDesc::defaults(ParticleType::GLOW));
+        }
+        ParticleEmitterDesc *desc = particle_system->getEmitter(stress_emitter);
+        desc->extents = glm::vec3(15.0f, 4.0f, 30.0f);
+        desc->priority = -1; // efekty hry maji prednost
+        // zivych castic je rychlost krat stredni doba zivota
+        desc->rate = static_cast<float>(load.particles) / (0.5f * (desc->lifetimeMin + desc->lifetimeMax));
+    }
+
+    std::cout << "[stress] krok " << stress_test->getStepIndex() + 1 << "/" << stress_test->getStepCount() << ": "
+              << stressSubsystemName(stress_test->getStep().subsystem) << " x" << stress_test->getStep().scale
+              << " (" << load.houseRows << " rad domu po " << load.houseSpacing << " m, " << load.flyingCupcakes
+              << " cupcaku, " << load.fireRate << " strel/s, " << load.particles << " castic, " << load.pointLights
+              << " svetel)" << std::endl;
+}
+
 void init_assets()
 {
     phong_shader = std::make_unique<ShaderProgram>("resources/shaders/phong.vert", "resources/shaders/phong.frag");
     particle_shader = std::make_unique<ShaderProgram>("resources/shaders/particle.vert", "resources/shaders/particle.frag");
     road_shader = std::make_unique<ShaderProgram>("resources/shaders/basic.vert", "resources/shaders/basic.frag");
+    terrain_shader = std::make_unique<ShaderProgram>("resources/shaders/terrain.vert", "resources/shaders/terrain.frag");
 
     lightning_system = std::make_unique<LightingSystem>();
-    physics_system = std::make_unique<PhysicsSystem>();
+    shadow_maps = std::make_unique<CascadedShadowMaps>(2048);
+    transparency_pass = std::make_unique<TransparencyPass>(g_window_width, g_window_height);
+    particle_target = std::make_unique<ParticleTarget>(g_window_width, g_window_height, g_particle_resolution);
+    physics_system = std::make_unique<PhysicsWorker>();
 
     g_world_min = glm::vec3(-100.0f, -5.0f, -300.0f);
     g_world_max = glm::vec3(100.0f, 100.0f, 100.0f);
     physics_system->setWorldBounds(g_world_min, g_world_max);
 
+    height_field = std::make_unique<HeightField>();
+    if (std::filesystem::exists(g_terrain_heightmap))
+    {
+        height_field->load(g_terrain_heightmap, HeightField::DEFAULT_TEXEL_SIZE, g_terrain_height_scale);
+    }
+    else
+    {
+        std::cout << "Heightmapa '" << g_terrain_heightmap << "' nenalezena, teren se generuje" << std::endl;
+        height_field->generate(HeightField::GENERATED_SIZE, RandomService::instance().stream("terrain").next(),
+                               HeightField::DEFAULT_TEXEL_SIZE, g_terrain_height_scale);
+    }
+    terrain = std::make_unique<Terrain>(*height_field, g_terrain_view_distance);
+    physics_system->setTerrain(height_field.get()); // adjustForHeightMap a castice
+
     physics_system->setWallHitCallback([&](const glm::vec3 &hitPoint)
                                        {
             if (cupcagame && !cupcagame->get_game_state().active) return;
@@ -510,8 +724,22 @@ void init_assets()
     physics_system->setObjectHitCallback([](const glm::vec3 &hitPoint)
                                          { std::cout << "Object hit at: (" << hitPoint.x << ", " << hitPoint.y << ", " << hitPoint.z << ")" << std::endl; });
 
-    particle_system = std::make_unique<ParticleSystem>(*particle_shader, 1000);
+    // zatezovy test ma svuj rozpocet nad rozpoctem hry, do nastaveni se neuklada
+    const int max_particles = g_max_particles + (stress_test ? static_cast<int>(stress_test->getMaxParticles()) : 0);
+    try
+    {
+        particle_system = std::make_unique<ParticleSystem>(*particle_shader, max_particles, g_particle_backend);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "GPU castice nejsou k dispozici (" << e.what() << "), pouzivam CPU" << std::endl;
+        const int cpu_max_particles = std::min(max_particles, g_cpu_fallback_max_particles);
+        particle_system = std::make_unique<ParticleSystem>(*particle_shader, cpu_max_particles, ParticleBackend::CPU);
+    }
+    std::cout << "Castice: " << (particle_system->getBackend() == ParticleBackend::GPU ? "GPU" : "CPU")
+              << ", max " << particle_system->getMaxParticles() << std::endl;
     particle_system->set_emitter_position(glm::vec3(0.0f, 10.0f, -5.0f));
+    particle_system->setCollisionGrid(&physics_system->getParticleGrid()); // teren a domy, stavi je fyzikalni vlakno
 
     audio_engine = std::make_unique<AudioEngine>();
 
@@ -759,6 +987,18 @@ void saveSettings()
         settings["fullscreen"] = g_fullscreen;
         settings["windowed_position"]["x"] = g_windowed_pos_x;
         settings["windowed_position"]["y"] = g_windowed_pos_y;
+        settings["particles"]["backend"] = g_particle_backend == ParticleBackend::GPU ? "gpu" : "cpu";
+        settings["particles"]["max_particles"] = g_max_particles;
+        settings["particles"]["resolution_divisor"] = g_particle_resolution;
+        settings["random_seed"] = g_random_seed;
+        settings["simulation_rate"] = g_simulation_rate;
+        settings["terrain"]["heightmap"] = g_terrain_heightmap;
+        settings["terrain"]["height_scale"] = g_terrain_height_scale;
+        settings["terrain"]["view_distance"] = g_terrain_view_distance;
+        if (!g_stress_settings.is_null())
+        {
+            settings["stress_test"] = g_stress_settings;
+        }
 
         std::ofstream settingsFile("app_settings.json");
         if (settingsFile.is_open())
@@ -807,7 +1047,7 @@ void toggleFullscreen(GLFWwindow *window)
     }
 }
 
-int main()
+int main(int argc, char **argv)
 {
     try
     {
@@ -845,8 +1085,138 @@ int main()
             g_windowed_pos_y = settings["windowed_position"]["y"].get<int>();
         }
 
+        if (settings.contains("particles") && settings["particles"].is_object())
+        {
+            const auto &particleSettings = settings["particles"];
+            if (particleSettings.contains("backend") && particleSettings["backend"].is_string())
+            {
+                g_particle_backend = particleSettings["backend"].get<std::string>() == "gpu" ? ParticleBackend::GPU : ParticleBackend::CPU;
+            }
+            if (particleSettings.contains("max_particles") && particleSettings["max_particles"].is_number_integer())
+            {
+                g_max_particles = std::max(1, particleSettings["max_particles"].get<int>());
+            }
+            if (particleSettings.contains("resolution_divisor") && particleSettings["resolution_divisor"].is_number_integer())
+            {
+                g_particle_resolution = particleSettings["resolution_divisor"].get<int>();
+            }
+        }
+        if (settings.contains("random_seed") && settings["random_seed"].is_number_unsigned())
+        {
+            g_random_seed = settings["random_seed"].get<uint64_t>();
+        }
+
+        if (settings.contains("simulation_rate") && settings["simulation_rate"].is_number())
+        {
+            g_simulation_rate = settings["simulation_rate"].get<float>();
+        }
+        TimeService::instance().setStepRate(g_simulation_rate);
+
+        if (settings.contains("terrain") && settings["terrain"].is_object())
+        {
+            const auto &terrainSettings = settings["terrain"];
+            if (terrainSettings.contains("heightmap") && terrainSettings["heightmap"].is_string())
+            {
+                g_terrain_heightmap = terrainSettings["heightmap"].get<std::string>();
+            }
+            if (terrainSettings.contains("height_scale") && terrainSettings["height_scale"].is_number())
+            {
+                g_terrain_height_scale = std::max(0.0f, terrainSettings["height_scale"].get<float>());
+            }
+            if (terrainSettings.contains("view_distance") && terrainSettings["view_distance"].is_number())
+            {
+                g_terrain_view_distance = terrainSettings["view_distance"].get<float>();
+            }
+        }
+
+        if (settings.contains("stress_test") && settings["stress_test"].is_object())
+        {
+            g_stress_settings = settings["stress_test"];
+        }
+
+        // prikazova radka: --headless [sekundy] [--physics-inline], --record <soubor>, --replay <soubor>,
+        // --batch <nastaveni davky>
+        bool headless = false;
+        std::filesystem::path batch_path;
+        HeadlessOptions headless_options;
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+            if (arg == "--headless")
+            {
+                headless = true;
+                if (i + 1 < argc && argv[i + 1][0] != '-')
+                {
+                    headless_options.seconds = std::stod(argv[++i]);
+                }
+            }
+            else if (arg == "--physics-inline")
+            {
+                headless_options.threadedPhysics = false;
+            }
+            else if (arg == "--record" && i + 1 < argc)
+            {
+                g_record_path = argv[++i];
+            }
+            else if (arg == "--batch" && i + 1 < argc)
+            {
+                batch_path = argv[++i];
+            }
+            else if (arg == "--replay" && i + 1 < argc)
+            {
+                input_replay = std::make_unique<InputReplay>();
+                input_replay->load(argv[++i]);
+            }
+        }
+
+        // every subsystem takes its stream from the master seed, set it before anything is created;
+        // a replay brings the seed and the clock of the recorded session
+        uint64_t master_seed = g_random_seed;
+        if (input_replay)
+        {
+            const InputRecordingInfo &info = input_replay->getInfo();
+            master_seed = info.masterSeed;
+            TimeService::instance().setStepRate(info.stepRate);
+            TimeService::instance().setTimeScale(info.timeScale);
+        }
+        RandomService::instance().setMasterSeed(master_seed);
+
         std::cout << "Application: " << g_windowTitle << std::endl;
         std::cout << "Initial resolution: " << g_window_width << "x" << g_window_height << std::endl;
+        std::cout << "Random seed: " << RandomService::instance().getMasterSeed() << std::endl;
+
+        InputRecordingInfo recording_info;
+        recording_info.masterSeed = RandomService::instance().getMasterSeed();
+        recording_info.stepRate = TimeService::instance().getStepRate();
+        recording_info.timeScale = TimeService::instance().getTimeScale();
+
+        // zatezovy test bezi jen v okne, castice nad jeho rozpocet maji porad rozpocet hry
+        const StressSettings stress_settings = StressSettings::parse(g_stress_settings);
+        if (stress_settings.enabled && !headless && batch_path.empty() && !input_replay)
+        {
+            stress_test = std::make_unique<StressTest>(stress_settings);
+            std::cout << "Zatezovy test: " << stress_test->getStepCount() << " kroku, vysledky do "
+                      << stress_settings.output.string() << std::endl;
+        }
+
+        // mnoho her najednou, kazda s vlastnim seedem (BatchRunner)
+        if (!batch_path.empty())
+        {
+            return runBatchFromFile(batch_path);
+        }
+
+        // hra bez okna a OpenGL, hraje bot nebo zaznam
+        if (headless)
+        {
+            headless_options.step = TimeService::instance().getFixedStep();
+            headless_options.replay = input_replay.get();
+            if (!g_record_path.empty())
+            {
+                input_recorder.begin(g_record_path, recording_info);
+                headless_options.recorder = &input_recorder;
+            }
+            return runHeadless(headless_options);
+        }
 
         if (!glfwInit())
         {
@@ -997,13 +1367,23 @@ int main()
         init_assets();
 
         {
-            float z = -15.0f;
-            for (int i = 0; i < 20; ++i)
-            {
-                spawn_new_houses(*cupcagame, *physics_system, z);
-                z -= cupcagame->get_game_state().house_spacing;
-            }
+            cupcagame->spawn_initial_houses(physics_system.get());
+            // prvni krok fyziky, at hra zacina s domy v kolizich
+            physics_system->submit();
+            physics_system->sync();
+        }
+
+        if (stress_test)
+        {
+            // mapa pro nejvic rad domu, casy snimku bez cekani na VSync
+            const float house_extent = 30.0f + stress_test->getMaxHouseRows() * cupcagame->get_game_state().house_row_spacing;
+            g_world_min.x = std::min(g_world_min.x, -house_extent);
+            g_world_max.x = std::max(g_world_max.x, house_extent);
+            physics_system->setWorldBounds(g_world_min, g_world_max);
+            cupcagame->set_logging(false);
+            glfwSwapInterval(0);
         }
+        StressFrame stress_frame;
 
         glEnable(GL_DEPTH_TEST);
         glDepthFunc(GL_LESS);
@@ -1014,15 +1394,73 @@ int main()
         auto lastTime = std::chrono::high_resolution_clock::now();
         int frameCount = 0;
         float fps = 0.0f;
-        auto startTime = std::chrono::high_resolution_clock::now();
+        TimeService &time = TimeService::instance();
+        time.reset(); // loading does not count
+
+        // vstupy z nacitani se nezaznamenavaji, hra jeste neexistovala
+        if (!g_record_path.empty())
+        {
+            input_recorder.begin(g_record_path, recording_info);
+            std::cout << "Nahravani vstupu do " << g_record_path << std::endl;
+        }
+        InputFrame replay_frame;
 
         while (!glfwWindowShouldClose(window))
         {
             auto currentTime = std::chrono::high_resolution_clock::now();
             frameCount++;
 
+            // pevny krok simulace, vse casove se ridi TimeService
+            int steps;
+            if (input_replay)
+            {
+                // vstupy a cas snimku ze zaznamu, simulace probehne stejne jako pri nahravani
+                if (!input_replay->nextFrame(replay_frame))
+                {
+                    std::cout << "Zaznam prehran (" << input_replay->getFrameIndex() << " snimku)" << std::endl;
+                    break;
+                }
+                for (const InputEvent &event : replay_frame.events)
+                {
+                    dispatch_input(window, event);
+                }
+                steps = time.advance(replay_frame.delta);
+            }
+            else
+            {
+                steps = time.beginFrame();
+                input_recorder.recordFrame(time.getRealDelta());
+            }
+            const float elapsedTime = static_cast<float>(time.getSimulationTime());
+
+            // zatezovy test: zatizeni kroku, kamera na pevne draze a strelba, po poslednim kroku konec
+            if (stress_test)
+            {
+                if (stress_test->advance(time.getRealDelta()))
+                {
+                    apply_stress_load(stress_test->getStep().load);
+                }
+                if (!stress_test->isRunning())
+                {
+                    break;
+                }
+                stress_test->updateCamera(*camera);
+
+                GameState &state = cupcagame->get_game_state();
+                state.money = 1000000;
+                state.happiness = 100;
+                for (int shots = stress_test->takeShots(time.getFrameDelta()); shots > 0; shots--)
+                {
+                    cupcagame->handle_mouse_click(camera.get());
+                }
+                if (particle_system)
+                {
+                    particle_system->setEmitterPosition(stress_emitter, glm::vec3(0.0f, 6.0f, camera->Position.z - 35.0f));
+                }
+                stress_frame = StressFrame();
+            }
+
             // aktualizace FPS za 100 ms
-            float elapsedTime = std::chrono::duration<float>(currentTime - startTime).count();
             float timeDelta = std::chrono::duration<float>(currentTime - lastTime).count();
             if (timeDelta >= 0.1f)
             {
@@ -1046,31 +1484,32 @@ int main()
                                     (gameActive ? "" : " | 💥 GAME OVER");
                 glfwSetWindowTitle(window, title.c_str());
             }
-            if (camera && cupcagame && cupcagame->get_game_state().active)
+            // vysledek kroku fyziky, ktery bezel behem minuleho snimku (a jeho udalosti)
+            physics_system->sync();
+            if (particle_system)
             {
-                static auto lastFrameTime = currentTime;
-                float deltaTime = std::chrono::duration<float>(currentTime - lastFrameTime).count();
-                lastFrameTime = currentTime;
+                particle_system->setCollisionGrid(&physics_system->getParticleGrid());
+            }
 
-                cupcagame->update(deltaTime, camera.get(), audio_engine.get(), particle_system.get(), physics_system.get());
+            const auto simulationStart = std::chrono::high_resolution_clock::now();
+            if (camera && cupcagame && cupcagame->get_game_state().active)
+            {
+                const float step = time.getFixedStep();
+                for (int i = 0; i < steps && cupcagame->get_game_state().active; i++)
+                {
+                    cupcagame->update(step, camera.get(), audio_engine.get(), particle_system.get(), physics_system.get());
 
-                // Update flying cupcakes
-                update_flying_cupcakes(deltaTime);
+                    // Update flying cupcakes
+                    update_flying_cupcakes(step);
 
-                {
-                    float farthestZ = camera->Position.z;
-                    for (const auto &h : cupcagame->get_game_state().houses)
+                    if (particle_system)
                     {
-                        farthestZ = std::min(farthestZ, h.position.z);
+                        particle_system->update(step);
                     }
 
-                    // generovani novych domu, pokud je kamera blizko k nejzazsimu domu
-                    if (camera->Position.z - farthestZ < 100.0f)
-                    {
-                        float newZ = farthestZ - cupcagame->get_game_state().house_spacing;
-                        spawn_new_houses(*cupcagame, *physics_system, newZ);
-                    }
+                    cupcagame->spawn_houses_ahead(camera.get(), physics_system.get());
                 }
+                stress_frame.simulationMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - simulationStart).count();
 
                 // aktualizace view matice se zemetresenim
                 glm::mat4 V = camera->GetViewMatrix();
@@ -1090,6 +1529,9 @@ int main()
                 vm = V;
             }
 
+            // prikazy tohoto snimku zpracuje fyzikalni vlakno, zatimco se kresli
+            physics_system->submit();
+
             audio_engine->setListener(camera->Position, camera->Front, camera->Up);
 
             // Update ambient sound position to follow camera
@@ -1098,6 +1540,7 @@ int main()
                 audio_engine->setSoundPosition(g_ambient_sound_handle, camera->Position);
             }
 
+            glm::vec3 sky_color(0.0f);
             {
                 glm::vec3 normal_sky_color = glm::vec3(0.55f, 0.70f, 0.95f); // modra
                 glm::vec3 quake_sky_color = glm::vec3(0.55f, 0.55f, 0.55f);  // seda
@@ -1107,24 +1550,21 @@ int main()
                 float easeInRate = 2.5f;
                 float easeOutRate = 1.5f;
 
-                static auto lastBG = std::chrono::high_resolution_clock::now();
-                auto nowBG = std::chrono::high_resolution_clock::now();
-                float dtBG = std::chrono::duration<float>(nowBG - lastBG).count();
-                lastBG = nowBG;
-
                 float rate = (target > quakeBlend) ? easeInRate : easeOutRate;
-                quakeBlend += (target - quakeBlend) * glm::clamp(rate * dtBG, 0.0f, 1.0f);
+                quakeBlend += (target - quakeBlend) * glm::clamp(rate * time.getFrameDelta(), 0.0f, 1.0f);
                 quakeBlend = glm::clamp(quakeBlend, 0.0f, 1.0f);
 
                 glm::vec3 bg = glm::mix(normal_sky_color, quake_sky_color, quakeBlend);
+                sky_color = bg;
                 glClearColor(bg.r, bg.g, bg.b, 1.0f);
                 glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
             }
 
-            static float lastLightingUpdate = 0.0f;
-            const float lightingUpdateInterval = 1.0f / 30.0f;
+            // svetla se prepocitavaji 30x za (skutecnou) sekundu, animace bezi v case simulace
+            static double lastLightingUpdate = -1.0;
+            const double lightingUpdateInterval = 1.0 / 30.0;
 
-            if (lightning_system && (elapsedTime - lastLightingUpdate) >= lightingUpdateInterval)
+            if (lightning_system && (time.getRealTime() - lastLightingUpdate) >= lightingUpdateInterval)
             {
                 lightning_system->updateLights(elapsedTime);
 
@@ -1135,6 +1575,7 @@ int main()
 
                     // Update bike lights to follow camera
                     lightning_system->updateBikeLights(camera->Position, camera->Right);
+                    lightning_system->updateStreetLights(camera->Position);
                 }
                 else
                 {
@@ -1146,7 +1587,42 @@ int main()
 
                 lightning_system->setupLightUniforms(*phong_shader, viewPos);
 
-                lastLightingUpdate = elapsedTime;
+                lastLightingUpdate = time.getRealTime();
+            }
+
+            // posunuti sveta mezi poslednim krokem simulace a vykreslovanym okamzikem
+            const float render_alpha = cupcagame->get_game_state().active ? time.getAlpha() : 1.0f; // pauza ukazuje posledni krok
+            const glm::vec3 render_offset = cupcagame->get_render_offset(render_alpha);
+            const HouseRegistry &houses = cupcagame->get_game_state().houses;
+            const HouseArchetypeTable &house_archetypes = cupcagame->get_house_archetypes();
+            update_house_archetype_models(house_archetypes);
+
+            // stiny - kaskady se prekresluji jen po castech (viz ShadowMaps.hpp)
+            if (shadow_maps && lightning_system && camera)
+            {
+                shadow_casters.clear();
+                for (size_t i = 0; i < houses.size(); ++i)
+                {
+                    Model *model = house_archetype_models[houses.archetypes[i]];
+                    if (model)
+                    {
+                        glm::mat4 model_matrix = model->get_model_matrix(houses.positions[i] + render_offset, glm::vec3(0.0f),
+                                                                         house_archetypes.get(houses.archetypes[i]).modelScale);
+                        shadow_casters.push_back({houses.ids[i], model, model_matrix});
+                    }
+                }
+
+                shadow_maps->update(camera->Position, lightning_system->dirLight.direction,
+                                    cupcagame->get_game_state().world_offset + render_offset, shadow_casters);
+                shadow_maps->setupShadowUniforms(*phong_shader);
+                if (road_shader)
+                {
+                    shadow_maps->setupShadowUniforms(*road_shader);
+                }
+                if (terrain_shader)
+                {
+                    shadow_maps->setupShadowUniforms(*terrain_shader);
+                }
             }
 
             phong_shader->activate();
@@ -1178,7 +1654,7 @@ int main()
                 for (const auto &seg : cupcagame->get_game_state().road_segments)
                 {
                     // segment silnice pod kamerou (z-fighting)
-                    glm::vec3 pos(seg.x, -0.02f, seg.z);
+                    glm::vec3 pos(seg.x + render_offset.x, -0.02f, seg.z + render_offset.z);
 
                     float roadWidth = cupcagame->get_game_state().road_segment_width;
                     float roadLength = cupcagame->get_game_state().road_segment_length;
@@ -1201,55 +1677,57 @@ int main()
                 road_shader->deactivate();
             }
 
+            // teren lezi v prostoru silnice, svet se po nem posouva
+            if (terrain && terrain_shader && camera)
+            {
+                const glm::vec3 terrain_offset = cupcagame->get_game_state().world_offset + render_offset;
+                const glm::mat4 terrain_model = glm::translate(glm::mat4(1.0f), terrain_offset);
+                terrain->update(camera->Position - terrain_offset, pm * vm * terrain_model);
+
+                terrain_shader->activate();
+                terrain_shader->setUniform("uV_m", vm);
+                terrain_shader->setUniform("uProj_m", pm);
+                terrain_shader->setUniform("uViewPos", camera->Position);
+                terrain_shader->setUniform("uFogColor", sky_color);
+                terrain_shader->setUniform("uFogEnd", terrain->getViewDistance());
+                if (lightning_system)
+                {
+                    terrain_shader->setUniform("uLightDirection", lightning_system->dirLight.direction);
+                    terrain_shader->setUniform("uLightAmbient", lightning_system->dirLight.ambient);
+                    terrain_shader->setUniform("uLightDiffuse", lightning_system->dirLight.diffuse);
+                }
+                terrain->draw(*terrain_shader, terrain_model);
+                terrain_shader->deactivate();
+            }
+
             const float cameraZ = camera ? camera->Position.z : 0.0f;
             // renderovani domu ve scene
             const float cullingDistance = 120.0f;
 
-            for (const auto &h : cupcagame->get_game_state().houses)
+            for (size_t i = 0; i < houses.size(); ++i)
             {
-                // vyber modelu podle typu modelu
-                std::string model_name = h.modelName;
-                if (model_name.empty())
+                // model podle typu domu
+                const HouseArchetype &archetype = house_archetypes.get(houses.archetypes[i]);
+                const glm::vec3 &position = houses.positions[i];
+                const glm::vec3 &half_extents = houses.halfExtents[i];
+                if (Model *model = house_archetype_models[houses.archetypes[i]])
                 {
-                    model_name = "bambo_house"; // vychoze bambo_house
+                    model->draw(position + render_offset, glm::vec3(0.0f), archetype.modelScale);
                 }
 
-                if (scene.find(model_name) != scene.end())
+                if ((houses.flags[i] & HOUSE_REQUESTING) && scene.find("cupcake") != scene.end())
                 {
-                    glm::vec3 pos = h.position;
-                    glm::vec3 rot(0.0f);
-                    glm::vec3 scl(1.0f);
-
-                    if (model_name == "bambo_house")
-                    {
-                        scl = glm::vec3(2.0f);
-                    }
-                    else if (model_name == "cyprys_house")
-                    {
-                        scl = glm::vec3(2.5f);
-                    }
-                    else if (model_name == "building")
-                    {
-                        scl = glm::vec3(1.5f);
-                    }
-
-                    scene.at(model_name)->draw(pos, rot, scl);
-                }
-
-                if (h.requesting && scene.find("cupcake") != scene.end())
-                {
-                    glm::vec3 indicator_pos = h.position + glm::vec3(0.0f, h.indicator_height, 0.0f);
+                    glm::vec3 indicator_pos = position + render_offset + glm::vec3(0.0f, archetype.indicatorHeight, 0.0f);
                     indicator_pos.y += sin(elapsedTime * 2.5f) * 0.7f;
 
-                    float x_offset = h.half_extents.x + 3.0f;
                     // Make the indicator always appear clearly next to the house
-                    if (h.position.x < 0) // dum je nalevo
+                    if (position.x < 0) // dum je nalevo
                     {
-                        indicator_pos.x = h.position.x - h.half_extents.x + 20.0f;
+                        indicator_pos.x = position.x - half_extents.x + 20.0f;
                     }
                     else // dum je napravo
                     {
-                        indicator_pos.x = h.position.x + h.half_extents.x - 7.5f; // right of house
+                        indicator_pos.x = position.x + half_extents.x - 7.5f; // right of house
                     }
 
                     glm::vec3 indicator_scale(0.25f, 0.25f, 0.25f); // Make cupcake bigger for visibility
@@ -1270,48 +1748,15 @@ int main()
 
             if (scene.find("cupcake") != scene.end())
             {
-                for (const auto &projectile : cupcagame->get_game_state().projectiles)
+                for (const Projectile &projectile : cupcagame->get_game_state().projectiles)
                 {
-                    if (projectile && projectile->alive)
+                    if (projectile.alive)
                     {
-                        projectile->draw(scene.at("cupcake").get());
+                        projectile.draw(scene.at("cupcake").get(), render_alpha, cupcagame->get_game_state().step_movement);
                     }
                 }
             }
 
-            // Flying cupcakes in the sky
-            if (scene.find("cupcake") != scene.end() && phong_shader && !flying_cupcakes.empty())
-            {
-                // Enable blending for transparency
-                glEnable(GL_BLEND);
-                glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-                phong_shader->activate();
-
-                for (const auto &cupcake : flying_cupcakes)
-                {
-                    // Set transparent material with alpha from cupcake.alpha (0.5 = 50% transparency)
-                    phong_shader->setUniform("material_diffuse", glm::vec4(1.0f, 0.9f, 0.8f, cupcake.alpha));
-                    phong_shader->setUniform("material_specular", glm::vec3(0.3f, 0.3f, 0.3f));
-                    phong_shader->setUniform("material_shininess", 32.0f);
-                    phong_shader->setUniform("material_emission", glm::vec3(0.1f, 0.1f, 0.05f)); // Slight glow
-
-                    // Create rotation vector for the cupcake
-                    glm::vec3 cupcake_rotation(0.0f, cupcake.rotation_y, 0.0f);
-                    glm::vec3 cupcake_scale(cupcake.scale);
-
-                    // Draw the flying cupcake
-                    scene.at("cupcake")->draw(cupcake.position, cupcake_rotation, cupcake_scale);
-                }
-
-                // Reset material properties
-                phong_shader->setUniform("material_emission", glm::vec3(0.0f, 0.0f, 0.0f));
-                phong_shader->deactivate();
-
-                // Disable blending after transparent objects
-                glDisable(GL_BLEND);
-            }
-
             // slunce
             if (scene.find("sphere") != scene.end() && lightning_system)
             {
@@ -1334,6 +1779,58 @@ int main()
                 phong_shader->setUniform("material_emission", glm::vec3(0.0f, 0.0f, 0.0f));
             }
 
+            // pruhledne objekty (OIT, bez razeni)
+            if (transparency_pass)
+            {
+                transparency_pass->begin();
+
+                // Flying cupcakes in the sky
+                if (scene.find("cupcake") != scene.end() && phong_shader && !flying_cupcakes.empty())
+                {
+                    transparency_pass->setupShader(*phong_shader);
+
+                    for (const auto &cupcake : flying_cupcakes)
+                    {
+                        // Set transparent material with alpha from cupcake.alpha (0.5 = 50% transparency)
+                        phong_shader->setUniform("material_alpha", cupcake.alpha);
+                        phong_shader->setUniform("material_emission", glm::vec3(0.1f, 0.1f, 0.05f)); // Slight glow
+
+                        // Create rotation vector for the cupcake
+                        glm::vec3 cupcake_rotation(0.0f, cupcake.rotation_y, 0.0f);
+                        glm::vec3 cupcake_scale(cupcake.scale);
+
+                        // Draw the flying cupcake
+                        scene.at("cupcake")->draw(cupcake.position, cupcake_rotation, cupcake_scale);
+                    }
+
+                    // Reset material properties
+                    phong_shader->setUniform("material_alpha", 1.0f);
+                    phong_shader->setUniform("material_emission", glm::vec3(0.0f, 0.0f, 0.0f));
+                    phong_shader->setUniform("uOitPass", 0);
+                }
+
+                // full resolution particles are part of the OIT pass
+                if (particle_system && particle_target && !particle_target->isOffscreen())
+                {
+                    particle_target->beginTiming();
+                    particle_system->draw(vm, pm, particle_target->getViewportSize(),
+                                          transparency_pass->isEnabled() ? ParticleBlendMode::ORDER_INDEPENDENT : ParticleBlendMode::ALPHA);
+                    particle_target->endTiming();
+                }
+
+                transparency_pass->end();
+            }
+
+            // low resolution particles are composited over the resolved translucent objects
+            if (particle_system && particle_target && particle_target->isOffscreen())
+            {
+                particle_target->beginTiming();
+                particle_target->begin(pm);
+                particle_system->draw(vm, pm, particle_target->getViewportSize(), ParticleBlendMode::EXTERNAL);
+                particle_target->end();
+                particle_target->endTiming();
+            }
+
             phong_shader->deactivate();
 
             ImGui_ImplOpenGL3_NewFrame();
@@ -1357,6 +1854,70 @@ int main()
                 ImGui::PopStyleColor();
             }
 
+            if (g_show_profiler)
+            {
+                ImGui::SetNextWindowPos(ImVec2(10.0f, 10.0f), ImGuiCond_FirstUseEver);
+                ImGui::Begin("Profiler", &g_show_profiler, ImGuiWindowFlags_AlwaysAutoResize);
+
+                ImGui::Text("FPS: %.1f (%.2f ms)", fps, fps > 0.0f ? 1000.0f / fps : 0.0f);
+
+                if (shadow_maps)
+                {
+                    ImGui::Separator();
+                    ImGui::Text("Stiny (H): %s", shadow_maps->isEnabled() ? "ON" : "OFF");
+                    for (int i = 0; i < CascadedShadowMaps::CASCADE_COUNT; i++)
+                    {
+                        const ShadowCascadeStats &stats = shadow_maps->getStats(i);
+                        ImGui::Text("Kaskada %d (%.0f m): %.3f ms, plna %.3f ms, %.1f%% texelu, %d draw",
+                                    i, shadow_maps->getExtent(i), stats.gpuTimeMs, stats.fullRedrawGpuTimeMs,
+                                    stats.renderedFraction * 100.0f, stats.casterDraws);
+                        ImGui::Text("    plnych prekresleni: %d, posunuti: %d", stats.fullRedraws, stats.partialUpdates);
+                    }
+                }
+
+                if (physics_system)
+                {
+                    const PhysicsWorkerStats &stats = physics_system->getStats();
+                    ImGui::Separator();
+                    ImGui::Text("Fyzika (%s): krok %.3f ms, cekani %.3f ms, %zu prikazu, %zu kolideru",
+                                physics_system->isThreaded() ? "vlakno" : "synchronne", stats.stepMs, stats.waitMs,
+                                stats.commands, physics_system->getWorld().getCollisionObjects().size());
+                }
+
+                if (terrain)
+                {
+                    const TerrainStats &stats = terrain->getStats();
+                    ImGui::Separator();
+                    ImGui::Text("Teren (%.0f m): %zu uzlu, %zu trojuhelniku, update %.3f ms",
+                                terrain->getViewDistance(), stats.nodesDrawn, stats.trianglesDrawn, stats.updateMs);
+                    ImGui::Text("    cache %zu uzlu, postaveno %zu, uvolneno %zu", stats.nodesCached, stats.nodesBuilt, stats.nodesEvicted);
+                }
+
+                if (transparency_pass)
+                {
+                    ImGui::Separator();
+                    ImGui::Text("OIT (O): %s", transparency_pass->isEnabled() ? "ON" : "OFF");
+                }
+
+                if (particle_system)
+                {
+                    const ParticleStats &stats = particle_system->getStats();
+                    ImGui::Separator();
+                    ImGui::Text("Castice %s: %zu / %zu", particle_system->getBackend() == ParticleBackend::GPU ? "GPU" : "CPU",
+                                stats.aliveCount, particle_system->getMaxParticles());
+                    ImGui::Text("    update %.3f ms (GPU %.3f ms), draw %.3f ms, benchmark F6",
+                                stats.updateCpuMs, stats.updateGpuMs, stats.drawCpuMs);
+                    ImGui::Text("    emitory: %zu, vypusteno %zu, nad rozpocet %zu", stats.emitterCount, stats.emitted, stats.dropped);
+                    if (particle_target)
+                    {
+                        ImGui::Text("    rozliseni (R): 1/%d, vykresleni GPU %.3f ms",
+                                    particle_target->getDivisor(), particle_target->getGpuTimeMs());
+                    }
+                }
+
+                ImGui::End();
+            }
+
             if (!cupcagame->get_game_state().active)
             {
                 bool is_game_over = cupcagame->is_game_over();
@@ -1430,6 +1991,29 @@ int main()
             glfwSwapBuffers(window);
 
             glfwPollEvents();
+
+            if (stress_test)
+            {
+                const GameState &state = cupcagame->get_game_state();
+                stress_frame.frameMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - currentTime).count();
+                stress_frame.physicsMs = physics_system->getStats().stepMs;
+                stress_frame.houses = state.houses.size();
+                stress_frame.projectiles = state.projectiles.size();
+                if (particle_system)
+                {
+                    stress_frame.particleUpdateMs = particle_system->getStats().updateCpuMs;
+                    stress_frame.particleDrawMs = particle_system->getStats().drawCpuMs;
+                    stress_frame.particles = particle_system->getStats().aliveCount;
+                }
+                stress_test->record(stress_frame);
+            }
+        }
+
+        if (stress_test)
+        {
+            stress_test->print();
+            stress_test->write();
+            std::cout << "Vysledky zatezoveho testu: " << stress_test->getOutput().string() << std::endl;
         }
 
         phong_shader->clear();
@@ -1438,6 +2022,15 @@ int main()
             particle_shader->clear();
         }
         cleanupRoadGeometry();
+        shadow_maps.reset();
+        transparency_pass.reset();
+        particle_target.reset();
+        physics_system.reset(); // zastavi vlakno, nez zmizi teren, ktery cte
+        if (input_recorder.isRecording())
+        {
+            std::cout << "Zaznam vstupu: " << input_recorder.getFrameCount() << " snimku" << std::endl;
+            input_recorder.finish();
+        }
 
         ImGui_ImplOpenGL3_Shutdown();
         ImGui_ImplGlfw_Shutdown();
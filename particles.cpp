@@ -6,13 +6,15 @@
 #include "ParticleSystem.hpp"
 #include "PhysicsSystem.hpp"
 #include <iostream>
+#include <chrono>
+#include <memory>
 
 // Legacy particle system functions for compatibility
 // These are now integrated into the main application
 
 // Particle key callbacks for integration with main app
 void particles_key_callback(GLFWwindow* window, int key, int scancode, int action, int mods,
-                           ParticleSystem* particleSystem, PhysicsSystem* physicsSystem)
+                           ParticleSystem* particleSystem, const PhysicsSystem* physicsSystem)
 {
     static bool aa = false;
     static GLfloat point_size = 1.0f;
@@ -57,6 +59,70 @@ void particles_key_callback(GLFWwindow* window, int key, int scancode, int actio
     }
 }
 
+// Compares the CPU and GPU particle backends on the same workload (key F6).
+// Every run fills a fresh system and then simulates and draws it for a fixed number
+// of frames. glFinish() ends every frame, so the wall time includes the GPU work.
+void run_particle_benchmark(ShaderProgram& shader, const glm::mat4& view, const glm::mat4& projection)
+{
+    const size_t counts[] = { 10000, 100000, 1000000 };
+    const int frames = 120;
+    const float dt = 1.0f / 60.0f;
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    const glm::vec2 viewportSize(viewport[2], viewport[3]);
+
+    std::cout << "Particle benchmark, " << frames << " frames per run" << std::endl;
+
+    for (size_t count : counts) {
+        benchmarkParticleKernels(count, frames);
+    }
+
+    for (size_t count : counts) {
+        for (ParticleBackend backend : { ParticleBackend::CPU, ParticleBackend::GPU }) {
+            const char* name = backend == ParticleBackend::GPU ? "GPU" : "CPU";
+
+            std::unique_ptr<ParticleSystem> system;
+            try {
+                system = std::make_unique<ParticleSystem>(shader, count, backend);
+            }
+            catch (const std::exception& e) {
+                std::cerr << "  " << name << " backend not available: " << e.what() << std::endl;
+                continue;
+            }
+
+            system->set_emitter_position(glm::vec3(0.0f, 10.0f, -5.0f));
+            system->emit(static_cast<int>(count * 3 / 4));
+            system->emit_smoke(static_cast<int>(count / 4));
+            system->update(0.0f);
+            glFinish();
+
+            float updateMs = 0.0f;
+            float drawMs = 0.0f;
+            float gpuMs = 0.0f;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int frame = 0; frame < frames; frame++) {
+                system->update(dt);
+                system->draw(view, projection, viewportSize);
+                glFinish();
+
+                updateMs += system->getStats().updateCpuMs;
+                drawMs += system->getStats().drawCpuMs;
+                gpuMs += system->getStats().updateGpuMs;
+            }
+            float frameMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / frames;
+
+            std::cout << "  " << name << " " << count << " particles: " << frameMs << " ms/frame ("
+                      << count / frameMs << " particles/ms), update " << updateMs / frames << " ms, draw "
+                      << drawMs / frames << " ms";
+            if (backend == ParticleBackend::GPU) {
+                std::cout << ", GPU simulation " << gpuMs / frames << " ms";
+            }
+            std::cout << std::endl;
+        }
+    }
+}
+
 // Utility function for random values
 float random(float min, float max)
 {
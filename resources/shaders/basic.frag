@@ -2,12 +2,50 @@
 
 in vec3 Normal;
 in vec2 TexCoord;
+in vec3 FragPos;
 
 uniform vec4 uniform_Color;
 uniform sampler2D textureSampler;
 uniform bool useTexture = false;
 out vec4 FragColor;
 
+// Cascaded shadow maps of the sun, same layout as in phong.frag
+#define NR_CASCADES 3
+uniform bool uShadowsEnabled = false;
+uniform sampler2DArrayShadow uShadowMap;
+uniform mat4 uShadowMatrices[NR_CASCADES];
+uniform vec4 uShadowWindows[NR_CASCADES];
+
+float CalcShadow(vec3 fragPos)
+{
+    if (!uShadowsEnabled)
+        return 1.0;
+
+    for (int i = 0; i < NR_CASCADES; i++)
+    {
+        vec4 window = uShadowWindows[i];
+        if (window.w <= 0.0)
+            continue;
+
+        vec3 lightPos = (uShadowMatrices[i] * vec4(fragPos, 1.0)).xyz;
+        vec2 local = (lightPos.xy - window.xy) / window.z;
+        if (any(lessThan(local, vec2(0.02))) || any(greaterThan(local, vec2(0.98))))
+            continue;
+
+        float texelUV = 1.0 / float(textureSize(uShadowMap, 0).x);
+        vec2 uv = lightPos.xy / window.z;
+        float depth = (window.w - lightPos.z) / (2.0 * window.w);
+        float bias = 2.0 * window.z * texelUV / (2.0 * window.w);
+
+        float lit = 0.0;
+        for (int x = -1; x <= 1; x++)
+            for (int y = -1; y <= 1; y++)
+                lit += texture(uShadowMap, vec4(uv + vec2(x, y) * texelUV, float(i), depth - bias));
+        return lit / 9.0;
+    }
+    return 1.0;
+}
+
 void main()
 {
     if (useTexture) {
@@ -16,4 +54,7 @@ void main()
     } else {
         FragColor = uniform_Color;
     }
+
+    // the road is unlit, shadow only darkens it
+    FragColor.rgb *= mix(0.55, 1.0, CalcShadow(FragPos));
 }
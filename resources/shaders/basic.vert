@@ -10,10 +10,12 @@ uniform mat4 uV_m = mat4(1.0);
 
 out vec3 Normal;
 out vec2 TexCoord;
+out vec3 FragPos;
 
 void main()
 {
     gl_Position = uProj_m * uV_m * uM_m * vec4(aPos, 1.0);
     Normal = aNormal;
     TexCoord = aTexCoord;
+    FragPos = vec3(uM_m * vec4(aPos, 1.0));
 }
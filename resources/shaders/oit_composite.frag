@@ -0,0 +1,25 @@
+#version 460 core
+
+out vec4 FragColor;
+
+uniform sampler2D accumTexture;
+uniform sampler2D revealageTexture;
+
+void main()
+{
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+    float revealage = texelFetch(revealageTexture, coord, 0).r;
+
+    // nothing translucent was drawn here
+    if (revealage >= 1.0)
+        discard;
+
+    vec4 accum = texelFetch(accumTexture, coord, 0);
+
+    // guard against overflow of the accumulation target
+    if (isinf(max(max(abs(accum.r), abs(accum.g)), abs(accum.b))))
+        accum.rgb = vec3(accum.a);
+
+    vec3 averageColor = accum.rgb / max(accum.a, 0.00001);
+    FragColor = vec4(averageColor, 1.0 - revealage);
+}
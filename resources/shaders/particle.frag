@@ -1,14 +1,35 @@
 #version 460 core
 
-out vec4 FragColor;
+in vec2 TexCoord;       // billboard coordinates [0..1]
+in vec4 ParticleColor;  // per-particle color, alpha fades with life
+in float ViewDepth;
 
-// Green glow with semi-transparency; can be overridden from CPU via uniform
-uniform vec4 particleColor = vec4(0.15, 0.95, 0.2, 0.6);
+layout (location = 0) out vec4 FragColor;   // color, or weighted accumulation in the OIT pass
+layout (location = 1) out float Revealage;  // used only in the OIT pass
+
+// Tint of the particle type, multiplies the per-particle color
+uniform vec4 particleColor = vec4(1.0, 1.0, 1.0, 0.6);
 // Subtle animated flicker; time provided by CPU or derived via gl_FragCoord
 uniform float uTime = 0.0;
 // Texture for particles (0 = no texture, 1 = use texture)
 uniform int useTexture = 0;
 uniform sampler2D particleTexture;
+// Smoke drawn without a texture uses a soft procedural puff
+uniform bool uSoftSmoke = false;
+// Weighted blended order independent transparency (see TransparencyPass.hpp)
+uniform bool uOitPass = false;
+
+void writeColor(vec4 color)
+{
+    if (uOitPass) {
+        // depth weight from McGuire & Bavoil, eq. 7
+        float weight = color.a * clamp(10.0 / (1e-5 + pow(ViewDepth / 5.0, 2.0) + pow(ViewDepth / 200.0, 6.0)), 1e-2, 3e3);
+        FragColor = vec4(color.rgb * color.a, color.a) * weight;
+        Revealage = color.a;
+    } else {
+        FragColor = color;
+    }
+}
 
 float smoothGlow(float r, float rInner, float rOuter)
 {
@@ -22,22 +43,30 @@ float smoothGlow(float r, float rInner, float rOuter)
 
 void main()
 {
+    vec4 baseColor = ParticleColor * particleColor;
+
     // Check if we should use texture
     if (useTexture == 1) {
         // Sample the texture
-        vec4 texColor = texture(particleTexture, gl_PointCoord);
+        vec4 texColor = texture(particleTexture, TexCoord);
         
         // Apply particle color tint and fade based on life
-        vec4 finalColor = texColor * particleColor;
+        vec4 finalColor = texColor * baseColor;
         
         // Discard transparent pixels
         if (finalColor.a < 0.01) discard;
         
-        FragColor = finalColor;
+        writeColor(finalColor);
+    } else if (uSoftSmoke) {
+        float r = length(TexCoord - vec2(0.5));
+        if (r > 0.5) discard;
+
+        float alpha = baseColor.a * (1.0 - smoothstep(0.15, 0.5, r));
+        writeColor(vec4(baseColor.rgb, alpha));
     } else {
         // Original glow effect for non-textured particles
-        // Normalized point sprite coords [-0.5..0.5]
-        vec2 coord = gl_PointCoord - vec2(0.5);
+        // Normalized billboard coords [-0.5..0.5]
+        vec2 coord = TexCoord - vec2(0.5);
         float r = length(coord);
 
         // Soft circle cutoff a bit past 0.5 to allow feathering
@@ -58,13 +87,13 @@ void main()
         glow *= edge;
 
         // Color grading: brighten center slightly and tint towards lime for vividness
-        vec3 base = particleColor.rgb;
+        vec3 base = baseColor.rgb;
         vec3 vivid = mix(base, vec3(0.3, 1.0, 0.35), 0.35);
         vec3 color = mix(base, vivid, clamp(glow * 1.2, 0.0, 1.0));
 
         // Alpha ramps with glow; clamp for semi-transparency
-        float alpha = particleColor.a * clamp(glow, 0.0, 1.0);
+        float alpha = baseColor.a * clamp(glow, 0.0, 1.0);
 
-        FragColor = vec4(color, alpha);
+        writeColor(vec4(color, alpha));
     }
 }
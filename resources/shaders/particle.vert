@@ -1,13 +1,45 @@
 #version 460 core
 
-layout (location = 0) in vec3 aPos;
+// Camera facing billboard, one instance per particle. The per-particle attributes
+// come as separate streams from the SoA particle pools (instance divisor 1).
+layout (location = 0) in float aPosX;
+layout (location = 1) in float aPosY;
+layout (location = 2) in float aPosZ;
+layout (location = 3) in float aSize;
+layout (location = 4) in float aRotation;
+layout (location = 5) in float aColorR;
+layout (location = 6) in float aColorG;
+layout (location = 7) in float aColorB;
+layout (location = 8) in float aColorA;
 
 uniform mat4 uProj_m;
 uniform mat4 uV_m;
-uniform float uPointSize = 10.0; // Base point size
+uniform float uSizeScale = 1.0;                  // world size of a particle with size 1
+uniform vec2 uViewportSize = vec2(1920.0, 1080.0);
+uniform vec2 uPixelSizeRange = vec2(1.0, 256.0); // on-screen size is kept in this range
+
+out vec2 TexCoord;
+out vec4 ParticleColor;
+out float ViewDepth; // distance along the view axis, for the OIT weight
 
 void main()
 {
-    gl_Position = uProj_m * uV_m * vec4(aPos, 1.0);
-    gl_PointSize = uPointSize; // Use uniform point size, can be modified per draw call
+    // triangle strip corners (-1,-1), (1,-1), (-1,1), (1,1)
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+
+    vec4 viewPos = uV_m * vec4(aPosX, aPosY, aPosZ, 1.0);
+    ViewDepth = -viewPos.z;
+
+    // perspective shrinks the billboard with distance, clamp its on-screen size
+    float worldSize = aSize * uSizeScale;
+    float pixels = worldSize * uProj_m[1][1] * 0.5 * uViewportSize.y / max(ViewDepth, 0.001);
+    worldSize *= clamp(pixels, uPixelSizeRange.x, uPixelSizeRange.y) / max(pixels, 0.000001);
+
+    float c = cos(aRotation);
+    float s = sin(aRotation);
+    viewPos.xy += mat2(c, s, -s, c) * corner * 0.5 * worldSize;
+
+    TexCoord = corner * 0.5 + 0.5;
+    ParticleColor = vec4(aColorR, aColorG, aColorB, aColorA);
+    gl_Position = uProj_m * viewPos;
 }
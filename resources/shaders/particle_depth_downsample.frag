@@ -0,0 +1,24 @@
+#version 460 core
+
+// Writes the farthest opaque depth of every divisor x divisor block of the full
+// resolution depth into the low resolution particle target (see ParticleTarget.hpp).
+// The farthest depth keeps particles visible along silhouettes, the bilateral
+// upsample then rejects them where they are really hidden.
+
+uniform sampler2D depthTexture;
+uniform int uDivisor = 2;
+
+void main()
+{
+    ivec2 fullSize = textureSize(depthTexture, 0);
+    ivec2 base = ivec2(gl_FragCoord.xy) * uDivisor;
+
+    float depth = 0.0;
+    for (int y = 0; y < uDivisor; y++) {
+        for (int x = 0; x < uDivisor; x++) {
+            ivec2 coord = min(base + ivec2(x, y), fullSize - 1);
+            depth = max(depth, texelFetch(depthTexture, coord, 0).r);
+        }
+    }
+    gl_FragDepth = depth;
+}
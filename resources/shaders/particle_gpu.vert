@@ -0,0 +1,49 @@
+#version 460 core
+
+// Vertex shader of the GPU particle system: a camera facing billboard per living
+// particle, read from the particle SSBO through the draw list built by
+// particle_simulate.comp (the list of a type starts at gl_BaseInstance).
+
+struct Particle {
+    vec4 positionLife;
+    vec4 velocityLifetime;
+    vec4 color;
+    vec4 params; // x = size, y = type, z = rotation, w = spin
+};
+
+layout (std430, binding = 0) readonly buffer Particles { Particle particles[]; };
+layout (std430, binding = 2) readonly buffer DrawIndices { uint drawIndices[]; };
+
+uniform mat4 uProj_m;
+uniform mat4 uV_m;
+uniform float uSizeScale = 1.0;                  // world size of a particle with size 1
+uniform vec2 uViewportSize = vec2(1920.0, 1080.0);
+uniform vec2 uPixelSizeRange = vec2(1.0, 256.0); // on-screen size is kept in this range
+
+out vec2 TexCoord;
+out vec4 ParticleColor;
+out float ViewDepth; // distance along the view axis, for the OIT weight
+
+void main()
+{
+    Particle p = particles[drawIndices[gl_BaseInstance + gl_InstanceID]];
+
+    // triangle strip corners (-1,-1), (1,-1), (-1,1), (1,1)
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+
+    vec4 viewPos = uV_m * vec4(p.positionLife.xyz, 1.0);
+    ViewDepth = -viewPos.z;
+
+    // perspective shrinks the billboard with distance, clamp its on-screen size
+    float worldSize = p.params.x * uSizeScale;
+    float pixels = worldSize * uProj_m[1][1] * 0.5 * uViewportSize.y / max(ViewDepth, 0.001);
+    worldSize *= clamp(pixels, uPixelSizeRange.x, uPixelSizeRange.y) / max(pixels, 0.000001);
+
+    float c = cos(p.params.z);
+    float s = sin(p.params.z);
+    viewPos.xy += mat2(c, s, -s, c) * corner * 0.5 * worldSize;
+
+    TexCoord = corner * 0.5 + 0.5;
+    ParticleColor = p.color;
+    gl_Position = uProj_m * viewPos;
+}
@@ -0,0 +1,51 @@
+#version 460 core
+
+// Bilateral upsample of the low resolution particle target (see ParticleTarget.hpp).
+// The four nearest low resolution texels are blended with bilinear weights that are
+// scaled down when their depth differs from the full resolution depth of the pixel,
+// so particles do not bleed over the edges of closer geometry.
+
+out vec4 FragColor;
+
+uniform sampler2D particleTexture;  // premultiplied color, alpha = coverage
+uniform sampler2D lowDepthTexture;
+uniform sampler2D fullDepthTexture;
+uniform int uDivisor = 2;
+uniform vec2 uNearFar;               // clip planes of the projection
+
+float linearDepth(float depth)
+{
+    float z = depth * 2.0 - 1.0;
+    return 2.0 * uNearFar.x * uNearFar.y / (uNearFar.y + uNearFar.x - z * (uNearFar.y - uNearFar.x));
+}
+
+void main()
+{
+    ivec2 lowSize = textureSize(particleTexture, 0);
+    float fullDepth = linearDepth(texelFetch(fullDepthTexture, ivec2(gl_FragCoord.xy), 0).r);
+
+    vec2 lowCoord = gl_FragCoord.xy / float(uDivisor) - 0.5;
+    ivec2 base = ivec2(floor(lowCoord));
+    vec2 f = lowCoord - vec2(base);
+
+    vec4 color = vec4(0.0);
+    float weightSum = 0.0;
+    for (int i = 0; i < 4; i++) {
+        ivec2 offset = ivec2(i & 1, i >> 1);
+        ivec2 coord = clamp(base + offset, ivec2(0), lowSize - 1);
+
+        vec2 bilinear = mix(1.0 - f, f, vec2(offset));
+        float lowDepth = linearDepth(texelFetch(lowDepthTexture, coord, 0).r);
+        float depthWeight = 1.0 / (0.001 + abs(lowDepth - fullDepth) / fullDepth);
+
+        float weight = bilinear.x * bilinear.y * depthWeight;
+        color += texelFetch(particleTexture, coord, 0) * weight;
+        weightSum += weight;
+    }
+
+    color /= max(weightSum, 0.00001);
+    if (color.a < 0.002)
+        discard;
+
+    FragColor = color;
+}
@@ -4,7 +4,8 @@ in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
 
-out vec4 FragColor;
+layout (location = 0) out vec4 FragColor;   // color, or weighted accumulation in the OIT pass
+layout (location = 1) out float Revealage;  // used only in the OIT pass
 
 // Material properties
 struct Material {
@@ -57,8 +58,9 @@ struct SpotLight {
 uniform vec3 viewPos;
 uniform DirLight dirLight;
 
-#define NR_POINT_LIGHTS 3
-uniform PointLight pointLights[NR_POINT_LIGHTS];
+#define MAX_POINT_LIGHTS 64 // LightingSystem::MAX_POINT_LIGHTS
+uniform PointLight pointLights[MAX_POINT_LIGHTS];
+uniform int pointLightCount = 3;
 uniform SpotLight spotLight;
 
 // Uniforms for material properties (for compatibility with Mesh.hpp)
@@ -69,9 +71,21 @@ uniform vec3 material_diffuse;
 uniform vec3 material_specular;
 uniform float material_shininess;
 uniform vec3 material_emission;
+uniform float material_alpha = 1.0;
+
+// Weighted blended order independent transparency (see TransparencyPass.hpp)
+uniform bool uOitPass = false;
+
+// Cascaded shadow maps of the sun (see ShadowMaps.hpp)
+#define NR_CASCADES 3
+uniform bool uShadowsEnabled = false;
+uniform sampler2DArrayShadow uShadowMap;
+uniform mat4 uShadowMatrices[NR_CASCADES]; // world -> light space
+uniform vec4 uShadowWindows[NR_CASCADES];  // xy = window minimum, z = window size, w = depth half range (0 = not ready)
 
 // Function prototypes
-vec3 CalcDirLight(DirLight light, Material material, vec3 normal, vec3 viewDir);
+float CalcShadow(vec3 fragPos, float slope);
+vec3 CalcDirLight(DirLight light, Material material, vec3 normal, vec3 viewDir, float shadow);
 vec3 CalcPointLight(PointLight light, Material material, vec3 normal, vec3 fragPos, vec3 viewDir);
 vec3 CalcSpotLight(SpotLight light, Material material, vec3 normal, vec3 fragPos, vec3 viewDir);
 
@@ -90,10 +104,11 @@ void main()
     vec3 viewDir = normalize(viewPos - FragPos);
     
     // Calculate directional lighting
-    vec3 result = CalcDirLight(dirLight, material, norm, viewDir);
+    float shadow = CalcShadow(FragPos, 1.0 - max(dot(norm, normalize(-dirLight.direction)), 0.0));
+    vec3 result = CalcDirLight(dirLight, material, norm, viewDir, shadow);
     
     // Calculate point lights
-    for(int i = 0; i < NR_POINT_LIGHTS; i++)
+    for(int i = 0; i < pointLightCount; i++)
         result += CalcPointLight(pointLights[i], material, norm, FragPos, viewDir);
     
     // Calculate spot light
@@ -108,11 +123,54 @@ void main()
     // Add emission (self-illumination)
     result += material.emission;
     
-    FragColor = vec4(result, 1.0);
+    if (uOitPass) {
+        // depth weight from McGuire & Bavoil, eq. 7
+        float dist = length(viewPos - FragPos);
+        float weight = material_alpha * clamp(10.0 / (1e-5 + pow(dist / 5.0, 2.0) + pow(dist / 200.0, 6.0)), 1e-2, 3e3);
+        FragColor = vec4(result * material_alpha, material_alpha) * weight;
+        Revealage = material_alpha;
+    } else {
+        FragColor = vec4(result, material_alpha);
+    }
+}
+
+// Returns 1.0 for fully lit and 0.0 for fully shadowed fragment
+float CalcShadow(vec3 fragPos, float slope)
+{
+    if (!uShadowsEnabled)
+        return 1.0;
+
+    // pick the smallest cascade whose window contains the fragment
+    for (int i = 0; i < NR_CASCADES; i++)
+    {
+        vec4 window = uShadowWindows[i];
+        if (window.w <= 0.0)
+            continue;
+
+        vec3 lightPos = (uShadowMatrices[i] * vec4(fragPos, 1.0)).xyz;
+        vec2 local = (lightPos.xy - window.xy) / window.z;
+        if (any(lessThan(local, vec2(0.02))) || any(greaterThan(local, vec2(0.98))))
+            continue;
+
+        float texelUV = 1.0 / float(textureSize(uShadowMap, 0).x);
+        float texel = window.z * texelUV;
+
+        // the cascade is a toroidal buffer over absolute light space coordinates
+        vec2 uv = lightPos.xy / window.z;
+        float depth = (window.w - lightPos.z) / (2.0 * window.w);
+        float bias = texel * (1.0 + 2.0 * slope) / (2.0 * window.w);
+
+        float lit = 0.0;
+        for (int x = -1; x <= 1; x++)
+            for (int y = -1; y <= 1; y++)
+                lit += texture(uShadowMap, vec4(uv + vec2(x, y) * texelUV, float(i), depth - bias));
+        return lit / 9.0;
+    }
+    return 1.0;
 }
 
 // Calculates the color when using a directional light
-vec3 CalcDirLight(DirLight light, Material material, vec3 normal, vec3 viewDir)
+vec3 CalcDirLight(DirLight light, Material material, vec3 normal, vec3 viewDir, float shadow)
 {
     vec3 lightDir = normalize(-light.direction);
     
@@ -128,7 +186,7 @@ vec3 CalcDirLight(DirLight light, Material material, vec3 normal, vec3 viewDir)
     vec3 diffuse = light.diffuse * diff * material.diffuse;
     vec3 specular = light.specular * spec * material.specular;
     
-    return (ambient + diffuse + specular);
+    return (ambient + shadow * (diffuse + specular));
 }
 
 // Calculates the color when using a point light
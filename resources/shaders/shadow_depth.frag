@@ -0,0 +1,6 @@
+#version 460 core
+
+// Depth only pass, depth is written by the fixed function
+void main()
+{
+}
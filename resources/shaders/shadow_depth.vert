@@ -0,0 +1,11 @@
+#version 460 core
+
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 uLightVP = mat4(1.0);
+uniform mat4 uM_m = mat4(1.0);
+
+void main()
+{
+    gl_Position = uLightVP * uM_m * vec4(aPos, 1.0);
+}
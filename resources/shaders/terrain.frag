@@ -0,0 +1,68 @@
+#version 460 core
+
+in vec3 Normal;
+in vec3 FragPos;
+
+uniform vec3 uLightDirection = vec3(-0.2, -1.0, -0.3); // direction the sunlight travels
+uniform vec3 uLightAmbient = vec3(0.05);
+uniform vec3 uLightDiffuse = vec3(0.4);
+uniform vec3 uViewPos;
+uniform vec3 uFogColor = vec3(0.55, 0.70, 0.95);
+uniform float uFogEnd = 2000.0; // terrain view distance
+out vec4 FragColor;
+
+// Cascaded shadow maps of the sun, same layout as in phong.frag
+#define NR_CASCADES 3
+uniform bool uShadowsEnabled = false;
+uniform sampler2DArrayShadow uShadowMap;
+uniform mat4 uShadowMatrices[NR_CASCADES];
+uniform vec4 uShadowWindows[NR_CASCADES];
+
+float CalcShadow(vec3 fragPos)
+{
+    if (!uShadowsEnabled)
+        return 1.0;
+
+    for (int i = 0; i < NR_CASCADES; i++)
+    {
+        vec4 window = uShadowWindows[i];
+        if (window.w <= 0.0)
+            continue;
+
+        vec3 lightPos = (uShadowMatrices[i] * vec4(fragPos, 1.0)).xyz;
+        vec2 local = (lightPos.xy - window.xy) / window.z;
+        if (any(lessThan(local, vec2(0.02))) || any(greaterThan(local, vec2(0.98))))
+            continue;
+
+        float texelUV = 1.0 / float(textureSize(uShadowMap, 0).x);
+        vec2 uv = lightPos.xy / window.z;
+        float depth = (window.w - lightPos.z) / (2.0 * window.w);
+        float bias = 2.0 * window.z * texelUV / (2.0 * window.w);
+
+        float lit = 0.0;
+        for (int x = -1; x <= 1; x++)
+            for (int y = -1; y <= 1; y++)
+                lit += texture(uShadowMap, vec4(uv + vec2(x, y) * texelUV, float(i), depth - bias));
+        return lit / 9.0;
+    }
+    return 1.0;
+}
+
+void main()
+{
+    vec3 norm = normalize(Normal);
+
+    // grass on the flats, rock on the slopes, lighter on the tops
+    vec3 grass = vec3(0.28, 0.42, 0.18);
+    vec3 rock = vec3(0.42, 0.38, 0.34);
+    vec3 albedo = mix(rock, grass, smoothstep(0.70, 0.85, norm.y));
+    albedo = mix(albedo, vec3(0.80, 0.80, 0.78), smoothstep(22.0, 32.0, FragPos.y) * smoothstep(0.6, 0.8, norm.y));
+
+    float lambert = max(dot(norm, normalize(-uLightDirection)), 0.0);
+    float shadow = CalcShadow(FragPos);
+    // the sky lights the terrain too, the scene lights alone leave it almost black
+    vec3 light = uLightAmbient + vec3(0.35) * (0.5 + 0.5 * norm.y) + uLightDiffuse * lambert * shadow;
+
+    float fog = smoothstep(0.4 * uFogEnd, uFogEnd, length(FragPos - uViewPos));
+    FragColor = vec4(mix(albedo * light, uFogColor, fog), 1.0);
+}
@@ -0,0 +1,18 @@
+#version 460 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+
+uniform mat4 uProj_m = mat4(1.0);
+uniform mat4 uM_m = mat4(1.0); // world offset and node corner, translation only
+uniform mat4 uV_m = mat4(1.0);
+
+out vec3 Normal;
+out vec3 FragPos;
+
+void main()
+{
+    FragPos = vec3(uM_m * vec4(aPos, 1.0));
+    Normal = aNormal;
+    gl_Position = uProj_m * uV_m * vec4(FragPos, 1.0);
+}